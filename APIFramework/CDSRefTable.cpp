@@ -82,6 +82,7 @@ void CDSRefTable::ClearAllTables( void )
 			{
 				if (fRefTables[ i ]->fTableData[j] != nil)
 				{
+					DSFree(fRefTables[ i ]->fTableData[j]->fIndexOffsets);
 					free(fRefTables[ i ]->fTableData[j]);
 					fRefTables[ i ]->fTableData[j] = nil;
 				}
@@ -568,6 +569,8 @@ tDirStatus CDSRefTable::GetNewRef (	UInt32		   *outRef,
 						pCurTable->fTableData[ uiSlot ]->fPID			= inPID;
 						pCurTable->fTableData[ uiSlot ]->fOffset		= 0;
 						pCurTable->fTableData[ uiSlot ]->fBufTag		= 0;
+						pCurTable->fTableData[ uiSlot ]->fIndexOffsets	= nil;
+						pCurTable->fTableData[ uiSlot ]->fIndexCount	= 0;
 						pCurTable->fTableData[ uiSlot ]->fChildren		= nil;
 						pCurTable->fTableData[ uiSlot ]->fChildPID		= nil;
 
@@ -842,6 +845,7 @@ tDirStatus CDSRefTable::RemoveRef ( UInt32 inRefNum, UInt32 inType, SInt32 inPID
 						}
 					}
 					
+					DSFree(pCurrRef->fIndexOffsets);
 					free(pCurrRef);
 					pCurrRef = nil;
 				}
@@ -1023,6 +1027,77 @@ tDirStatus CDSRefTable::SetBufTag ( UInt32 inRefNum, UInt32 inType, UInt32 inBuf
 
 } // SetBufTag
 
+//------------------------------------------------------------------------------------
+//	* GetIndexOffset
+//------------------------------------------------------------------------------------
+
+tDirStatus CDSRefTable::GetIndexOffset ( UInt32 inRefNum, UInt32 inType, UInt32 inIndex, UInt32* outOffset, SInt32 inPID )
+{
+	tDirStatus		siResult	= eDSDirSrvcNotOpened;
+	sFWRefEntry	   *pCurrRef	= nil;
+
+	fTableMutex.WaitLock();
+
+	siResult = VerifyReference( inRefNum, inType, inPID );
+	
+	if (siResult == eDSNoErr)
+	{
+		pCurrRef = GetTableRef( inRefNum );
+		
+		siResult = eDSInvalidReference;
+		if ( pCurrRef != nil )
+		{
+			siResult = eDSIndexOutOfRange;
+			if ( (inIndex != 0) && (inIndex <= pCurrRef->fIndexCount) )
+			{
+				*outOffset = pCurrRef->fIndexOffsets[ inIndex - 1 ];
+				siResult = eDSNoErr;
+			}
+		}
+	}
+	
+	fTableMutex.SignalLock();
+    
+	return( siResult );
+
+} // GetIndexOffset
+
+//------------------------------------------------------------------------------------
+//	* SetIndexOffsets
+//------------------------------------------------------------------------------------
+
+tDirStatus CDSRefTable::SetIndexOffsets ( UInt32 inRefNum, UInt32 inType, UInt32* inOffsets, UInt32 inCount, SInt32 inPID )
+{
+	tDirStatus		siResult	= eDSDirSrvcNotOpened;
+	sFWRefEntry	   *pCurrRef	= nil;
+
+	fTableMutex.WaitLock();
+
+	siResult = VerifyReference( inRefNum, inType, inPID );
+	
+	if (siResult == eDSNoErr)
+	{
+		pCurrRef = GetTableRef( inRefNum );
+		
+		siResult = eDSInvalidReference;
+		if ( pCurrRef != nil )
+		{
+			DSFree( pCurrRef->fIndexOffsets );
+			pCurrRef->fIndexOffsets = inOffsets;
+			pCurrRef->fIndexCount = inCount;
+			inOffsets = nil;
+			siResult = eDSNoErr;
+		}
+	}
+	
+	fTableMutex.SignalLock();
+	
+	DSFree( inOffsets );
+    
+	return( siResult );
+
+} // SetIndexOffsets
+
 //------------------------------------------------------------------------------------
 //	* GetRefCount
 //------------------------------------------------------------------------------------
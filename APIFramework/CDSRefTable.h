@@ -63,6 +63,8 @@ typedef struct sFWRefEntry {
 	UInt32			fType;
     UInt32			fOffset;
 	UInt32			fBufTag;
+	UInt32		   *fIndexOffsets;	// lazily built offsets of each indexed entry, relative to the buffer
+	UInt32			fIndexCount;
 	UInt32			fParentID;
 	SInt32			fPID;
 	sListFWInfo	   *fChildren;
@@ -114,6 +116,8 @@ public:
     tDirStatus	SetOffset			( UInt32 inRefNum, UInt32 inType, UInt32 inOffset, SInt32 inPID );
     tDirStatus	GetBufTag			( UInt32 inRefNum, UInt32 inType, UInt32* outBufTag, SInt32 inPID );
     tDirStatus	SetBufTag			( UInt32 inRefNum, UInt32 inType, UInt32 inBufTag, SInt32 inPID );
+    tDirStatus	GetIndexOffset		( UInt32 inRefNum, UInt32 inType, UInt32 inIndex, UInt32* outOffset, SInt32 inPID );
+    tDirStatus	SetIndexOffsets		( UInt32 inRefNum, UInt32 inType, UInt32* inOffsets, UInt32 inCount, SInt32 inPID );	// takes ownership of inOffsets
 
 private:
 	DSMutexSemaphore	fTableMutex;
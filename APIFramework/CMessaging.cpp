@@ -828,9 +828,7 @@ SInt32 CMessaging::GetThisObj ( sComData *inMsg, eValueType inType, sObject **ou
 
 bool CMessaging::Grow ( UInt32 inOffset, UInt32 inSize )
 {
-	UInt32		newSize		= 0;
-	char	   *pNewPtr		= nil;
-	UInt32		length		= 0;
+	sComData   *pNewPtr		= nil;
 	sComData   *aMsgData	= nil;
 	bool		bGrown		= false;
 
@@ -846,50 +844,35 @@ bool CMessaging::Grow ( UInt32 inOffset, UInt32 inSize )
 		// Do we need a bigger object
 		if ( (aMsgData->fDataLength + inSize) > aMsgData->fDataSize )
 		{
-			newSize = aMsgData->fDataSize;
-			//idea is to make the newSize a multiple of kMsgBlockSize
-			while( newSize < (aMsgData->fDataLength + inSize) )
-			{
-				newSize += kMsgBlockSize;
-			}
-			length = aMsgData->fDataLength;
+			// the old block is recycled by dsGrowComDataPriv, so the buffer swap has to go
+			// by the original pointer value only
+			sComData *oldMsgData = aMsgData;
 			
-			// Create the new pointer
-			pNewPtr = (char *)::calloc( 1, sizeof( sComData ) + newSize );
+			// grows geometrically and copies the old data
+			pNewPtr = dsGrowComDataPriv( aMsgData, aMsgData->fDataLength + inSize );
 			if ( pNewPtr == nil )
 			{
 				throw( (SInt32)eMemoryAllocError );
 			}
 	
-			// Copy the old data to the new destination
-			::memcpy( pNewPtr, aMsgData, sizeof(sComData) + aMsgData->fDataLength );
-	
 			if (fInternal == true) {
 				//look at our own thread and then get the msg data block to use for internal dispatch
 				CInternalDispatch *internalDispatch = CInternalDispatch::GetThreadInternalDispatch();
 				if ( internalDispatch != NULL )
 				{
-					internalDispatch->SwapCurrentMessageBuffer(aMsgData, (sComData *)pNewPtr);
+					internalDispatch->SwapCurrentMessageBuffer(oldMsgData, pNewPtr);
 				}
 				else //we are not inside a handler thread
 				{
-					fMsgData = (sComData *)pNewPtr;
+					fMsgData = pNewPtr;
 				}
 			} else {
-				fMsgData = (sComData *)pNewPtr;
+				fMsgData = pNewPtr;
 			}
 
-			// Dump the old data block
-			::free( aMsgData );
-			aMsgData = nil;
-	
 			// Assign the new data block
-			aMsgData = (sComData *)pNewPtr;
+			aMsgData = pNewPtr;
 			pNewPtr = nil;
-	
-			// Set the new data size
-			aMsgData->fDataSize		= newSize;
-			aMsgData->fDataLength	= length;
 			bGrown = true;
 		}
 	}
@@ -904,6 +887,10 @@ bool CMessaging::Grow ( UInt32 inOffset, UInt32 inSize )
 void CMessaging::Lock ( void )
 {
 	if (fInternal == true) {
+		//give every calling thread its own msg data blocks, otherwise threads that are not handler
+		//threads (i.e., dispatch queues) all serialize on the single fMsgData block below
+		CInternalDispatch::AddCapability();
+
 		//look at our own thread and then get the msg data block to use for internal dispatch
 		CInternalDispatch *internalDispatch = CInternalDispatch::GetThreadInternalDispatch();
 		if ( internalDispatch != NULL )
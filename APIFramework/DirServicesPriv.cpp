@@ -154,6 +154,74 @@ tDirStatus IsFWReference ( UInt32 inRef )
     
 } // IsFWReference
 
+//------------------------------------------------------------------------------------
+//	Name: GetIndexedBlockOffset
+//------------------------------------------------------------------------------------
+
+// attribute and value lists are runs of length-prefixed blocks, so reaching entry N means walking
+// the N-1 before it; walk the run once per reference and keep the offsets so indexed access is direct
+
+static tDirStatus GetIndexedBlockOffset (	tDataBufferPtr	inOutDataBuff,
+											UInt32			inRef,
+											UInt32			inRefType,
+											UInt32			inFirstOffset,
+											UInt32			inBlockCount,
+											UInt32			inBuffLen,
+											UInt32			inLenSize,
+											UInt32			inIndex,
+											UInt32		   *outOffset )
+{
+	UInt32		   *offsets		= nil;
+	UInt32			offset		= inFirstOffset;
+	UInt32			blockLen	= 0;
+	UInt16			blockLen16	= 0;
+	UInt32			i			= 0;
+
+	if ( gFWRefTable.GetIndexOffset( inRef, inRefType, inIndex, outOffset, gProcessPID ) == eDSNoErr )
+	{
+		return( eDSNoErr );
+	}
+
+	offsets = (UInt32 *)::calloc( inBlockCount, sizeof(UInt32) );
+	if ( offsets == nil ) return( eMemoryAllocError );
+
+	for ( i = 0; i < inBlockCount; i++ )
+	{
+		// Do record check, verify that offset is not past end of buffer, etc.
+		if ( inLenSize + offset > inBuffLen ) break;
+
+		offsets[ i ] = offset;
+
+		// Get the length for the block and move past it
+		if ( inLenSize == 2 )
+		{
+			::memcpy( &blockLen16, inOutDataBuff->fBufferData + offset, 2 );
+			blockLen = (UInt32)blockLen16;
+		}
+		else
+		{
+			::memcpy( &blockLen, inOutDataBuff->fBufferData + offset, 4 );
+		}
+
+		offset += inLenSize + blockLen;
+	}
+
+	if ( (inIndex == 0) || (inIndex > i) )
+	{
+		DSFree( offsets );
+		return( eDSInvalidBuffFormat );
+	}
+
+	*outOffset = offsets[ inIndex - 1 ];
+
+	// the ref table takes ownership of the offsets
+	gFWRefTable.SetIndexOffsets( inRef, inRefType, offsets, i, gProcessPID );
+
+	return( eDSNoErr );
+
+} // GetIndexedBlockOffset
+
+
 //------------------------------------------------------------------------------------
 //	Name: ExtractRecordEntry
 //------------------------------------------------------------------------------------
@@ -370,25 +438,16 @@ tDirStatus ExtractAttributeEntry (	tDataBufferPtr			inOutDataBuff,
 		p		+= 2;
 		offset	+= 2;
 
+		// Skip to the attribute that we want
+		siResult = GetIndexedBlockOffset( inOutDataBuff, inAttrListRef, eAttrListRefType, offset, usAttrCnt, buffSize,
+										  ((bufTag == 'StdB') || (bufTag == 'DbgB')) ? 2 : 4, uiIndex, &uiOffset );
+		if ( siResult != eDSNoErr ) throw( siResult );
+
+		p		= inOutDataBuff->fBufferData + uiOffset;
+		offset	= uiOffset;
+
 		if ( (bufTag == 'StdB') || (bufTag == 'DbgB') )
 		{
-			// Skip to the attribute that we want
-			for ( i = 1; i < uiIndex; i++ )
-			{
-				// Do record check, verify that offset is not past end of buffer, etc.
-				if (2 + offset > buffSize)  throw( (SInt32)eDSInvalidBuffFormat );
-			
-				// Get the length for the attribute
-				::memcpy( &usAttrLen16, p, 2 );
-	
-				// Move the offset past the length word and the length of the data
-				p		+= 2 + usAttrLen16;
-				offset	+= 2 + usAttrLen16;
-			}
-	
-			// Get the attribute offset
-			uiOffset = offset;
-	
 			// Do record check, verify that offset is not past end of buffer, etc.
 			if (2 + offset > buffSize)  throw( (SInt32)eDSInvalidBuffFormat );
 			
@@ -403,23 +462,6 @@ tDirStatus ExtractAttributeEntry (	tDataBufferPtr			inOutDataBuff,
 		}
 		else
 		{
-			// Skip to the attribute that we want
-			for ( i = 1; i < uiIndex; i++ )
-			{
-				// Do record check, verify that offset is not past end of buffer, etc.
-				if (4 + offset > buffSize)  throw( (SInt32)eDSInvalidBuffFormat );
-			
-				// Get the length for the attribute
-				::memcpy( &usAttrLen, p, 4 );
-	
-				// Move the offset past the length word and the length of the data
-				p		+= 4 + usAttrLen;
-				offset	+= 4 + usAttrLen;
-			}
-	
-			// Get the attribute offset
-			uiOffset = offset;
-	
 			// Do record check, verify that offset is not past end of buffer, etc.
 			if (4 + offset > buffSize)  throw( (SInt32)eDSInvalidBuffFormat );
 			
@@ -546,7 +588,6 @@ tDirStatus ExtractAttributeValue (	tDataBufferPtr			 inOutDataBuff,
 	UInt16						usValueLen16	= 0;
 	UInt32						usValueLen		= 0;
 	UInt16						usAttrNameLen	= 0;
-	UInt32						i				= 0;
 	UInt32						uiIndex			= 0;
 	UInt32						offset			= 0;
 	char					   *p				= nil;
@@ -636,21 +677,15 @@ tDirStatus ExtractAttributeValue (	tDataBufferPtr			 inOutDataBuff,
 
 		if (uiIndex > usValueCnt)  throw( (SInt32)eDSIndexOutOfRange );
 
+		// Skip to the value that we want
+		siResult = GetIndexedBlockOffset( inOutDataBuff, inAttrValueListRef, eAttrValueListRefType, offset, usValueCnt, buffLen,
+										  ((bufTag == 'StdB') || (bufTag == 'DbgB')) ? 2 : 4, uiIndex, &offset );
+		if ( siResult != eDSNoErr ) throw( siResult );
+
+		p = inOutDataBuff->fBufferData + offset;
+
 		if ( (bufTag == 'StdB') || (bufTag == 'DbgB') )
 		{
-			// Skip to the value that we want
-			for ( i = 1; i < uiIndex; i++ )
-			{
-				// Do record check, verify that offset is not past end of buffer, etc.
-				if (2 + offset > buffLen)  throw( (SInt32)eDSInvalidBuffFormat );
-			
-				// Get the length for the value
-				::memcpy( &usValueLen16, p, 2 );
-				
-				p		+= 2 + usValueLen16;
-				offset	+= 2 + usValueLen16;
-			}
-	
 			// Do record check, verify that offset is not past end of buffer, etc.
 			if (2 + offset > buffLen)  throw( (SInt32)eDSInvalidBuffFormat );
 			
@@ -663,19 +698,6 @@ tDirStatus ExtractAttributeValue (	tDataBufferPtr			 inOutDataBuff,
 		}
 		else
 		{
-			// Skip to the value that we want
-			for ( i = 1; i < uiIndex; i++ )
-			{
-				// Do record check, verify that offset is not past end of buffer, etc.
-				if (4 + offset > buffLen)  throw( (SInt32)eDSInvalidBuffFormat );
-			
-				// Get the length for the value
-				::memcpy( &usValueLen, p, 4 );
-				
-				p		+= 4 + usValueLen;
-				offset	+= 4 + usValueLen;
-			}
-	
 			// Do record check, verify that offset is not past end of buffer, etc.
 			if (4 + offset > buffLen)  throw( (SInt32)eDSInvalidBuffFormat );
 			
@@ -32,6 +32,7 @@
 #include "DirServices.h"
 #include "DirServicesTypesPriv.h"
 #include "PrivateTypes.h"
+#include "DataListPriv.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -340,15 +341,20 @@ UInt32 dsDataNodeGetSize ( tDataNode *inDataNodePtr )
 tDataListPtr dsDataListAllocate ( tDirReference inDirRef )
 {
 #pragma unused ( inDirRef )
-	tDataList		   *outResult	= nil;
+	tDataListPriv	   *outResult	= nil;
 
-	outResult = (tDataList *)::calloc( 1, sizeof( tDataList ) );
+	outResult = (tDataListPriv *)::calloc( 1, sizeof( tDataListPriv ) );
 	if ( outResult == nil )
 	{
 		LOG2( kStdErr, "*** DS NULL Error: File: %s. Line: %d.\n", __FILE__, __LINE__ );
 	}
+	else
+	{
+		outResult->fSignature = kDataListIndexSignature;
+		outResult->fSelf = outResult;
+	}
 
-	return( outResult );
+	return( (tDataList *) outResult );
 
 } // dsDataListAllocate
 
@@ -394,6 +400,8 @@ tDirStatus dsDataListDeallocate (	tDirReference	inDirRef,
 	//KW need to determine HOW to free the actual tDataList ie. what if stack variable passed in
 	//plan to include setting inside tDataList that determines if utility routine actually calloc'ed it
 
+	dsDataListFreeIndexPriv( inDataList );
+
 	if ( inDataList->fDataListHead != nil )
 	{
 		pDataBuff = inDataList->fDataListHead;
@@ -892,6 +900,8 @@ tDirStatus dsBuildListFromStringsAllocV ( tDirReference	inDirRef,
 
 	va_end( args );
 
+	dsDataListRebuildIndexPriv( inDataList );
+
 	return( tResult );
 
 } // dsBuildListFromStringsAlloc
@@ -965,10 +975,13 @@ tDirStatus dsAppendStringToListAlloc (	tDirReference	inDirRef,
 		pNewNodePriv->fScriptCode	= kASCIICodeScript;
 
 		inOutDataList->fDataNodeCount++;
+		dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 	}
 	else
 	{
-		pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
+		pCurrNode = dsDataListIndexGetNodePriv( inOutDataList, inOutDataList->fDataNodeCount );
+		if ( pCurrNode == nil )
+			pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
 		if ( pCurrNode != nil )
 		{
 			// Get the current node's header and point it to the new
@@ -984,6 +997,7 @@ tDirStatus dsAppendStringToListAlloc (	tDirReference	inDirRef,
 			pNewNodePriv->fScriptCode = kASCIICodeScript;
 
 			inOutDataList->fDataNodeCount++;
+			dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 		}
 		else
 		{
@@ -1077,6 +1091,8 @@ tDirStatus dsBuildListFromNodesAlloc (	tDirReference	inDirRef,
 		pCurrNode = nil;
 	}
 
+	dsDataListRebuildIndexPriv( inDataList );
+
 	return( tResult );
 
 } // dsBuildListFromNodesAlloc
@@ -1256,7 +1272,9 @@ tDirStatus dsDataListInsertAfter (	tDirReference			inDirRef,
 	}
 	else
 	{
-		pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
+		pCurrNode = dsDataListIndexGetNodePriv( inDataList, inIndex );
+		if ( pCurrNode == nil )
+			pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
 		if ( pCurrNode != nil )
 		{
 			// Get the current node's header and point it to the new
@@ -1295,6 +1313,9 @@ tDirStatus dsDataListInsertAfter (	tDirReference			inDirRef,
 		}
 	}
 
+	// positions after the insert point all moved
+	dsDataListRebuildIndexPriv( inDataList );
+
 	return( tResult );
 
 } // dsDataListInsertAfter
@@ -1418,6 +1439,8 @@ tDirStatus dsDataListMergeListAfter (	tDataList			   *inTargetList,
 		pCurrPrivData->fNextPtr = nil;
 	}
 
+	dsDataListRebuildIndexPriv( inTargetList );
+
 	return( tResult );
 
 } // dsDataListMergeListAfter
@@ -1458,7 +1481,11 @@ tDataListPtr dsDataListCopyList ( tDirReference inDirRef, const tDataList *inSou
 
 	for ( count = 1; count <= inSourceList->fDataNodeCount; count++ )
 	{
-		pCurrNode = ::dsGetThisNodePriv( inSourceList->fDataListHead, count );
+		// follow the chain rather than counting from the head for every node
+		if ( count == 1 )
+			pCurrNode = inSourceList->fDataListHead;
+		else if ( pCurrNode != nil )
+			pCurrNode = ((tDataBufferPriv *)pCurrNode)->fNextPtr;
 		if ( pCurrNode != nil )
 		{
 			// Duplicate the data into a new node
@@ -1502,6 +1529,7 @@ tDataListPtr dsDataListCopyList ( tDirReference inDirRef, const tDataList *inSou
 					pNewNode = nil;
 				}
 				pOutList->fDataNodeCount++;
+				dsDataListIndexAppendPriv( pOutList, (tDataNode *)pNewPrivData );
 			}
 		}
 	}
@@ -1572,7 +1600,9 @@ tDirStatus dsDataListDeleteThisNode (	tDirReference		inDirRef,
 	}
 
 	// Get the node we are looking for
-	pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
+	pCurrNode = dsDataListIndexGetNodePriv( inDataList, inIndex );
+	if ( pCurrNode == nil )
+		pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
 	if ( pCurrNode != nil )
 	{
 		pCurrPriv = (tDataBufferPriv *)pCurrNode;
@@ -1604,6 +1634,8 @@ tDirStatus dsDataListDeleteThisNode (	tDirReference		inDirRef,
 		pCurrNode = nil;
 
 		inDataList->fDataNodeCount--;
+
+		dsDataListRebuildIndexPriv( inDataList );
 	}
 
 	return( tResult );
@@ -1652,7 +1684,9 @@ tDirStatus dsDataListGetNodeAlloc ( tDirReference				inDirRef,
 		return( eDSEmptyDataList );
 	}
 
-	pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
+	pCurrNode = dsDataListIndexGetNodePriv( inDataList, inIndex );
+	if ( pCurrNode == nil )
+		pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
 	if ( pCurrNode == nil )
 	{
 		return( eDSIndexOutOfRange );
@@ -0,0 +1,130 @@
+/*
+ * Round trips every constant in CoreFramework/Private/DSStdConstants.h through the perfect hash that
+ * dsGetStdConstantID() uses.  Built and run by "CheckStdConstants.sh roundtrip", which pulls the hash
+ * out of DSUtils.cpp into DS_PERFECT_HASH_SOURCE so the code checked is the code that ships.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "DirServicesConst.h"
+
+#define DSFree(p)	do { free( (void *)(p) ); (p) = NULL; } while ( 0 )
+
+#include DS_PERFECT_HASH_SOURCE
+
+static const char *gStdConstantTable[] =
+{
+#define DS_STD_CONSTANT(name)	name,
+#include "DSStdConstants.h"
+#undef DS_STD_CONSTANT
+	NULL
+};
+
+static const char *gStdConstantNames[] =
+{
+#define DS_STD_CONSTANT(name)	#name,
+#include "DSStdConstants.h"
+#undef DS_STD_CONSTANT
+	NULL
+};
+
+// same expansion as DSUtils.h
+enum {
+#define DS_STD_CONSTANT(name)	kDSStdID_##name,
+#include "DSStdConstants.h"
+#undef DS_STD_CONSTANT
+	kDSStdIDCount
+};
+
+// strings that look like constants but are not in the table
+static const char *gNotConstants[] =
+{
+	kDSStdRecordTypePrefix,
+	kDSNativeRecordTypePrefix,
+	kDSStdAttrTypePrefix,
+	kDSNativeAttrTypePrefix,
+	kDSStdAuthMethodPrefix,
+	kDSNativeAuthMethodPrefix,
+	"",
+	NULL
+};
+
+int main( void )
+{
+	DSPerfectHash	hash	= { 0 };
+	uint32_t		count	= (sizeof(gStdConstantTable) / sizeof(const char *)) - 1;
+	int32_t			*values	= (int32_t *) calloc( count, sizeof(int32_t) );
+	int				errors	= 0;
+	int				aliases	= 0;
+	char			buffer[1024];
+
+	if ( count != kDSStdIDCount ) {
+		printf( "enum has %d ids for %u constants\n", (int) kDSStdIDCount, count );
+		return 1;
+	}
+
+	for ( uint32_t ii = 0; ii < count; ii++ )
+		values[ii] = (int32_t) ii;
+
+	if ( dsBuildPerfectHash(&hash, gStdConstantTable, values, count) == false ) {
+		printf( "unable to build the hash for %u constants\n", count );
+		return 1;
+	}
+
+	for ( uint32_t ii = 0; ii < count; ii++ )
+	{
+		int32_t	expected	= (int32_t) ii;
+		int32_t	value		= -1;
+
+		// names sharing a string resolve to the first one listed
+		for ( int32_t jj = 0; jj < (int32_t) ii; jj++ )
+		{
+			if ( strcmp(gStdConstantTable[jj], gStdConstantTable[ii]) == 0 ) {
+				expected = jj;
+				aliases++;
+				break;
+			}
+		}
+
+		if ( dsPerfectHashLookup(&hash, gStdConstantTable[ii], &value) == false ) {
+			printf( "%s (\"%s\") not found\n", gStdConstantNames[ii], gStdConstantTable[ii] );
+			errors++;
+		}
+		else if ( value != expected ) {
+			printf( "%s (\"%s\") returned %d, expected %d\n", gStdConstantNames[ii], gStdConstantTable[ii], value, expected );
+			errors++;
+		}
+
+		// a longer or shorter string must miss
+		snprintf( buffer, sizeof(buffer), "%sX", gStdConstantTable[ii] );
+		if ( dsPerfectHashLookup(&hash, buffer, &value) == true ) {
+			printf( "\"%s\" returned %d\n", buffer, value );
+			errors++;
+		}
+
+		snprintf( buffer, sizeof(buffer), "%.*s", (int) strlen(gStdConstantTable[ii]) - 1, gStdConstantTable[ii] );
+		if ( dsPerfectHashLookup(&hash, buffer, &value) == true && strcmp(gStdConstantTable[value], buffer) != 0 ) {
+			printf( "\"%s\" returned %d\n", buffer, value );
+			errors++;
+		}
+	}
+
+	for ( int ii = 0; gNotConstants[ii] != NULL; ii++ )
+	{
+		int32_t value = -1;
+
+		if ( dsPerfectHashLookup(&hash, gNotConstants[ii], &value) == true ) {
+			printf( "\"%s\" returned %d\n", gNotConstants[ii], value );
+			errors++;
+		}
+	}
+
+	printf( "%u constants, %d aliases, %d errors\n", count, aliases, errors );
+
+	DSFree( values );
+
+	return (errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,49 @@
+#!/bin/sh
+
+# Checks that CoreFramework/Private/DSStdConstants.h covers every standard constant in the API header
+# with the ids it already handed out, i.e. that GenStdConstants.sh has been run.  Run from the top of the project.
+#
+# "CheckStdConstants.sh roundtrip" instead builds CheckStdConstants.cpp against the perfect hash in DSUtils.cpp
+# and looks every constant up, checking it comes back with its own id (or the first id for an alias).
+
+CHECKED=/tmp/DSStdConstantsChecked.h
+
+if [ "$1" = "roundtrip" ]; then
+	HASH=/tmp/DSPerfectHash.$$.h
+	TOOL=/tmp/CheckStdConstants.$$
+
+	# the hash code, from the DSPerfectHash struct up to the function that fills in the DSUtils tables
+	sed -n '/^typedef struct DSPerfectHash/,/^static void dsBuildConstantHashes/p' CoreFramework/Private/DSUtils.cpp | sed '$d' > $HASH
+
+	c++ -o $TOOL -IAPIFramework -ICoreFramework/Private -DDS_PERFECT_HASH_SOURCE="\"$HASH\"" CheckStdConstants.cpp && $TOOL
+	STATUS=$?
+
+	rm -f $HASH $TOOL
+	exit $STATUS
+fi
+
+# regenerate next to the checked in copy
+./GenStdConstants.sh $CHECKED || exit 1
+
+# diff
+diff -u CoreFramework/Private/DSStdConstants.h $CHECKED > /dev/null
+STATUS=$?
+if [ $STATUS -ne 0 ]; then
+	echo ""
+	echo "--- == DSStdConstants.h is out of date, run GenStdConstants.sh"
+	echo ""
+	diff -u CoreFramework/Private/DSStdConstants.h $CHECKED
+fi
+
+# names sharing a string resolve to the first one listed
+echo ""
+echo "--- == Aliases, dsGetStdConstantID() returns the first listed"
+echo ""
+sed -n 's/^DS_STD_CONSTANT( \(.*\) )$/\1/p' $CHECKED | while read NAME; do
+	grep -E "^#define[[:space:]]+$NAME[[:space:]]+\"" APIFramework/DirServicesConst.h | head -1 | awk '{ print $3 }'
+done | sort | uniq -d
+
+# clean up
+rm $CHECKED
+
+exit $STATUS
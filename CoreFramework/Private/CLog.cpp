@@ -32,6 +32,11 @@
 #include <sys/types.h>				// for mode_t
 #include <sys/stat.h>				// for mkdir() and stat()
 #include <libkern/OSAtomic.h>
+#include <dispatch/dispatch.h>
+#include <pthread.h>
+#include <mach/mach_time.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #include "CLog.h"
 #include "COSUtils.h"
@@ -50,6 +55,126 @@ OptionBits	CLog::fInfoLogFlags		= kLogMeta;
 
 static passthru_logging_fn	passthru_log_message = NULL;
 
+// ----------------------------------------------------------------------------
+//	* Asynchronous logging
+//
+//	Formatted messages are put in a bounded lock-free ring (multiple producers,
+//	the writer queue is the only consumer) and handed to the passthru from the
+//	writer queue, so request threads never wait on the log transport.  The
+//	caller's request context is captured at enqueue time.  When the ring is
+//	full the message is dropped and counted rather than blocking the caller.
+// ----------------------------------------------------------------------------
+
+#define kAsyncLogRingSize	4096	// must be a power of 2
+
+typedef struct sAsyncLogRecord
+{
+	volatile uint64_t	fSequence;
+	int32_t				fLevel;
+	bool				fSession;
+	uint64_t			fReqID;
+	char				*fMessage;
+} sAsyncLogRecord;
+
+static sAsyncLogRecord						*gAsyncLogRing			= NULL;
+static volatile uint64_t					gAsyncLogHead			= 0;	// next slot to fill
+static uint64_t								gAsyncLogTail			= 0;	// next slot to drain, writer queue only
+static volatile uint32_t					gAsyncLogDropped		= 0;
+static volatile uint32_t					gAsyncLogScheduled		= 0;
+static dispatch_queue_t						gAsyncLogQueue			= NULL;
+static passthru_logging_context_fn			gAsyncLogContext		= NULL;
+static passthru_logging_context_message_fn	gAsyncLogMessage		= NULL;
+
+static void AsyncLogDrain( void *inContext )
+{
+	do
+	{
+		sAsyncLogRecord *record = &gAsyncLogRing[gAsyncLogTail & (kAsyncLogRingSize - 1)];
+		
+		while ( record->fSequence == gAsyncLogTail + 1 )
+		{
+			gAsyncLogMessage( record->fLevel, record->fMessage, record->fReqID, record->fSession );
+			free( record->fMessage );
+			record->fMessage = NULL;
+			
+			// hand the slot back to the producers for the next lap
+			__sync_synchronize();
+			record->fSequence = gAsyncLogTail + kAsyncLogRingSize;
+			
+			gAsyncLogTail++;
+			record = &gAsyncLogRing[gAsyncLogTail & (kAsyncLogRingSize - 1)];
+		}
+		
+		uint32_t dropped = __sync_lock_test_and_set( &gAsyncLogDropped, 0 );
+		if ( dropped != 0 )
+		{
+			char message[128];
+			
+			snprintf( message, sizeof(message), "CLog: %u log messages were dropped, the log queue was full", dropped );
+			gAsyncLogMessage( kLogError, message, 0, false );
+		}
+		
+		__sync_lock_release( &gAsyncLogScheduled );
+		__sync_synchronize();
+		
+		// anything enqueued after the last check but before the release needs another pass
+	} while ( gAsyncLogRing[gAsyncLogTail & (kAsyncLogRingSize - 1)].fSequence == gAsyncLogTail + 1 &&
+			  __sync_bool_compare_and_swap(&gAsyncLogScheduled, 0, 1) );
+}
+
+static void AsyncLogEnqueue( int32_t inLevel, const char *inMessage )
+{
+	uint64_t		position	= gAsyncLogHead;
+	sAsyncLogRecord	*record		= NULL;
+	
+	for ( ;; )
+	{
+		record = &gAsyncLogRing[position & (kAsyncLogRingSize - 1)];
+		
+		int64_t diff = (int64_t) record->fSequence - (int64_t) position;
+		if ( diff == 0 )
+		{
+			if ( __sync_bool_compare_and_swap(&gAsyncLogHead, position, position + 1) )
+				break;
+		}
+		else if ( diff < 0 )
+		{
+			__sync_add_and_fetch( &gAsyncLogDropped, 1 );
+			return;
+		}
+		
+		position = gAsyncLogHead;
+	}
+	
+	record->fLevel = inLevel;
+	record->fMessage = strdup( inMessage );
+	gAsyncLogContext( &record->fReqID, &record->fSession );
+	
+	__sync_synchronize();
+	record->fSequence = position + 1;
+	
+	if ( __sync_bool_compare_and_swap(&gAsyncLogScheduled, 0, 1) )
+		dispatch_async_f( gAsyncLogQueue, NULL, AsyncLogDrain );
+}
+
+static void PassthruLogMessage( int32_t inLevel, const char *inMessage )
+{
+	if ( gAsyncLogRing == NULL )
+	{
+		passthru_log_message( inLevel, inMessage );
+	}
+	else if ( (inLevel & (kLogEmergency | kLogAlert | kLogCritical | kLogError)) != 0 )
+	{
+		// errors often precede an abort, so they go out immediately after what is already queued
+		CLog::FlushAsyncLogging();
+		passthru_log_message( inLevel, inMessage );
+	}
+	else
+	{
+		AsyncLogEnqueue( inLevel, inMessage );
+	}
+}
+
 //--------------------------------------------------------------------------------------------------
 //	* Initialize()
 //
@@ -78,9 +203,51 @@ SInt32 CLog::Initialize (	OptionBits srvrFlags,	OptionBits errFlags,
 
 void CLog::Deinitialize ( void )
 {
+	FlushAsyncLogging();
 } // Deinitialize
 
 
+//--------------------------------------------------------------------------------------------------
+//	* StartAsyncLogging()
+//
+//--------------------------------------------------------------------------------------------------
+
+void CLog::StartAsyncLogging ( passthru_logging_context_fn inContextFn, passthru_logging_context_message_fn inMessageFn )
+{
+	if ( gAsyncLogRing != NULL || inContextFn == NULL || inMessageFn == NULL )
+		return;
+	
+	sAsyncLogRecord *ring = (sAsyncLogRecord *) calloc( kAsyncLogRingSize, sizeof(sAsyncLogRecord) );
+	if ( ring == NULL )
+		return;
+	
+	for ( uint64_t ii = 0; ii < kAsyncLogRingSize; ii++ )
+		ring[ii].fSequence = ii;
+	
+	gAsyncLogContext = inContextFn;
+	gAsyncLogMessage = inMessageFn;
+	gAsyncLogQueue = dispatch_queue_create( "CLog async writer", NULL );
+	
+	__sync_synchronize();
+	gAsyncLogRing = ring;
+} // StartAsyncLogging
+
+
+//--------------------------------------------------------------------------------------------------
+//	* FlushAsyncLogging()
+//
+//--------------------------------------------------------------------------------------------------
+
+void CLog::FlushAsyncLogging ( void )
+{
+	if ( gAsyncLogRing == NULL )
+		return;
+	
+	// the writer queue is serial, so once this runs everything enqueued before the call is out
+	dispatch_sync_f( gAsyncLogQueue, NULL, AsyncLogDrain );
+} // FlushAsyncLogging
+
+
 //--------------------------------------------------------------------------------------------------
 //	* StartLogging()
 //
@@ -596,7 +763,7 @@ void SrvrLog ( SInt32 lType, const char *szpPattern, ... )
 		bool isLogging = CLog::IsLogging(keDebugLog, lType); // no application log anymore, just direct to debug log
 		if (passthru_log_message != NULL && isLogging == true) {
 			CString message = CString(szpPattern, args);
-			passthru_log_message(lType, message.GetData());
+			PassthruLogMessage(lType, message.GetData());
 		}
 	}
 } // SrvrLog
@@ -613,7 +780,7 @@ void ErrLog ( SInt32 lType, const char *szpPattern, ... )
 		bool isLogging = CLog::IsLogging(keDebugLog, kLogError); // no error log anymore, just direct to debug log
 		if (passthru_log_message != NULL && isLogging == true) {
 			CString message = CString(szpPattern, args);
-			passthru_log_message(kLogError, message.GetData());
+			PassthruLogMessage(kLogError, message.GetData());
 		}
 	}
 } // ErrLog
@@ -632,14 +799,14 @@ void DbgLog ( SInt32 lType, const char *szpPattern, ... )
 		bool isLogging = CLog::IsLogging(keErrorLog, lType);
 		if (passthru_log_message != NULL && isLogging == true) {
 			CString message = CString(szpPattern, args);
-			passthru_log_message(lType, message.GetData());
+			PassthruLogMessage(lType, message.GetData());
 		}
 	}
 	else {
 		bool isLogging = CLog::IsLogging(keDebugLog, lType);
 		if (passthru_log_message != NULL && isLogging == true) {
 			CString message = CString(szpPattern, args);
-			passthru_log_message(lType, message.GetData());
+			PassthruLogMessage(lType, message.GetData());
 		}
 	}
 } // DbgLog
@@ -662,3 +829,443 @@ void InfoLog ( SInt32 lType, const char *szpPattern, ... )
 		}
 	}
 } // GetInfoLog
+
+
+#pragma mark -
+#pragma mark Binary trace
+
+// ----------------------------------------------------------------------------
+//	* DbgTrace
+//
+//	Each thread gets a ring of fixed size records holding the pattern pointer
+//	and the arguments as raw bytes, so recording is a copy instead of a format.
+//	Rings outlive their threads and are handed to new threads, so the trace
+//	from a thread that is gone is still there for DumpTrace.  When debug
+//	logging is on for the type the line is also logged like DbgLog.
+// ----------------------------------------------------------------------------
+
+#define kTraceRingCount		256		// records per thread, power of 2
+#define kTraceDataSize		100		// keeps a record at 128 bytes
+#define kTraceMaxString		48
+
+typedef struct sTraceRecord
+{
+	const char				*fPattern;	// NULL until the record is first written
+	uint64_t				fTime;
+	volatile uint32_t		fSequence;	// odd while the record is being written
+	int32_t					fLevel;
+	uint32_t				fLength;
+	uint8_t					fData[kTraceDataSize];
+} sTraceRecord;
+
+typedef struct sTraceRing
+{
+	sTraceRecord			fRecords[kTraceRingCount];
+	uint32_t				fNext;
+	volatile uint32_t		fInUse;
+	pthread_t				fThread;
+	struct sTraceRing		*fNextRing;
+} sTraceRing;
+
+static sTraceRing * volatile	gTraceRings		= NULL;
+static pthread_key_t			gTraceRingKey;
+static pthread_once_t			gTraceRingOnce	= PTHREAD_ONCE_INIT;
+
+static void ReleaseTraceRing( void *inRing )
+{
+	__sync_lock_release( &((sTraceRing *) inRing)->fInUse );
+}
+
+static void CreateTraceRingKey( void )
+{
+	pthread_key_create( &gTraceRingKey, ReleaseTraceRing );
+}
+
+static sTraceRing *GetTraceRing( void )
+{
+	pthread_once( &gTraceRingOnce, CreateTraceRingKey );
+	
+	sTraceRing *ring = (sTraceRing *) pthread_getspecific( gTraceRingKey );
+	if ( ring != NULL )
+		return ring;
+	
+	for ( ring = gTraceRings; ring != NULL; ring = ring->fNextRing )
+	{
+		if ( __sync_lock_test_and_set(&ring->fInUse, 1) == 0 )
+			break;
+	}
+	
+	if ( ring == NULL )
+	{
+		ring = (sTraceRing *) calloc( 1, sizeof(sTraceRing) );
+		if ( ring == NULL )
+			return NULL;
+		
+		ring->fInUse = 1;
+		do {
+			ring->fNextRing = gTraceRings;
+		} while ( __sync_bool_compare_and_swap(&gTraceRings, ring->fNextRing, ring) == false );
+	}
+	
+	ring->fThread = pthread_self();
+	pthread_setspecific( gTraceRingKey, ring );
+	
+	return ring;
+}
+
+typedef enum {
+	kTraceArgNone = 0,
+	kTraceArgInt,
+	kTraceArgLong,
+	kTraceArgLongLong,
+	kTraceArgSize,
+	kTraceArgIntMax,
+	kTraceArgPtrDiff,
+	kTraceArgDouble,
+	kTraceArgString,
+	kTraceArgPointer,
+	kTraceArgUnsupported
+} eTraceArgType;
+
+// bytes an argument of the type takes in fData, strings are sized by their contents
+static size_t TraceArgSize( eTraceArgType inType )
+{
+	switch ( inType )
+	{
+		case kTraceArgInt:		return sizeof(int);
+		case kTraceArgLong:		return sizeof(long);
+		case kTraceArgLongLong:	return sizeof(long long);
+		case kTraceArgSize:		return sizeof(size_t);
+		case kTraceArgIntMax:	return sizeof(intmax_t);
+		case kTraceArgPtrDiff:	return sizeof(ptrdiff_t);
+		case kTraceArgDouble:	return sizeof(double);
+		case kTraceArgPointer:	return sizeof(void *);
+		default:				return 0;
+	}
+}
+
+// walks one conversion spec starting at the '%', returns the argument type and where the spec ends
+static eTraceArgType ParseTraceSpec( const char *inSpec, const char **outEnd )
+{
+	const char		*p			= inSpec + 1;
+	eTraceArgType	intType		= kTraceArgInt;
+	
+	if ( *p == '%' ) {
+		(*outEnd) = p + 1;
+		return kTraceArgNone;
+	}
+	
+	while ( *p != '\0' && strchr("-+ #0", *p) != NULL ) p++;
+	while ( *p >= '0' && *p <= '9' ) p++;
+	if ( *p == '.' ) {
+		p++;
+		while ( *p >= '0' && *p <= '9' ) p++;
+	}
+	
+	// h and hh arguments are promoted to int
+	for ( ; *p != '\0' && strchr("hlqjzt", *p) != NULL; p++ )
+	{
+		switch ( *p )
+		{
+			case 'l': intType = (intType == kTraceArgLong ? kTraceArgLongLong : kTraceArgLong); break;
+			case 'q': intType = kTraceArgLongLong; break;
+			case 'j': intType = kTraceArgIntMax; break;
+			case 'z': intType = kTraceArgSize; break;
+			case 't': intType = kTraceArgPtrDiff; break;
+		}
+	}
+	
+	(*outEnd) = (*p != '\0' ? p + 1 : p);
+	
+	switch ( *p )
+	{
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+			return intType;
+		case 'c':
+			return kTraceArgInt;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			return kTraceArgDouble;
+		case 's':
+			return kTraceArgString;
+		case 'p':
+			return kTraceArgPointer;
+	}
+	
+	return kTraceArgUnsupported;
+}
+
+void DbgTrace ( SInt32 lType, const char *szpPattern, ... )
+{
+	if ( szpPattern == NULL )
+		return;
+	
+	va_list	args;
+	
+	if ( passthru_log_message != NULL && CLog::IsLogging(keDebugLog, lType) )
+	{
+		va_start( args, szpPattern );
+		CString message = CString( szpPattern, args );
+		PassthruLogMessage( lType, message.GetData() );
+		va_end( args );
+	}
+	
+	sTraceRing *ring = GetTraceRing();
+	if ( ring == NULL )
+		return;
+	
+	sTraceRecord	*record	= &ring->fRecords[ring->fNext++ & (kTraceRingCount - 1)];
+	uint32_t		length	= 0;
+	const char		*p		= szpPattern;
+	
+	record->fSequence++;
+	__sync_synchronize();
+	
+	record->fTime = mach_absolute_time();
+	record->fLevel = lType;
+	
+	va_start( args, szpPattern );
+	while ( (p = strchr(p, '%')) != NULL )
+	{
+		eTraceArgType	type	= ParseTraceSpec( p, &p );
+		size_t			size	= (type == kTraceArgString ? 1 : TraceArgSize(type));
+		
+		if ( type == kTraceArgNone )
+			continue;
+		if ( type == kTraceArgUnsupported )
+			break;
+		
+		if ( length + size > kTraceDataSize )
+			break;
+		
+		switch ( type )
+		{
+			case kTraceArgInt: {
+				int value = va_arg( args, int );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgLong: {
+				long value = va_arg( args, long );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgLongLong: {
+				long long value = va_arg( args, long long );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgSize: {
+				size_t value = va_arg( args, size_t );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgIntMax: {
+				intmax_t value = va_arg( args, intmax_t );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgPtrDiff: {
+				ptrdiff_t value = va_arg( args, ptrdiff_t );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgDouble: {
+				double value = va_arg( args, double );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgPointer: {
+				void *value = va_arg( args, void * );
+				memcpy( &record->fData[length], &value, sizeof(value) );
+				break;
+			}
+			case kTraceArgString: {
+				const char	*value		= va_arg( args, const char * );
+				size_t		available	= kTraceDataSize - length - 1;
+				
+				if ( value == NULL ) value = "(null)";
+				size = strnlen( value, (available < kTraceMaxString ? available : kTraceMaxString) );
+				memcpy( &record->fData[length], value, size );
+				record->fData[length + size] = '\0';
+				size++;
+				break;
+			}
+			default:
+				break;
+		}
+		
+		length += size;
+	}
+	va_end( args );
+	
+	record->fLength = length;
+	record->fPattern = szpPattern;
+	__sync_synchronize();
+	record->fSequence++;
+}
+
+// formats a record the way vsnprintf would have, running out of data just ends the line
+static void DecodeTraceRecord( const sTraceRecord *inRecord, char *outLine, size_t inLineSize )
+{
+	const char	*p			= inRecord->fPattern;
+	uint32_t	length		= (inRecord->fLength < kTraceDataSize ? inRecord->fLength : kTraceDataSize);
+	uint32_t	offset		= 0;
+	size_t		used		= 0;
+	
+	outLine[0] = '\0';
+	
+	while ( *p != '\0' && used < inLineSize - 1 )
+	{
+		const char *spec = strchr( p, '%' );
+		if ( spec == NULL ) {
+			used += strlcpy( outLine + used, p, inLineSize - used );
+			break;
+		}
+		
+		// literal text up to the conversion
+		size_t literal = spec - p;
+		if ( literal >= inLineSize - used ) literal = inLineSize - used - 1;
+		memcpy( outLine + used, p, literal );
+		used += literal;
+		outLine[used] = '\0';
+		
+		const char		*end	= NULL;
+		eTraceArgType	type	= ParseTraceSpec( spec, &end );
+		size_t			size	= TraceArgSize( type );
+		const uint8_t	*data	= &inRecord->fData[offset];
+		char			format[32];
+		int				written	= 0;
+		
+		strlcpy( format, spec, ((size_t)(end - spec) + 1 < sizeof(format) ? (size_t)(end - spec) + 1 : sizeof(format)) );
+		p = end;
+		
+		if ( type == kTraceArgNone ) {
+			written = snprintf( outLine + used, inLineSize - used, "%%" );
+		}
+		else if ( type == kTraceArgString ) {
+			// a string has to end inside the payload
+			size_t valueLen = (offset < length ? strnlen((const char *) data, length - offset) : 0);
+			if ( offset + valueLen >= length ) {
+				strlcat( outLine, "...", inLineSize );
+				break;
+			}
+			offset += valueLen + 1;
+			written = snprintf( outLine + used, inLineSize - used, format, (const char *) data );
+		}
+		else if ( size == 0 || offset + size > length ) {
+			strlcat( outLine, "...", inLineSize );
+			break;
+		}
+		else {
+			offset += size;
+			
+			switch ( type )
+			{
+				case kTraceArgInt: {
+					int value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgLong: {
+					long value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgLongLong: {
+					long long value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgSize: {
+					size_t value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgIntMax: {
+					intmax_t value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgPtrDiff: {
+					ptrdiff_t value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgDouble: {
+					double value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				case kTraceArgPointer: {
+					void *value;
+					memcpy( &value, data, sizeof(value) );
+					written = snprintf( outLine + used, inLineSize - used, format, value );
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		
+		if ( written > 0 )
+			used += ((size_t) written < inLineSize - used ? (size_t) written : inLineSize - used - 1);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------
+//	* DumpTrace()
+//
+//--------------------------------------------------------------------------------------------------
+
+void CLog::DumpTrace ( FILE *inFile )
+{
+	mach_timebase_info_data_t	timebase;
+	uint64_t					now		= mach_absolute_time();
+	char						line[512];
+	
+	if ( inFile == NULL )
+		return;
+	
+	mach_timebase_info( &timebase );
+	
+	fprintf( inFile, "Debug trace (most recent last, times in seconds before this dump):\n" );
+	
+	for ( sTraceRing *ring = gTraceRings; ring != NULL; ring = ring->fNextRing )
+	{
+		uint32_t next = ring->fNext;
+		
+		fprintf( inFile, "\nThread %p%s:\n", (void *) ring->fThread, (ring->fInUse ? "" : " (exited)") );
+		
+		for ( uint32_t ii = 0; ii < kTraceRingCount; ii++ )
+		{
+			sTraceRecord	*record		= &ring->fRecords[(next + ii) & (kTraceRingCount - 1)];
+			sTraceRecord	snapshot;
+			uint32_t		sequence	= record->fSequence;
+			
+			// the owning thread may be rewriting the record, only decode a copy that was not torn
+			if ( (sequence & 1) != 0 )
+				continue;
+			
+			__sync_synchronize();
+			memcpy( &snapshot, record, sizeof(snapshot) );
+			__sync_synchronize();
+			
+			if ( record->fSequence != sequence || snapshot.fPattern == NULL || snapshot.fTime > now )
+				continue;
+			
+			double age = (double) ((now - snapshot.fTime) * timebase.numer / timebase.denom) / NSEC_PER_SEC;
+			
+			DecodeTraceRecord( &snapshot, line, sizeof(line) );
+			fprintf( inFile, "\t-%.6f\t%08X\t%s\n", age, (uint32_t) snapshot.fLevel, line );
+		}
+	}
+	
+	fprintf( inFile, "\n" );
+} // DumpTrace
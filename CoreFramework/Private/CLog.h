@@ -30,6 +30,7 @@
 #define __CLog_h__	1
 
 #include <stdarg.h>		// for inline functions
+#include <stdio.h>		// for FILE
 
 #include <DirectoryServiceCore/PrivateTypes.h>
 
@@ -51,6 +52,8 @@ typedef enum {
 } eLogType;
 
 typedef bool (*passthru_logging_fn)(int32_t level, const char *message);
+typedef void (*passthru_logging_context_fn)(uint64_t *reqid, bool *session);
+typedef bool (*passthru_logging_context_message_fn)(int32_t level, const char *message, uint64_t reqid, bool session);
 
 //-----------------------------------------------------------------------------
 //	* CLog: a little more than your basic log class.
@@ -94,6 +97,9 @@ public:
 											passthru_logging_fn passthru = NULL
 										 );
 	static void		Deinitialize		( void );
+	static void		StartAsyncLogging	( passthru_logging_context_fn inContextFn, passthru_logging_context_message_fn inMessageFn );
+	static void		FlushAsyncLogging	( void );
+	static void		DumpTrace			( FILE *inFile );
 	static void		StartLogging		( eLogType inWhichLog, UInt32 inFlag );
 	static void		StopLogging			( eLogType inWhichLog, UInt32 inFlag );
 	static void		SetLoggingPriority	( eLogType inWhichLog, UInt32 inPriority );
@@ -184,6 +190,12 @@ void SrvrLog ( SInt32 lType, const char *szpPattern, ... );
 void ErrLog ( SInt32 lType, const char *szpPattern, ... );
 void DbgLog ( SInt32 lType, const char *szpPattern, ... );
 void InfoLog ( SInt32 lType, const char *szpPattern, ... );
+
+// Records the pattern and raw arguments in a per-thread trace ring without formatting, for
+// high volume debug lines, and logs them like DbgLog when debug logging is on for lType.  Only
+// standard printf conversions are supported, the pattern must be a string constant and %s
+// arguments are truncated.  Decoded by CLog::DumpTrace.
+void DbgTrace ( SInt32 lType, const char *szpPattern, ... );
 __END_DECLS
 
 #define LoggingEnabled(a)		CLog::IsLogging(keDebugLog,a)
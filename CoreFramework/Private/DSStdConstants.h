@@ -0,0 +1,350 @@
+/*
+ * Generated by GenStdConstants.sh from APIFramework/DirServicesConst.h, do not edit.
+ *
+ * Expanded into the dsGetStdConstantID() table in DSUtils.cpp and the kDSStdID_ enum in DSUtils.h,
+ * define DS_STD_CONSTANT(name) before including.
+ * A constant's id is its position in this list and never changes, new constants are appended.
+ */
+
+DS_STD_CONSTANT( kDSStdRecordTypeAll )
+DS_STD_CONSTANT( kDSStdRecordTypePlugins )
+DS_STD_CONSTANT( kDSStdRecordTypeRefTableEntries )
+DS_STD_CONSTANT( kDSStdRecordTypeRecordTypes )
+DS_STD_CONSTANT( kDSStdRecordTypeAttributeTypes )
+DS_STD_CONSTANT( kDSStdRecordTypeAccessControls )
+DS_STD_CONSTANT( kDSStdRecordTypeAFPServer )
+DS_STD_CONSTANT( kDSStdRecordTypeAFPUserAliases )
+DS_STD_CONSTANT( kDSStdRecordTypeAliases )
+DS_STD_CONSTANT( kDSStdRecordTypeAugments )
+DS_STD_CONSTANT( kDSStdRecordTypeAutomount )
+DS_STD_CONSTANT( kDSStdRecordTypeAutomountMap )
+DS_STD_CONSTANT( kDSStdRecordTypeAutoServerSetup )
+DS_STD_CONSTANT( kDSStdRecordTypeBootp )
+DS_STD_CONSTANT( kDSStdRecordTypeCertificateAuthorities )
+DS_STD_CONSTANT( kDSStdRecordTypeComputerLists )
+DS_STD_CONSTANT( kDSStdRecordTypeComputerGroups )
+DS_STD_CONSTANT( kDSStdRecordTypeComputers )
+DS_STD_CONSTANT( kDSStdRecordTypeConfig )
+DS_STD_CONSTANT( kDSStdRecordTypeEthernets )
+DS_STD_CONSTANT( kDSStdRecordTypeFileMakerServers )
+DS_STD_CONSTANT( kDSStdRecordTypeFTPServer )
+DS_STD_CONSTANT( kDSStdRecordTypeGroupAliases )
+DS_STD_CONSTANT( kDSStdRecordTypeGroups )
+DS_STD_CONSTANT( kDSStdRecordTypeHostServices )
+DS_STD_CONSTANT( kDSStdRecordTypeHosts )
+DS_STD_CONSTANT( kDSStdRecordTypeLDAPServer )
+DS_STD_CONSTANT( kDSStdRecordTypeLocations )
+DS_STD_CONSTANT( kDSStdRecordTypeMachines )
+DS_STD_CONSTANT( kDSStdRecordTypeMeta )
+DS_STD_CONSTANT( kDSStdRecordTypeMounts )
+DS_STD_CONSTANT( kDSStdRecordTypeNeighborhoods )
+DS_STD_CONSTANT( kDSStdRecordTypeNFS )
+DS_STD_CONSTANT( kDSStdRecordTypeNetDomains )
+DS_STD_CONSTANT( kDSStdRecordTypeNetGroups )
+DS_STD_CONSTANT( kDSStdRecordTypeNetworks )
+DS_STD_CONSTANT( kDSStdRecordTypePasswordServer )
+DS_STD_CONSTANT( kDSStdRecordTypePeople )
+DS_STD_CONSTANT( kDSStdRecordTypePresetComputers )
+DS_STD_CONSTANT( kDSStdRecordTypePresetComputerGroups )
+DS_STD_CONSTANT( kDSStdRecordTypePresetComputerLists )
+DS_STD_CONSTANT( kDSStdRecordTypePresetGroups )
+DS_STD_CONSTANT( kDSStdRecordTypePresetUsers )
+DS_STD_CONSTANT( kDSStdRecordTypePrintService )
+DS_STD_CONSTANT( kDSStdRecordTypePrintServiceUser )
+DS_STD_CONSTANT( kDSStdRecordTypePrinters )
+DS_STD_CONSTANT( kDSStdRecordTypeProtocols )
+DS_STD_CONSTANT( kDSStdRecordTypeQTSServer )
+DS_STD_CONSTANT( kDSStdRecordTypeResources )
+DS_STD_CONSTANT( kDSStdRecordTypeRPC )
+DS_STD_CONSTANT( kDSStdRecordTypeSMBServer )
+DS_STD_CONSTANT( kDSStdRecordTypeServer )
+DS_STD_CONSTANT( kDSStdRecordTypeServices )
+DS_STD_CONSTANT( kDSStdRecordTypeSharePoints )
+DS_STD_CONSTANT( kDSStdRecordTypeUserAliases )
+DS_STD_CONSTANT( kDSStdRecordTypeUsers )
+DS_STD_CONSTANT( kDSStdRecordTypeWebServer )
+DS_STD_CONSTANT( kDS1AttrAdminLimits )
+DS_STD_CONSTANT( kDS1AttrAliasData )
+DS_STD_CONSTANT( kDS1AttrAlternateDatastoreLocation )
+DS_STD_CONSTANT( kDS1AttrAuthenticationHint )
+DS_STD_CONSTANT( kDSNAttrAttributeTypes )
+DS_STD_CONSTANT( kDS1AttrAuthorityRevocationList )
+DS_STD_CONSTANT( kDS1AttrBirthday )
+DS_STD_CONSTANT( kDS1AttrBootFile )
+DS_STD_CONSTANT( kDS1AttrCACertificate )
+DS_STD_CONSTANT( kDS1AttrCapabilities )
+DS_STD_CONSTANT( kDS1AttrCapacity )
+DS_STD_CONSTANT( kDS1AttrCategory )
+DS_STD_CONSTANT( kDS1AttrCertificateRevocationList )
+DS_STD_CONSTANT( kDS1AttrChange )
+DS_STD_CONSTANT( kDS1AttrComment )
+DS_STD_CONSTANT( kDS1AttrContactGUID )
+DS_STD_CONSTANT( kDS1AttrContactPerson )
+DS_STD_CONSTANT( kDS1AttrCreationTimestamp )
+DS_STD_CONSTANT( kDS1AttrCrossCertificatePair )
+DS_STD_CONSTANT( kDS1AttrDataStamp )
+DS_STD_CONSTANT( kDS1AttrDistinguishedName )
+DS_STD_CONSTANT( kDS1AttrDNSDomain )
+DS_STD_CONSTANT( kDS1AttrDNSNameServer )
+DS_STD_CONSTANT( kDS1AttrENetAddress )
+DS_STD_CONSTANT( kDS1AttrExpire )
+DS_STD_CONSTANT( kDS1AttrFirstName )
+DS_STD_CONSTANT( kDS1AttrGeneratedUID )
+DS_STD_CONSTANT( kDS1AttrHomeDirectoryQuota )
+DS_STD_CONSTANT( kDS1AttrHomeDirectorySoftQuota )
+DS_STD_CONSTANT( kDS1AttrHomeLocOwner )
+DS_STD_CONSTANT( kDS1AttrInternetAlias )
+DS_STD_CONSTANT( kDS1AttrKDCConfigData )
+DS_STD_CONSTANT( kDS1AttrLastName )
+DS_STD_CONSTANT( kDS1AttrLDAPSearchBaseSuffix )
+DS_STD_CONSTANT( kDS1AttrLocation )
+DS_STD_CONSTANT( kDS1AttrMapGUID )
+DS_STD_CONSTANT( kDS1AttrMCXFlags )
+DS_STD_CONSTANT( kDS1AttrMCXSettings )
+DS_STD_CONSTANT( kDS1AttrMailAttribute )
+DS_STD_CONSTANT( kDS1AttrMetaAutomountMap )
+DS_STD_CONSTANT( kDS1AttrMiddleName )
+DS_STD_CONSTANT( kDS1AttrModificationTimestamp )
+DS_STD_CONSTANT( kDSNAttrNeighborhoodAlias )
+DS_STD_CONSTANT( kDS1AttrNeighborhoodType )
+DS_STD_CONSTANT( kDS1AttrNetworkView )
+DS_STD_CONSTANT( kDS1AttrNFSHomeDirectory )
+DS_STD_CONSTANT( kDS1AttrNote )
+DS_STD_CONSTANT( kDS1AttrOwner )
+DS_STD_CONSTANT( kDS1AttrOwnerGUID )
+DS_STD_CONSTANT( kDS1AttrPassword )
+DS_STD_CONSTANT( kDS1AttrPasswordPlus )
+DS_STD_CONSTANT( kDS1AttrPasswordPolicyOptions )
+DS_STD_CONSTANT( kDS1AttrPasswordServerList )
+DS_STD_CONSTANT( kDS1AttrPasswordServerLocation )
+DS_STD_CONSTANT( kDS1AttrPicture )
+DS_STD_CONSTANT( kDS1AttrPort )
+DS_STD_CONSTANT( kDS1AttrPresetUserIsAdmin )
+DS_STD_CONSTANT( kDS1AttrPrimaryComputerGUID )
+DS_STD_CONSTANT( kDS1AttrPrimaryComputerList )
+DS_STD_CONSTANT( kDS1AttrPrimaryGroupID )
+DS_STD_CONSTANT( kDS1AttrPrinter1284DeviceID )
+DS_STD_CONSTANT( kDS1AttrPrinterLPRHost )
+DS_STD_CONSTANT( kDS1AttrPrinterLPRQueue )
+DS_STD_CONSTANT( kDS1AttrPrinterMakeAndModel )
+DS_STD_CONSTANT( kDS1AttrPrinterType )
+DS_STD_CONSTANT( kDS1AttrPrinterURI )
+DS_STD_CONSTANT( kDSNAttrPrinterXRISupported )
+DS_STD_CONSTANT( kDS1AttrPrintServiceInfoText )
+DS_STD_CONSTANT( kDS1AttrPrintServiceInfoXML )
+DS_STD_CONSTANT( kDS1AttrPrintServiceUserData )
+DS_STD_CONSTANT( kDS1AttrRealUserID )
+DS_STD_CONSTANT( kDS1AttrSMBAcctFlags )
+DS_STD_CONSTANT( kDS1AttrSMBGroupRID )
+DS_STD_CONSTANT( kDS1AttrSMBHome )
+DS_STD_CONSTANT( kDS1AttrSMBHomeDrive )
+DS_STD_CONSTANT( kDS1AttrSMBKickoffTime )
+DS_STD_CONSTANT( kDS1AttrSMBLogoffTime )
+DS_STD_CONSTANT( kDS1AttrSMBLogonTime )
+DS_STD_CONSTANT( kDS1AttrSMBPrimaryGroupSID )
+DS_STD_CONSTANT( kDS1AttrSMBPWDLastSet )
+DS_STD_CONSTANT( kDS1AttrSMBProfilePath )
+DS_STD_CONSTANT( kDS1AttrSMBRID )
+DS_STD_CONSTANT( kDS1AttrSMBScriptPath )
+DS_STD_CONSTANT( kDS1AttrSMBSID )
+DS_STD_CONSTANT( kDS1AttrSMBUserWorkstations )
+DS_STD_CONSTANT( kDS1AttrServiceType )
+DS_STD_CONSTANT( kDS1AttrSetupAdvertising )
+DS_STD_CONSTANT( kDS1AttrSetupAutoRegister )
+DS_STD_CONSTANT( kDS1AttrSetupLocation )
+DS_STD_CONSTANT( kDS1AttrSetupOccupation )
+DS_STD_CONSTANT( kDS1AttrTimeToLive )
+DS_STD_CONSTANT( kDS1AttrUniqueID )
+DS_STD_CONSTANT( kDS1AttrUserCertificate )
+DS_STD_CONSTANT( kDS1AttrUserPKCS12Data )
+DS_STD_CONSTANT( kDS1AttrUserShell )
+DS_STD_CONSTANT( kDS1AttrUserSMIMECertificate )
+DS_STD_CONSTANT( kDS1AttrVFSDumpFreq )
+DS_STD_CONSTANT( kDS1AttrVFSLinkDir )
+DS_STD_CONSTANT( kDS1AttrVFSPassNo )
+DS_STD_CONSTANT( kDS1AttrVFSType )
+DS_STD_CONSTANT( kDS1AttrWeblogURI )
+DS_STD_CONSTANT( kDS1AttrXMLPlist )
+DS_STD_CONSTANT( kDS1AttrProtocolNumber )
+DS_STD_CONSTANT( kDS1AttrRPCNumber )
+DS_STD_CONSTANT( kDS1AttrNetworkNumber )
+DS_STD_CONSTANT( kDSNAttrAccessControlEntry )
+DS_STD_CONSTANT( kDSNAttrAddressLine1 )
+DS_STD_CONSTANT( kDSNAttrAddressLine2 )
+DS_STD_CONSTANT( kDSNAttrAddressLine3 )
+DS_STD_CONSTANT( kDSNAttrAreaCode )
+DS_STD_CONSTANT( kDSNAttrAuthenticationAuthority )
+DS_STD_CONSTANT( kDSNAttrAutomountInformation )
+DS_STD_CONSTANT( kDSNAttrBootParams )
+DS_STD_CONSTANT( kDSNAttrBuilding )
+DS_STD_CONSTANT( kDSNAttrServicesLocator )
+DS_STD_CONSTANT( kDSNAttrCity )
+DS_STD_CONSTANT( kDSNAttrCompany )
+DS_STD_CONSTANT( kDSNAttrComputerAlias )
+DS_STD_CONSTANT( kDSNAttrComputers )
+DS_STD_CONSTANT( kDSNAttrCountry )
+DS_STD_CONSTANT( kDSNAttrDepartment )
+DS_STD_CONSTANT( kDSNAttrDNSName )
+DS_STD_CONSTANT( kDSNAttrEMailAddress )
+DS_STD_CONSTANT( kDSNAttrEMailContacts )
+DS_STD_CONSTANT( kDSNAttrFaxNumber )
+DS_STD_CONSTANT( kDSNAttrGroup )
+DS_STD_CONSTANT( kDSNAttrGroupMembers )
+DS_STD_CONSTANT( kDSNAttrGroupMembership )
+DS_STD_CONSTANT( kDSNAttrGroupServices )
+DS_STD_CONSTANT( kDSNAttrHomePhoneNumber )
+DS_STD_CONSTANT( kDSNAttrHTML )
+DS_STD_CONSTANT( kDSNAttrHomeDirectory )
+DS_STD_CONSTANT( kDSNAttrIMHandle )
+DS_STD_CONSTANT( kDSNAttrIPAddress )
+DS_STD_CONSTANT( kDSNAttrIPAddressAndENetAddress )
+DS_STD_CONSTANT( kDSNAttrIPv6Address )
+DS_STD_CONSTANT( kDSNAttrJPEGPhoto )
+DS_STD_CONSTANT( kDSNAttrJobTitle )
+DS_STD_CONSTANT( kDSNAttrKDCAuthKey )
+DS_STD_CONSTANT( kDSNAttrKeywords )
+DS_STD_CONSTANT( kDSNAttrLDAPReadReplicas )
+DS_STD_CONSTANT( kDSNAttrLDAPWriteReplicas )
+DS_STD_CONSTANT( kDSNAttrMachineServes )
+DS_STD_CONSTANT( kDSNAttrMapCoordinates )
+DS_STD_CONSTANT( kDSNAttrMapURI )
+DS_STD_CONSTANT( kDSNAttrMCXSettings )
+DS_STD_CONSTANT( kDSNAttrMIME )
+DS_STD_CONSTANT( kDSNAttrMember )
+DS_STD_CONSTANT( kDSNAttrMobileNumber )
+DS_STD_CONSTANT( kDSNAttrNBPEntry )
+DS_STD_CONSTANT( kDSNAttrNestedGroups )
+DS_STD_CONSTANT( kDSNAttrNetGroups )
+DS_STD_CONSTANT( kDSNAttrNickName )
+DS_STD_CONSTANT( kDSNAttrNodePathXMLPlist )
+DS_STD_CONSTANT( kDSNAttrOrganizationInfo )
+DS_STD_CONSTANT( kDSNAttrOrganizationName )
+DS_STD_CONSTANT( kDSNAttrPagerNumber )
+DS_STD_CONSTANT( kDSNAttrPhoneContacts )
+DS_STD_CONSTANT( kDSNAttrPhoneNumber )
+DS_STD_CONSTANT( kDSNAttrPGPPublicKey )
+DS_STD_CONSTANT( kDSNAttrPostalAddress )
+DS_STD_CONSTANT( kDSNAttrPostalAddressContacts )
+DS_STD_CONSTANT( kDSNAttrPostalCode )
+DS_STD_CONSTANT( kDSNAttrProtocols )
+DS_STD_CONSTANT( kDSNAttrRecordName )
+DS_STD_CONSTANT( kDSNAttrRelationships )
+DS_STD_CONSTANT( kDSNAttrResourceInfo )
+DS_STD_CONSTANT( kDSNAttrResourceType )
+DS_STD_CONSTANT( kDSNAttrState )
+DS_STD_CONSTANT( kDSNAttrStreet )
+DS_STD_CONSTANT( kDSNAttrNameSuffix )
+DS_STD_CONSTANT( kDSNAttrURL )
+DS_STD_CONSTANT( kDSNAttrURLForNSL )
+DS_STD_CONSTANT( kDSNAttrVFSOpts )
+DS_STD_CONSTANT( kDS1AttrAdminStatus )
+DS_STD_CONSTANT( kDS1AttrAlias )
+DS_STD_CONSTANT( kDS1AttrAuthCredential )
+DS_STD_CONSTANT( kDS1AttrCopyTimestamp )
+DS_STD_CONSTANT( kDS1AttrDateRecordCreated )
+DS_STD_CONSTANT( kDS1AttrKerberosRealm )
+DS_STD_CONSTANT( kDS1AttrNTDomainComputerAccount )
+DS_STD_CONSTANT( kDSNAttrOriginalHomeDirectory )
+DS_STD_CONSTANT( kDS1AttrOriginalNFSHomeDirectory )
+DS_STD_CONSTANT( kDS1AttrOriginalNodeName )
+DS_STD_CONSTANT( kDS1AttrPrimaryNTDomain )
+DS_STD_CONSTANT( kDS1AttrPwdAgingPolicy )
+DS_STD_CONSTANT( kDS1AttrRARA )
+DS_STD_CONSTANT( kDS1AttrReadOnlyNode )
+DS_STD_CONSTANT( kDS1AttrRecordImage )
+DS_STD_CONSTANT( kDS1AttrTimePackage )
+DS_STD_CONSTANT( kDS1AttrTotalSize )
+DS_STD_CONSTANT( kDSNAttrAllNames )
+DS_STD_CONSTANT( kDSNAttrAuthMethod )
+DS_STD_CONSTANT( kDSNAttrMetaNodeLocation )
+DS_STD_CONSTANT( kDSNAttrNodePath )
+DS_STD_CONSTANT( kDSNAttrPlugInInfo )
+DS_STD_CONSTANT( kDSNAttrRecordAlias )
+DS_STD_CONSTANT( kDSNAttrRecordType )
+DS_STD_CONSTANT( kDSNAttrSchema )
+DS_STD_CONSTANT( kDSNAttrSetPasswdMethod )
+DS_STD_CONSTANT( kDSNAttrSubNodes )
+DS_STD_CONSTANT( kDSNAttrNetGroupTriplet )
+DS_STD_CONSTANT( kDS1AttrSearchPath )
+DS_STD_CONSTANT( kDSNAttrSearchPath )
+DS_STD_CONSTANT( kDS1AttrSearchPolicy )
+DS_STD_CONSTANT( kDS1AttrNSPSearchPath )
+DS_STD_CONSTANT( kDSNAttrNSPSearchPath )
+DS_STD_CONSTANT( kDS1AttrLSPSearchPath )
+DS_STD_CONSTANT( kDSNAttrLSPSearchPath )
+DS_STD_CONSTANT( kDS1AttrCSPSearchPath )
+DS_STD_CONSTANT( kDSNAttrCSPSearchPath )
+DS_STD_CONSTANT( kDSStdAuth2WayRandom )
+DS_STD_CONSTANT( kDSStdAuth2WayRandomChangePasswd )
+DS_STD_CONSTANT( kDSStdAuthAPOP )
+DS_STD_CONSTANT( kDSStdAuthCHAP )
+DS_STD_CONSTANT( kDSStdAuthCRAM_MD5 )
+DS_STD_CONSTANT( kDSStdAuthChangePasswd )
+DS_STD_CONSTANT( kDSStdAuthClearText )
+DS_STD_CONSTANT( kDSStdAuthCrypt )
+DS_STD_CONSTANT( kDSStdAuthDIGEST_MD5 )
+DS_STD_CONSTANT( kDSStdAuthDeleteUser )
+DS_STD_CONSTANT( kDSStdAuthGetEffectivePolicy )
+DS_STD_CONSTANT( kDSStdAuthGetGlobalPolicy )
+DS_STD_CONSTANT( kDSStdAuthGetKerberosPrincipal )
+DS_STD_CONSTANT( kDSStdAuthGetPolicy )
+DS_STD_CONSTANT( kDSStdAuthGetUserData )
+DS_STD_CONSTANT( kDSStdAuthGetUserName )
+DS_STD_CONSTANT( kDSStdAuthKerberosTickets )
+DS_STD_CONSTANT( kDSStdAuthMASKE_A )
+DS_STD_CONSTANT( kDSStdAuthMASKE_B )
+DS_STD_CONSTANT( kDSStdAuthMPPEMasterKeys )
+DS_STD_CONSTANT( kDSStdAuthMSCHAP1 )
+DS_STD_CONSTANT( kDSStdAuthMSCHAP2 )
+DS_STD_CONSTANT( kDSStdAuthNTLMv2 )
+DS_STD_CONSTANT( kDSStdAuthNTLMv2WithSessionKey )
+DS_STD_CONSTANT( kDSStdAuthNewUser )
+DS_STD_CONSTANT( kDSStdAuthNewUserWithPolicy )
+DS_STD_CONSTANT( kDSStdAuthNodeNativeClearTextOK )
+DS_STD_CONSTANT( kDSStdAuthNodeNativeNoClearText )
+DS_STD_CONSTANT( kDSStdAuthReadSecureHash )
+DS_STD_CONSTANT( kDSStdAuthSMBNTv2UserSessionKey )
+DS_STD_CONSTANT( kDSStdAuthSMBWorkstationCredentialSessionKey )
+DS_STD_CONSTANT( kDSStdAuthSMB_LM_Key )
+DS_STD_CONSTANT( kDSStdAuthSMB_NT_Key )
+DS_STD_CONSTANT( kDSStdAuthSMB_NT_UserSessionKey )
+DS_STD_CONSTANT( kDSStdAuthSMB_NT_WithUserSessionKey )
+DS_STD_CONSTANT( kDSStdAuthSecureHash )
+DS_STD_CONSTANT( kDSStdAuthSetGlobalPolicy )
+DS_STD_CONSTANT( kDSStdAuthSetLMHash )
+DS_STD_CONSTANT( kDSStdAuthSetNTHash )
+DS_STD_CONSTANT( kDSStdAuthSetPasswd )
+DS_STD_CONSTANT( kDSStdAuthSetPasswdAsRoot )
+DS_STD_CONSTANT( kDSStdAuthSetPolicy )
+DS_STD_CONSTANT( kDSStdAuthSetPolicyAsRoot )
+DS_STD_CONSTANT( kDSStdAuthSetUserData )
+DS_STD_CONSTANT( kDSStdAuthSetUserName )
+DS_STD_CONSTANT( kDSStdAuthSetWorkstationPasswd )
+DS_STD_CONSTANT( kDSStdAuthWithAuthorizationRef )
+DS_STD_CONSTANT( kDSStdAuthWriteSecureHash )
+DS_STD_CONSTANT( kDSStdAuthGetMethodsForUser )
+DS_STD_CONSTANT( kDS1AttrBuildVersion )
+DS_STD_CONSTANT( kDS1AttrConfigAvail )
+DS_STD_CONSTANT( kDS1AttrConfigFile )
+DS_STD_CONSTANT( kDS1AttrCoreFWVersion )
+DS_STD_CONSTANT( kDS1AttrFunctionalState )
+DS_STD_CONSTANT( kDS1AttrFWVersion )
+DS_STD_CONSTANT( kDS1AttrPluginIndex )
+DS_STD_CONSTANT( kDS1AttrRefNumTableList )
+DS_STD_CONSTANT( kDS1AttrVersion )
+DS_STD_CONSTANT( kDS1AttrPIDValue )
+DS_STD_CONSTANT( kDS1AttrProcessName )
+DS_STD_CONSTANT( kDS1AttrTotalRefCount )
+DS_STD_CONSTANT( kDS1AttrDirRefCount )
+DS_STD_CONSTANT( kDS1AttrNodeRefCount )
+DS_STD_CONSTANT( kDS1AttrRecRefCount )
+DS_STD_CONSTANT( kDS1AttrAttrListRefCount )
+DS_STD_CONSTANT( kDS1AttrAttrListValueRefCount )
+DS_STD_CONSTANT( kDSNAttrDirRefs )
+DS_STD_CONSTANT( kDSNAttrNodeRefs )
+DS_STD_CONSTANT( kDSNAttrRecRefs )
+DS_STD_CONSTANT( kDSNAttrAttrListRefs )
+DS_STD_CONSTANT( kDSNAttrAttrListValueRefs )
+DS_STD_CONSTANT( kDSAttributesAll )
+DS_STD_CONSTANT( kDSAttributesNativeAll )
+DS_STD_CONSTANT( kDSAttributesStandardAll )
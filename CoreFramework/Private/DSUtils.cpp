@@ -27,6 +27,7 @@
 
 #include "CLog.h"
 #include "DSUtils.h"
+#include "DataListPriv.h"
 #include "SharedConsts.h"
 #include "GetMACAddress.h"
 #include <DirectoryService/DirServicesConst.h>
@@ -40,6 +41,8 @@
 #include <mach/mach_time.h>	// for dsTimeStamp
 #include <syslog.h>			// for syslog()
 #include <sys/sysctl.h>		// for struct kinfo_proc and sysctl()
+#include <malloc/malloc.h>	// for malloc_size()
+#include <pthread.h>
 
 
 typedef struct AuthMethodMap {
@@ -110,6 +113,200 @@ AuthMethodMap gAuthMethodTable[] =
 	{ NULL, 0 }
 };
 
+static const char *gStdConstantTable[] =
+{
+#define DS_STD_CONSTANT(name)	name,
+#include "DSStdConstants.h"
+#undef DS_STD_CONSTANT
+	NULL
+};
+
+//--------------------------------------------------------------------------------------------------
+//	Perfect hash over a fixed string table (hash and displace).  Keys are spread over buckets by one
+//	hash, then each bucket picks a seed for a second hash that lands all of its keys in free slots,
+//	so a lookup is two hashes and a single strcmp.  Tables are built once on first use.
+//--------------------------------------------------------------------------------------------------
+
+typedef struct DSPerfectHash {
+	const char	**fKeys;		// slot -> key, NULL when empty
+	int32_t		*fValues;
+	uint32_t	*fSeeds;		// bucket -> seed for the slot hash
+	uint32_t	fBucketCount;
+	uint32_t	fSlotMask;
+} DSPerfectHash;
+
+static DSPerfectHash	gAuthMethodHash;
+static DSPerfectHash	gStdConstantHash;
+static pthread_once_t	gConstantHashOnce	= PTHREAD_ONCE_INIT;
+
+static inline uint32_t dsConstantHash( const char *inKey, uint32_t inSeed )
+{
+	uint32_t	hash	= 2166136261U ^ (inSeed * 0x9E3779B9U);
+	
+	for ( const unsigned char *ptr = (const unsigned char *) inKey; (*ptr) != '\0'; ptr++ )
+		hash = (hash ^ (*ptr)) * 16777619U;
+	
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6DU;
+	hash ^= hash >> 12;
+	
+	return hash;
+}
+
+static bool dsBuildPerfectHash( DSPerfectHash *ioHash, const char **inKeys, const int32_t *inValues, uint32_t inCount )
+{
+	uint32_t	slotCount	= 1;
+	uint32_t	bucketCount	= (inCount / 4) + 1;
+	uint32_t	*bucketOf	= (uint32_t *) calloc( inCount, sizeof(uint32_t) );
+	uint32_t	*order		= (uint32_t *) calloc( bucketCount, sizeof(uint32_t) );
+	uint32_t	*sizes		= (uint32_t *) calloc( bucketCount, sizeof(uint32_t) );
+	uint32_t	*pending	= (uint32_t *) calloc( inCount, sizeof(uint32_t) );
+	bool		success		= true;
+	
+	while ( slotCount < inCount * 2 )
+		slotCount <<= 1;
+	
+	ioHash->fKeys = (const char **) calloc( slotCount, sizeof(const char *) );
+	ioHash->fValues = (int32_t *) calloc( slotCount, sizeof(int32_t) );
+	ioHash->fSeeds = (uint32_t *) calloc( bucketCount, sizeof(uint32_t) );
+	ioHash->fBucketCount = bucketCount;
+	ioHash->fSlotMask = slotCount - 1;
+	
+	for ( uint32_t ii = 0; ii < inCount; ii++ )
+	{
+		bucketOf[ii] = dsConstantHash( inKeys[ii], 0 ) % bucketCount;
+		sizes[bucketOf[ii]]++;
+	}
+	
+	// biggest buckets first while the table is still mostly empty
+	for ( uint32_t ii = 0; ii < bucketCount; ii++ )
+		order[ii] = ii;
+	
+	for ( uint32_t ii = 1; ii < bucketCount; ii++ )
+	{
+		uint32_t bucket = order[ii];
+		uint32_t jj = ii;
+		
+		for ( ; jj > 0 && sizes[order[jj - 1]] < sizes[bucket]; jj-- )
+			order[jj] = order[jj - 1];
+		order[jj] = bucket;
+	}
+	
+	for ( uint32_t ii = 0; ii < bucketCount && sizes[order[ii]] > 0 && success; ii++ )
+	{
+		uint32_t	bucket		= order[ii];
+		uint32_t	count		= 0;
+		uint32_t	seed;
+		
+		// duplicate names always share a bucket, the first one in the table wins like the old linear search
+		for ( uint32_t key = 0; key < inCount; key++ )
+		{
+			if ( bucketOf[key] != bucket )
+				continue;
+			
+			uint32_t jj = 0;
+			for ( ; jj < count && strcmp(inKeys[pending[jj]], inKeys[key]) != 0; jj++ )
+				;
+			if ( jj == count )
+				pending[count++] = key;
+		}
+		
+		for ( seed = 1; seed < 1000000; seed++ )
+		{
+			uint32_t jj = 0;
+			
+			for ( ; jj < count; jj++ )
+			{
+				uint32_t slot = dsConstantHash( inKeys[pending[jj]], seed ) & ioHash->fSlotMask;
+				if ( ioHash->fKeys[slot] != NULL )
+					break;
+				
+				// claim it now so two keys of this bucket can't share the slot
+				ioHash->fKeys[slot] = inKeys[pending[jj]];
+			}
+			
+			if ( jj == count )
+				break;
+			
+			while ( jj-- > 0 )
+				ioHash->fKeys[dsConstantHash(inKeys[pending[jj]], seed) & ioHash->fSlotMask] = NULL;
+		}
+		
+		if ( seed == 1000000 ) {
+			success = false;
+			break;
+		}
+		
+		ioHash->fSeeds[bucket] = seed;
+		for ( uint32_t jj = 0; jj < count; jj++ )
+			ioHash->fValues[dsConstantHash( inKeys[pending[jj]], seed ) & ioHash->fSlotMask] = inValues[pending[jj]];
+	}
+	
+	DSFree( bucketOf );
+	DSFree( order );
+	DSFree( sizes );
+	DSFree( pending );
+	
+	if ( success == false ) {
+		DSFree( ioHash->fKeys );
+		DSFree( ioHash->fValues );
+		DSFree( ioHash->fSeeds );
+	}
+	
+	return success;
+}
+
+static inline bool dsPerfectHashLookup( DSPerfectHash *inHash, const char *inKey, int32_t *outValue )
+{
+	if ( inHash->fKeys == NULL )
+		return false;
+	
+	uint32_t	bucket	= dsConstantHash( inKey, 0 ) % inHash->fBucketCount;
+	uint32_t	slot	= dsConstantHash( inKey, inHash->fSeeds[bucket] ) & inHash->fSlotMask;
+	const char	*key	= inHash->fKeys[slot];
+	
+	if ( key == NULL || strcmp(key, inKey) != 0 )
+		return false;
+	
+	(*outValue) = inHash->fValues[slot];
+	
+	return true;
+}
+
+static void dsBuildConstantHashes( void )
+{
+	uint32_t	count	= 0;
+	
+	while ( gAuthMethodTable[count].name != NULL )
+		count++;
+	
+	const char	**keys		= (const char **) calloc( count, sizeof(const char *) );
+	int32_t		*values		= (int32_t *) calloc( count, sizeof(int32_t) );
+	
+	for ( uint32_t ii = 0; ii < count; ii++ )
+	{
+		keys[ii] = gAuthMethodTable[ii].name;
+		values[ii] = gAuthMethodTable[ii].value;
+	}
+	
+	if ( dsBuildPerfectHash(&gAuthMethodHash, keys, values, count) == false )
+		syslog( LOG_ALERT, "DSUtils - unable to build the auth method hash, falling back to a linear search" );
+	
+	DSFree( keys );
+	DSFree( values );
+	
+	count = (sizeof(gStdConstantTable) / sizeof(const char *)) - 1;
+	values = (int32_t *) calloc( count, sizeof(int32_t) );
+	
+	for ( uint32_t ii = 0; ii < count; ii++ )
+		values[ii] = (int32_t) ii;
+	
+	if ( dsBuildPerfectHash(&gStdConstantHash, gStdConstantTable, values, count) == false )
+		syslog( LOG_ALERT, "DSUtils - unable to build the standard constant hash, falling back to a linear search" );
+	
+	DSFree( values );
+}
+
 
 //--------------------------------------------------------------------------------------------------
 //	Name:	dsDataBufferAllocatePriv
@@ -166,11 +363,16 @@ tDirStatus dsDataBufferDeallocatePriv ( tDataBufferPtr inDataBufferPtr )
 
 tDataList* dsDataListAllocatePriv ( void )
 {
-	tDataList		   *outResult	= nil;
+	tDataListPriv	   *outResult	= nil;
 
-	outResult = (tDataList *)::calloc( sizeof( tDataList ), sizeof( char ) );
+	outResult = (tDataListPriv *)::calloc( sizeof( tDataListPriv ), sizeof( char ) );
+	if ( outResult != nil )
+	{
+		outResult->fSignature = kDataListIndexSignature;
+		outResult->fSelf = outResult;
+	}
 
-	return( outResult );
+	return( (tDataList *) outResult );
 
 } // dsDataListAllocatePriv
 
@@ -192,6 +394,8 @@ tDirStatus dsDataListDeallocatePriv ( tDataListPtr inDataList  )
 		return( eDSNullDataList );
 	}
 
+	dsDataListFreeIndexPriv( inDataList );
+
 	if ( inDataList->fDataListHead != nil )
 	{
 		pDataBuff = inDataList->fDataListHead;
@@ -425,10 +629,13 @@ tDirStatus dsAppendStringToListAllocPriv (	tDataList	   *inOutDataList,
 		pNewNodeData->fScriptCode	= kASCIICodeScript;
 
 		inOutDataList->fDataNodeCount++;
+		dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 	}
 	else
 	{
-		pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
+		pCurrNode = ::dsDataListIndexGetNodePriv( inOutDataList, inOutDataList->fDataNodeCount );
+		if ( pCurrNode == nil )
+			pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
 		if ( pCurrNode != nil )
 		{
 			// Get the current node's header and point it to the new
@@ -444,6 +651,7 @@ tDirStatus dsAppendStringToListAllocPriv (	tDataList	   *inOutDataList,
 			pNewNodeData->fScriptCode = kASCIICodeScript;
 
 			inOutDataList->fDataNodeCount++;
+			dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 		}
 		else
 		{
@@ -625,10 +833,13 @@ tDirStatus dsAppendStringToListPriv ( tDataListPtr inOutDataList, const char *in
 		pNewNodeData->fScriptCode	= kASCIICodeScript;
 
 		inOutDataList->fDataNodeCount++;
+		dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 	}
 	else
 	{
-		pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
+		pCurrNode = ::dsDataListIndexGetNodePriv( inOutDataList, inOutDataList->fDataNodeCount );
+		if ( pCurrNode == nil )
+			pCurrNode = ::dsGetLastNodePriv( inOutDataList->fDataListHead );
 		if ( pCurrNode != nil )
 		{
 			// Get the current node's header and point it to the new
@@ -644,6 +855,7 @@ tDirStatus dsAppendStringToListPriv ( tDataListPtr inOutDataList, const char *in
 			pNewNodeData->fScriptCode = kASCIICodeScript;
 
 			inOutDataList->fDataNodeCount++;
+			dsDataListIndexAppendPriv( inOutDataList, pNewNode );
 		}
 		else
 		{
@@ -723,7 +935,11 @@ tDirStatus dsDataListGetNodePriv ( tDataListPtr		inDataList,
 
 	*outDataListNode = nil;
 
-	if ( inDataList != nil )
+	if ( inDataList != nil && (pCurrNode = ::dsDataListIndexGetNodePriv(inDataList, inNodeIndex)) != nil )
+	{
+		*outDataListNode = pCurrNode;
+	}
+	else if ( inDataList != nil )
 	{
 		pCurrNode = inDataList->fDataListHead;
 
@@ -772,10 +988,14 @@ char* dsDataListGetNodeStringPriv (	tDataListPtr	inDataList,
 
 	if ( ( inDataList != nil ) && ( inNodeIndex > 0 ) && ( inNodeIndex <= inDataList->fDataNodeCount ) )
 	{
-		pCurrNode = inDataList->fDataListHead;
-
 		// Find the one we are interested in
-		iSegment = 1;
+		pCurrNode = ::dsDataListIndexGetNodePriv( inDataList, inNodeIndex );
+		iSegment = inNodeIndex;
+		if ( pCurrNode == nil )
+		{
+			pCurrNode = inDataList->fDataListHead;
+			iSegment = 1;
+		}
 		while ( (iSegment < inNodeIndex ) && ( pCurrNode != nil) )
 		{
 			pPrivData = (tDataBufferPriv *)pCurrNode;
@@ -895,6 +1115,7 @@ tDataList* dsBuildListFromStringsPriv ( const char *in1stCString, ... )
 	va_end( args );
 
 	pOutList->fDataNodeCount = nodeCount;
+	dsDataListRebuildIndexPriv( pOutList );
 
 	return( pOutList );
 
@@ -929,7 +1150,9 @@ tDirStatus dsDataListGetNodeAllocPriv ( const tDataList		   *inDataList,
 		return( eDSEmptyDataList );
 	}
 
-	pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
+	pCurrNode = ::dsDataListIndexGetNodePriv( inDataList, inIndex );
+	if ( pCurrNode == nil )
+		pCurrNode = ::dsGetThisNodePriv( inDataList->fDataListHead, inIndex );
 	if ( pCurrNode == nil )
 	{
 		return( eDSIndexOutOfRange );
@@ -1100,6 +1323,10 @@ tDirStatus dsAuthBufferGetDataListPriv ( tDataBufferPtr inAuthBuff, tDataListPtr
 		// clean up if there was an errors
 		dsDataListDeallocatePriv(inOutDataList);
 	}
+	else
+	{
+		dsDataListRebuildIndexPriv( inOutDataList );
+	}
 	return( tResult );
 
 } // dsAuthBufferGetDataListPriv
@@ -1244,13 +1471,28 @@ tDirStatus dsGetAuthMethodEnumValue( tDataNode *inData, UInt32 *outAuthMethod )
 	
 	//DbgLog( kLogPlugin, "Using authentication method %s.", authMethodPtr );
 	
-	for ( index = 0; gAuthMethodTable[index].name != NULL; index++ )
+	pthread_once( &gConstantHashOnce, dsBuildConstantHashes );
+	
+	if ( gAuthMethodHash.fKeys != NULL )
 	{
-		if ( strcmp(authMethodPtr, gAuthMethodTable[index].name) == 0 )
+		int32_t value = 0;
+		
+		if ( dsPerfectHashLookup(&gAuthMethodHash, authMethodPtr, &value) == true )
 		{
-			*outAuthMethod = gAuthMethodTable[index].value;
+			*outAuthMethod = value;
 			found = true;
-			break;
+		}
+	}
+	else
+	{
+		for ( index = 0; gAuthMethodTable[index].name != NULL; index++ )
+		{
+			if ( strcmp(authMethodPtr, gAuthMethodTable[index].name) == 0 )
+			{
+				*outAuthMethod = gAuthMethodTable[index].value;
+				found = true;
+				break;
+			}
 		}
 	}
 	
@@ -1273,6 +1515,40 @@ tDirStatus dsGetAuthMethodEnumValue( tDataNode *inData, UInt32 *outAuthMethod )
 } // dsGetAuthMethodEnumValue
 
 
+SInt32 dsGetStdConstantID( const char *inString )
+{
+	int32_t		value	= kDSStdConstantUnknown;
+	
+	if ( inString == NULL )
+		return kDSStdConstantUnknown;
+	
+	pthread_once( &gConstantHashOnce, dsBuildConstantHashes );
+	
+	if ( gStdConstantHash.fKeys != NULL )
+	{
+		dsPerfectHashLookup( &gStdConstantHash, inString, &value );
+		return value;
+	}
+	
+	for ( int32_t index = 0; gStdConstantTable[index] != NULL; index++ )
+	{
+		if ( strcmp(inString, gStdConstantTable[index]) == 0 )
+			return index;
+	}
+	
+	return kDSStdConstantUnknown;
+} // dsGetStdConstantID
+
+
+const char* dsGetStdConstantString( SInt32 inID )
+{
+	if ( inID < 0 || inID >= (SInt32) ((sizeof(gStdConstantTable) / sizeof(const char *)) - 1) )
+		return NULL;
+	
+	return gStdConstantTable[inID];
+} // dsGetStdConstantString
+
+
 const char* dsGetPatternMatchName ( tDirPatternMatch inPatternMatchEnum )
 {
 	const char	   *outString   = nil;
@@ -1556,6 +1832,7 @@ tDataListPtr dsConvertCFArrayToDataList( CFArrayRef inArray )
 				}
 				
 				dsDataList->fDataNodeCount++;
+				dsDataListIndexAppendPriv( dsDataList, (tDataNodePtr) pNewNodeData );
 				
 				pCurNodeData = pNewNodeData;
 			}
@@ -1748,3 +2025,149 @@ bool dsReleaseObject( void *object, volatile int32_t *refcount, bool bFree )
 	
 	return true;
 }
+
+// ---------------------------------------------------------------------------
+//	* sComData allocation
+//
+//		Message blocks are recycled through a small per-thread cache so a request
+//		doesn't have to go back to malloc for its message, and grown geometrically
+//		so building a large reply doesn't copy the message once per 4k block.
+//		Only blocks up to a fixed size message are cached, bigger ones go straight
+//		back to malloc, and cached blocks are zeroed so no payload outlives its
+//		request.
+// ---------------------------------------------------------------------------
+
+#define kComDataCacheCount		4
+#define kComDataCacheMaxSize	(4 * kMsgBlockSize + sizeof(sComData))
+
+typedef struct sComDataCache
+{
+	UInt32		fCount;
+	sComData	*fBlocks[kComDataCacheCount];
+} sComDataCache;
+
+static pthread_key_t	gComDataCacheKey;
+static pthread_once_t	gComDataCacheOnce	= PTHREAD_ONCE_INIT;
+
+static void dsDeleteComDataCache( void *inCache )
+{
+	sComDataCache *cache = (sComDataCache *) inCache;
+	
+	for ( UInt32 ii = 0; ii < cache->fCount; ii++ )
+		free( cache->fBlocks[ii] );
+	free( cache );
+}
+
+static void dsCreateComDataCacheKey( void )
+{
+	pthread_key_create( &gComDataCacheKey, dsDeleteComDataCache );
+}
+
+static sComDataCache *dsGetComDataCache( void )
+{
+	pthread_once( &gComDataCacheOnce, dsCreateComDataCacheKey );
+	
+	sComDataCache *cache = (sComDataCache *) pthread_getspecific( gComDataCacheKey );
+	if ( cache == NULL )
+	{
+		cache = (sComDataCache *) calloc( 1, sizeof(sComDataCache) );
+		if ( cache != NULL )
+			pthread_setspecific( gComDataCacheKey, cache );
+	}
+	
+	return cache;
+}
+
+sComData *dsAllocComDataPriv( UInt32 inDataSize )
+{
+	sComDataCache	*cache		= dsGetComDataCache();
+	size_t			needed		= sizeof(sComData) + inDataSize;
+	sComData		*msg		= NULL;
+	size_t			blockSize	= 0;
+	
+	// take the smallest cached block that fits
+	if ( cache != NULL )
+	{
+		UInt32 best = kComDataCacheCount;
+		
+		for ( UInt32 ii = 0; ii < cache->fCount; ii++ )
+		{
+			size_t size = malloc_size( cache->fBlocks[ii] );
+			if ( size >= needed && (best == kComDataCacheCount || size < blockSize) )
+			{
+				best = ii;
+				blockSize = size;
+			}
+		}
+		
+		if ( best != kComDataCacheCount )
+		{
+			msg = cache->fBlocks[best];
+			cache->fBlocks[best] = cache->fBlocks[--cache->fCount];
+		}
+	}
+	
+	// cached blocks were zeroed when they were freed
+	if ( msg == NULL )
+	{
+		msg = (sComData *) calloc( 1, needed );
+		if ( msg == NULL )
+			return NULL;
+		blockSize = malloc_size( msg );
+		bzero( (char *) msg + needed, blockSize - needed );
+	}
+	
+	msg->fDataSize = (UInt32) (blockSize - sizeof(sComData));
+	
+	return msg;
+}
+
+void dsFreeComDataPriv( sComData *inMsg )
+{
+	if ( inMsg == NULL )
+		return;
+	
+	size_t blockSize = malloc_size( inMsg );
+	if ( blockSize > kComDataCacheMaxSize )
+	{
+		free( inMsg );
+		return;
+	}
+	
+	sComDataCache *cache = dsGetComDataCache();
+	if ( cache != NULL && cache->fCount < kComDataCacheCount )
+	{
+		// don't hand the previous client's data to the next one
+		bzero( inMsg, blockSize );
+		cache->fBlocks[cache->fCount++] = inMsg;
+		return;
+	}
+	
+	free( inMsg );
+}
+
+sComData *dsGrowComDataPriv( sComData *inMsg, UInt32 inNeededSize )
+{
+	UInt32		newSize	= inMsg->fDataSize * 2;
+	sComData	*newMsg	= NULL;
+	
+	if ( inNeededSize <= inMsg->fDataSize )
+		return inMsg;
+	
+	// double the message but always at least what was asked for, in whole blocks
+	if ( newSize < inNeededSize )
+		newSize = inNeededSize;
+	newSize = ((newSize + kMsgBlockSize - 1) / kMsgBlockSize) * kMsgBlockSize;
+	
+	newMsg = dsAllocComDataPriv( newSize );
+	if ( newMsg == NULL )
+		return NULL;
+	
+	newSize = newMsg->fDataSize;
+	memcpy( newMsg, inMsg, sizeof(sComData) + inMsg->fDataLength );
+	newMsg->fDataSize = newSize;
+	
+	dsFreeComDataPriv( inMsg );
+	
+	return newMsg;
+}
@@ -39,6 +39,16 @@
 
 #define kDSNodeEvent							"com.apple.DirectoryService.node.event"
 
+#define kDSStdConstantUnknown					-1
+
+// ids returned by dsGetStdConstantID(), kDSStdID_kDSStdRecordTypeUsers etc., in the order GenStdConstants.sh keeps stable
+enum {
+#define DS_STD_CONSTANT(name)	kDSStdID_##name,
+#include <DirectoryServiceCore/DSStdConstants.h>
+#undef DS_STD_CONSTANT
+	kDSStdIDCount
+};
+
 __BEGIN_DECLS
 
 tDataBufferPtr			dsDataBufferAllocatePriv			( UInt32 inBufferSize );
@@ -68,6 +78,10 @@ void					HexToBinaryConversion				( const char *inHexStr, UInt32 *outLength, uns
 
 double					dsTimestamp							( void );
 tDirStatus				dsGetAuthMethodEnumValue			( tDataNode *inData, UInt32 *outAuthMethod );
+
+// stable ids for the kDSStdAuth, kDSStdRecordType, kDS1Attr/kDSNAttr and kDSAttributes strings, kDSStdConstantUnknown for anything else
+SInt32					dsGetStdConstantID					( const char *inString );
+const char*				dsGetStdConstantString				( SInt32 inID );
 const char*				dsGetPatternMatchName				( tDirPatternMatch inPatternMatchEnum );
 
 CFArrayRef				dsConvertAuthBufferToCFArray		( tDataBufferPtr inAuthBuff );
@@ -86,6 +100,10 @@ CFArrayRef				dsCopyKerberosServiceList			( void ); // NOTE: this is not in the
 void					*dsRetainObject						( void *object, volatile int32_t *refcount );
 bool					dsReleaseObject						( void *object, volatile int32_t *refcount, bool bFree );
 
+struct sComData		*dsAllocComDataPriv					( UInt32 inDataSize );
+void					dsFreeComDataPriv					( struct sComData *inMsg );
+struct sComData		*dsGrowComDataPriv					( struct sComData *inMsg, UInt32 inNeededSize );
+
 tDirStatus				dsGetRecordReferenceInfoInternal	( tRecordReference recordRef, tRecordEntryPtr *recordEntry );
 bool					dsIsRecordDisabledInternal			( tRecordReference recordRef );
 
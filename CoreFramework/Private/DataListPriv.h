@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2009 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ * 
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ * 
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ * 
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+/*!
+ * @header DataListPriv
+ *
+ * Position index for tDataList, shared by the list routines in the API and core frameworks.
+ * Not exported, the index is an implementation detail of lists allocated by dsDataListAllocate.
+ */
+
+#ifndef __DataListPriv_h__
+#define	__DataListPriv_h__	1
+
+#include <stdlib.h>
+#include <malloc/malloc.h>
+#include "PrivateTypes.h"
+
+// lists from dsDataListAllocate/dsDataListAllocatePriv carry this tail so nodes can be found by position
+// without walking the chain; lists declared on the stack or calloc'ed directly don't, and just get walked
+#define kDataListIndexSignature		0x44534C49	// 'DSLI'
+
+typedef struct
+{
+	tDataList			fList;				// must be first, callers only ever see this part
+	UInt32				fSignature;
+	void				*fSelf;
+	tDataNodePtr		*fNodes;			// fNodes[i] is node i + 1 while fNodesCount == fList.fDataNodeCount
+	UInt32				fNodesCount;
+	UInt32				fNodesCapacity;
+} tDataListPriv;
+
+static inline tDataListPriv *dsDataListGetIndexPriv( const tDataList *inDataList )
+{
+	tDataListPriv	*listPriv	= (tDataListPriv *) inDataList;
+
+	// malloc_size is 0 for anything that isn't the start of a heap block, so we never read past a stack list
+	if ( inDataList == NULL || malloc_size(inDataList) < sizeof(tDataListPriv) )
+		return NULL;
+
+	if ( listPriv->fSignature != kDataListIndexSignature || listPriv->fSelf != (void *) inDataList )
+		return NULL;
+
+	return listPriv;
+}
+
+static inline void dsDataListRebuildIndexPriv( tDataList *inDataList )
+{
+	tDataListPriv	*listPriv	= dsDataListGetIndexPriv( inDataList );
+	tDataNodePtr	pCurrNode	= NULL;
+
+	if ( listPriv == NULL )
+		return;
+
+	listPriv->fNodesCount = 0;
+
+	if ( listPriv->fNodesCapacity < inDataList->fDataNodeCount ) {
+		UInt32			newCapacity	= (inDataList->fDataNodeCount < 8 ? 8 : inDataList->fDataNodeCount);
+		tDataNodePtr	*newNodes	= (tDataNodePtr *) realloc( listPriv->fNodes, newCapacity * sizeof(tDataNodePtr) );
+		if ( newNodes == NULL )
+			return;
+
+		listPriv->fNodes = newNodes;
+		listPriv->fNodesCapacity = newCapacity;
+	}
+
+	pCurrNode = inDataList->fDataListHead;
+	while ( pCurrNode != NULL && listPriv->fNodesCount < inDataList->fDataNodeCount )
+	{
+		listPriv->fNodes[listPriv->fNodesCount++] = pCurrNode;
+		pCurrNode = ((tDataBufferPriv *) pCurrNode)->fNextPtr;
+	}
+}
+
+// call after inNewNode was linked at the end and fDataNodeCount bumped
+static inline void dsDataListIndexAppendPriv( tDataList *inDataList, tDataNodePtr inNewNode )
+{
+	tDataListPriv	*listPriv	= dsDataListGetIndexPriv( inDataList );
+
+	if ( listPriv == NULL )
+		return;
+
+	if ( listPriv->fNodesCount + 1 != inDataList->fDataNodeCount ) {
+		dsDataListRebuildIndexPriv( inDataList );
+		return;
+	}
+
+	if ( listPriv->fNodesCount == listPriv->fNodesCapacity ) {
+		UInt32			newCapacity	= (listPriv->fNodesCapacity < 8 ? 8 : listPriv->fNodesCapacity * 2);
+		tDataNodePtr	*newNodes	= (tDataNodePtr *) realloc( listPriv->fNodes, newCapacity * sizeof(tDataNodePtr) );
+		if ( newNodes == NULL ) {
+			listPriv->fNodesCount = 0;
+			return;
+		}
+
+		listPriv->fNodes = newNodes;
+		listPriv->fNodesCapacity = newCapacity;
+	}
+
+	listPriv->fNodes[listPriv->fNodesCount++] = inNewNode;
+}
+
+// inIndex is one-based like the rest of the list API, NULL means the caller has to walk the list
+static inline tDataNodePtr dsDataListIndexGetNodePriv( const tDataList *inDataList, UInt32 inIndex )
+{
+	tDataListPriv	*listPriv	= dsDataListGetIndexPriv( inDataList );
+
+	if ( listPriv == NULL || inIndex == 0 || listPriv->fNodesCount != inDataList->fDataNodeCount || inIndex > listPriv->fNodesCount )
+		return NULL;
+
+	if ( listPriv->fNodes[0] != inDataList->fDataListHead )
+		return NULL;
+
+	return listPriv->fNodes[inIndex - 1];
+}
+
+static inline void dsDataListFreeIndexPriv( tDataList *inDataList )
+{
+	tDataListPriv	*listPriv	= dsDataListGetIndexPriv( inDataList );
+
+	if ( listPriv == NULL )
+		return;
+
+	if ( listPriv->fNodes != NULL ) {
+		free( listPriv->fNodes );
+		listPriv->fNodes = NULL;
+	}
+
+	listPriv->fNodesCount = 0;
+	listPriv->fNodesCapacity = 0;
+}
+
+#endif
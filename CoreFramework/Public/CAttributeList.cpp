@@ -27,6 +27,7 @@
 
 #include "CAttributeList.h"
 #include "DSUtils.h"
+#include "DataListPriv.h"
 
 //------------------------------------------------------------------------------------
 //	* CAttributeList
@@ -108,6 +109,14 @@ SInt32 CAttributeList::GetAttribute( UInt32 inIndex, char **outData )
 	if ( pCurrNode == NULL || inIndex > fNodeList->fDataNodeCount )
 		return eDSAttrListError;
 	
+	pCurrNode = dsDataListIndexGetNodePriv( fNodeList, inIndex );
+	if ( pCurrNode != NULL )
+	{
+		*outData = ((tDataBufferPriv *)pCurrNode)->fBufferData;
+		return eDSNoErr;
+	}
+	
+	pCurrNode = fNodeList->fDataListHead;
 	for ( UInt32 idx = 1; idx <= fNodeList->fDataNodeCount; idx++ )
 	{
 		pPrivData = (tDataBufferPriv *)pCurrNode;
@@ -33,20 +33,78 @@
 #include <vector>
 using std::vector;
 
+// all contexts of a refnum live in the same shard and the shard is kept in the low bits of the context
+#define kContinueShardBits			4
+#define kContinueShardCount			(1 << kContinueShardBits)
+#define kContinueRefNumBuckets		64
+#define kContinueInitialBuckets		64
+
 struct sContinueEntry
 {
-	UInt32	fRefNum;
-	void	*fPointer;
+	tContextData			fContext;
+	UInt32					fRefNum;
+	void					*fPointer;
+	sContinueEntry			*fHashNext;
+	sContinueEntry			*fRefNumPrev;
+	sContinueEntry			*fRefNumNext;
+	sContinueRefNumList		*fRefNumList;
+};
+
+struct sContinueRefNumList
+{
+	UInt32					fRefNum;
+	sContinueEntry			*fHead;
+	sContinueRefNumList		*fNext;
+};
+
+struct sContinueShard
+{
+	DSMutexSemaphore		fMutex;
+	sContinueEntry			**fBuckets;			// by context
+	UInt32					fBucketCount;		// power of 2
+	UInt32					fCount;
+	sContinueRefNumList		*fRefNumBuckets[kContinueRefNumBuckets];
 };
 
+struct sContinueShards
+{
+	sContinueShard			fShard[kContinueShardCount];
+};
+
+static inline uint32_t RefNumHash( UInt32 inRefNum )
+{
+	return inRefNum * 2654435761U;
+}
+
+static inline uint32_t ContextShard( tContextData inContextData )
+{
+	return inContextData & (kContinueShardCount - 1);
+}
+
+static inline uint32_t ContextBucket( tContextData inContextData, UInt32 inBucketCount )
+{
+	return (inContextData >> kContinueShardBits) & (inBucketCount - 1);
+}
+
 //------------------------------------------------------------------------------------
 //	* CContinue
 //------------------------------------------------------------------------------------
 
-CContinue::CContinue ( DeallocateProc inProcPtr ) : fMutex("CContinue::fMutex")
+CContinue::CContinue ( DeallocateProc inProcPtr )
 {
 	fDeallocProcPtr = inProcPtr;
-	fNextContextID = 1;
+	fNextContextID = 0;
+	fShards = new sContinueShards;
+	
+	for ( int ii = 0; ii < kContinueShardCount; ii++ )
+	{
+		sContinueShard *shard = &fShards->fShard[ii];
+		
+		shard->fBucketCount = kContinueInitialBuckets;
+		shard->fBuckets = (sContinueEntry **) calloc( shard->fBucketCount, sizeof(sContinueEntry *) );
+		shard->fCount = 0;
+		bzero( shard->fRefNumBuckets, sizeof(shard->fRefNumBuckets) );
+	}
 
 } // CContinue
 
@@ -57,36 +115,199 @@ CContinue::CContinue ( DeallocateProc inProcPtr ) : fMutex("CContinue::fMutex")
 
 CContinue::~CContinue ( void )
 {
+	// the pointers are not ours to release, same as before, only the bookkeeping
+	for ( int ii = 0; ii < kContinueShardCount; ii++ )
+	{
+		sContinueShard *shard = &fShards->fShard[ii];
+		
+		for ( UInt32 bucket = 0; bucket < shard->fBucketCount; bucket++ )
+		{
+			sContinueEntry *entry = shard->fBuckets[bucket];
+			while ( entry != NULL )
+			{
+				sContinueEntry *next = entry->fHashNext;
+				DSDelete( entry );
+				entry = next;
+			}
+		}
+		
+		for ( int bucket = 0; bucket < kContinueRefNumBuckets; bucket++ )
+		{
+			sContinueRefNumList *list = shard->fRefNumBuckets[bucket];
+			while ( list != NULL )
+			{
+				sContinueRefNumList *next = list->fNext;
+				DSDelete( list );
+				list = next;
+			}
+		}
+		
+		DSFree( shard->fBuckets );
+	}
+	
+	DSDelete( fShards );
+	
 } // ~CContinue
 
 
+//------------------------------------------------------------------------------------
+//	* FindEntry (shard must be locked)
+//------------------------------------------------------------------------------------
+
+sContinueEntry *CContinue::FindEntry( sContinueShard *inShard, tContextData inContextData )
+{
+	sContinueEntry *entry = inShard->fBuckets[ContextBucket(inContextData, inShard->fBucketCount)];
+	
+	while ( entry != NULL && entry->fContext != inContextData )
+		entry = entry->fHashNext;
+	
+	return entry;
+}
+
+
+//------------------------------------------------------------------------------------
+//	* FindRefNumList (shard must be locked)
+//
+//	Returns the link that points at the list so it can be unlinked.
+//------------------------------------------------------------------------------------
+
+sContinueRefNumList **CContinue::FindRefNumList( sContinueShard *inShard, UInt32 inRefNum )
+{
+	sContinueRefNumList **link = &inShard->fRefNumBuckets[(RefNumHash(inRefNum) >> kContinueShardBits) % kContinueRefNumBuckets];
+	
+	while ( (*link) != NULL && (*link)->fRefNum != inRefNum )
+		link = &(*link)->fNext;
+	
+	return link;
+}
+
+
+//------------------------------------------------------------------------------------
+//	* InsertEntry (shard must be locked)
+//------------------------------------------------------------------------------------
+
+void CContinue::InsertEntry( sContinueShard *inShard, sContinueEntry *inEntry )
+{
+	// keep the chains short by doubling once there is more than one entry per bucket
+	if ( inShard->fCount >= inShard->fBucketCount )
+	{
+		UInt32			newCount	= inShard->fBucketCount * 2;
+		sContinueEntry	**newBuckets = (sContinueEntry **) calloc( newCount, sizeof(sContinueEntry *) );
+		
+		if ( newBuckets != NULL )
+		{
+			for ( UInt32 bucket = 0; bucket < inShard->fBucketCount; bucket++ )
+			{
+				sContinueEntry *entry = inShard->fBuckets[bucket];
+				while ( entry != NULL )
+				{
+					sContinueEntry	*next		= entry->fHashNext;
+					UInt32			newBucket	= ContextBucket( entry->fContext, newCount );
+					
+					entry->fHashNext = newBuckets[newBucket];
+					newBuckets[newBucket] = entry;
+					entry = next;
+				}
+			}
+			
+			free( inShard->fBuckets );
+			inShard->fBuckets = newBuckets;
+			inShard->fBucketCount = newCount;
+		}
+	}
+	
+	UInt32 bucket = ContextBucket( inEntry->fContext, inShard->fBucketCount );
+	inEntry->fHashNext = inShard->fBuckets[bucket];
+	inShard->fBuckets[bucket] = inEntry;
+	inShard->fCount++;
+	
+	// and onto the list for its refnum
+	sContinueRefNumList **link = FindRefNumList( inShard, inEntry->fRefNum );
+	if ( (*link) == NULL )
+	{
+		(*link) = new sContinueRefNumList;
+		(*link)->fRefNum = inEntry->fRefNum;
+		(*link)->fHead = NULL;
+		(*link)->fNext = NULL;
+	}
+	
+	sContinueRefNumList *list = (*link);
+	
+	inEntry->fRefNumList = list;
+	inEntry->fRefNumPrev = NULL;
+	inEntry->fRefNumNext = list->fHead;
+	if ( list->fHead != NULL )
+		list->fHead->fRefNumPrev = inEntry;
+	list->fHead = inEntry;
+}
+
+
+//------------------------------------------------------------------------------------
+//	* UnlinkEntry (shard must be locked)
+//------------------------------------------------------------------------------------
+
+void CContinue::UnlinkEntry( sContinueShard *inShard, sContinueEntry *inEntry )
+{
+	sContinueEntry **link = &inShard->fBuckets[ContextBucket(inEntry->fContext, inShard->fBucketCount)];
+	
+	while ( (*link) != NULL && (*link) != inEntry )
+		link = &(*link)->fHashNext;
+	
+	if ( (*link) != NULL )
+	{
+		(*link) = inEntry->fHashNext;
+		inShard->fCount--;
+	}
+	
+	if ( inEntry->fRefNumPrev != NULL )
+		inEntry->fRefNumPrev->fRefNumNext = inEntry->fRefNumNext;
+	else
+		inEntry->fRefNumList->fHead = inEntry->fRefNumNext;
+	
+	if ( inEntry->fRefNumNext != NULL )
+		inEntry->fRefNumNext->fRefNumPrev = inEntry->fRefNumPrev;
+	
+	// last context for this refnum
+	if ( inEntry->fRefNumList->fHead == NULL )
+	{
+		sContinueRefNumList **listLink = FindRefNumList( inShard, inEntry->fRefNum );
+		
+		(*listLink) = inEntry->fRefNumList->fNext;
+		DSDelete( inEntry->fRefNumList );
+	}
+	
+	inEntry->fRefNumList = NULL;
+}
+
+
 tContextData CContinue::AddPointer( void *inPointer, UInt32 inRefNum )
 {
 	tContextData contextValue = 0;
 	
 	if ( inPointer != NULL && inRefNum != 0 )
 	{
-		fMutex.WaitLock();
-
-		sContinueEntry *entry = new sContinueEntry;
+		uint32_t		shardIndex	= RefNumHash( inRefNum ) >> (32 - kContinueShardBits);
+		sContinueShard	*shard		= &fShards->fShard[shardIndex];
+		sContinueEntry	*entry		= new sContinueEntry;
 		
 		entry->fPointer = inPointer;
 		entry->fRefNum = inRefNum;
 
-		// technically if we filled the entire 4 billion entries, we would have a loop
-		// but we couldn't allocate that many anyway
-		while ( fContextMap.find(fNextContextID) != fContextMap.end() )
+		shard->fMutex.WaitLock();
+		
+		// the shard goes in the low bits, the sequence only has to be unique within the shard
+		// we never use 0, and after a wrap we skip values still in use
+		do
 		{
-			// we never use 0
-			if ( 0 == ++fNextContextID )
-				fNextContextID++;
-		}
-
-		contextValue = fNextContextID;
-		fContextMap[contextValue] = entry;
-		fNextContextID++; // increment again since we just used this value
+			uint32_t sequence = __sync_add_and_fetch( &fNextContextID, 1 ) & (0xffffffffU >> kContinueShardBits);
+			
+			contextValue = (sequence << kContinueShardBits) | shardIndex;
+		} while ( (contextValue >> kContinueShardBits) == 0 || FindEntry(shard, contextValue) != NULL );
+		
+		entry->fContext = contextValue;
+		InsertEntry( shard, entry );
 		
-		fMutex.SignalLock();
+		shard->fMutex.SignalLock();
 	}
 	
 	return contextValue;
@@ -96,23 +317,30 @@ void CContinue::RemovePointer( void *inPointer )
 {
 	void	*thePointer = NULL;
 	
-	fMutex.WaitLock();
-	
-	map<tContextData, sContinueEntry *>::iterator	iter;
-	for ( iter = fContextMap.begin(); iter != fContextMap.end(); iter++ )
+	// nothing indexes by pointer so look through every shard
+	for ( int ii = 0; ii < kContinueShardCount && thePointer == NULL; ii++ )
 	{
-		sContinueEntry *entry = iter->second;
-		if ( entry->fPointer == inPointer )
+		sContinueShard *shard = &fShards->fShard[ii];
+		
+		shard->fMutex.WaitLock();
+		
+		for ( UInt32 bucket = 0; bucket < shard->fBucketCount && thePointer == NULL; bucket++ )
 		{
-			thePointer = inPointer;
-			fContextMap.erase( iter++ );
-			DSDelete( entry );
-			break;
+			for ( sContinueEntry *entry = shard->fBuckets[bucket]; entry != NULL; entry = entry->fHashNext )
+			{
+				if ( entry->fPointer == inPointer )
+				{
+					thePointer = inPointer;
+					UnlinkEntry( shard, entry );
+					DSDelete( entry );
+					break;
+				}
+			}
 		}
+		
+		shard->fMutex.SignalLock();
 	}
 	
-	fMutex.SignalLock();
-	
 	if ( fDeallocProcPtr != NULL && thePointer != NULL )
 		(fDeallocProcPtr)( thePointer );
 }
@@ -121,26 +349,27 @@ void CContinue::RemovePointer( void *inPointer )
 void CContinue::RemovePointersForRefNum( UInt32 inRefNum )
 {
 	vector<void *>	entryDataPendingDelete;
+	sContinueShard	*shard	= &fShards->fShard[RefNumHash(inRefNum) >> (32 - kContinueShardBits)];
 	
-	fMutex.WaitLock();
+	shard->fMutex.WaitLock();
 	
-	map<tContextData, sContinueEntry *>::iterator	iter = fContextMap.begin();
-	while ( iter != fContextMap.end() )
+	sContinueRefNumList *list = *FindRefNumList( shard, inRefNum );
+	if ( list != NULL )
 	{
-		sContinueEntry *entry = iter->second;
-		if ( entry->fRefNum == inRefNum )
+		// the list itself goes away with its last entry
+		sContinueEntry *entry = list->fHead;
+		while ( entry != NULL )
 		{
+			sContinueEntry *next = entry->fRefNumNext;
+			
 			entryDataPendingDelete.push_back( entry->fPointer );
-			fContextMap.erase( iter++ );
+			UnlinkEntry( shard, entry );
 			DSDelete( entry );
-		}
-		else
-		{
-			iter++;
+			entry = next;
 		}
 	}
 	
-	fMutex.SignalLock();
+	shard->fMutex.SignalLock();
 	
 	// Now the entry data can be deleted without deadlocking.
 	if ( fDeallocProcPtr != NULL )
@@ -159,20 +388,21 @@ tDirStatus CContinue::RemoveContext( tContextData inContextData )
 	
 	if ( inContextData != 0 )
 	{
-		void *thePointer	= NULL;
+		void			*thePointer	= NULL;
+		sContinueShard	*shard		= &fShards->fShard[ContextShard(inContextData)];
 		
-		fMutex.WaitLock();
+		shard->fMutex.WaitLock();
 		
-		map<tContextData, sContinueEntry *>::iterator	iter = fContextMap.find( inContextData );
-		if ( iter != fContextMap.end() )
+		sContinueEntry *entry = FindEntry( shard, inContextData );
+		if ( entry != NULL )
 		{
-			thePointer = iter->second->fPointer;
-			DSDelete( iter->second );
-			fContextMap.erase( iter );
+			thePointer = entry->fPointer;
+			UnlinkEntry( shard, entry );
+			DSDelete( entry );
 			siResult = eDSNoErr;
 		}
 		
-		fMutex.SignalLock();
+		shard->fMutex.SignalLock();
 		
 		// Now the entry data can be deleted without deadlocking.
 		if ( fDeallocProcPtr != NULL && thePointer != NULL )
@@ -190,30 +420,32 @@ tDirStatus CContinue::RemoveContext( tContextData inContextData )
 
 void *CContinue::GetPointer( tContextData inContextData )
 {
-	void	*thePointer	= NULL;
+	void			*thePointer	= NULL;
+	sContinueShard	*shard		= &fShards->fShard[ContextShard(inContextData)];
 	
-	fMutex.WaitLock();
+	shard->fMutex.WaitLock();
 	
-	map<tContextData, sContinueEntry *>::iterator	iter = fContextMap.find( inContextData );
-	if ( iter != fContextMap.end() )
-		thePointer = iter->second->fPointer;
+	sContinueEntry *entry = FindEntry( shard, inContextData );
+	if ( entry != NULL )
+		thePointer = entry->fPointer;
 	
-	fMutex.SignalLock();
+	shard->fMutex.SignalLock();
 	
 	return thePointer;
 }
 
 UInt32 CContinue::GetRefNum( tContextData inContextData )
 {
-	UInt32	refNum = 0;
+	UInt32			refNum	= 0;
+	sContinueShard	*shard	= &fShards->fShard[ContextShard(inContextData)];
 	
-	fMutex.WaitLock();
+	shard->fMutex.WaitLock();
 	
-	map<tContextData, sContinueEntry *>::iterator	iter = fContextMap.find( inContextData );
-	if ( iter != fContextMap.end() )
-		refNum = iter->second->fRefNum;
+	sContinueEntry *entry = FindEntry( shard, inContextData );
+	if ( entry != NULL )
+		refNum = entry->fRefNum;
 	
-	fMutex.SignalLock();
+	shard->fMutex.SignalLock();
 	
 	return refNum;
 }
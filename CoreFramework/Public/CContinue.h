@@ -37,6 +37,9 @@ using namespace std;
 typedef void (*DeallocateProc)( void *inData );
 
 struct sContinueEntry;
+struct sContinueRefNumList;
+struct sContinueShard;
+struct sContinueShards;
 
 class CContinue
 {
@@ -54,10 +57,14 @@ class CContinue
 		UInt32			GetRefNum				( tContextData inContextData );
 
 	private:
-		map<tContextData, sContinueEntry *>	fContextMap;
-		uint32_t							fNextContextID;
-		DeallocateProc						fDeallocProcPtr;
-		DSMutexSemaphore					fMutex;
+		sContinueEntry *	FindEntry				( sContinueShard *inShard, tContextData inContextData );
+		void				InsertEntry				( sContinueShard *inShard, sContinueEntry *inEntry );
+		void				UnlinkEntry				( sContinueShard *inShard, sContinueEntry *inEntry );
+		sContinueRefNumList **	FindRefNumList		( sContinueShard *inShard, UInt32 inRefNum );
+		
+		struct sContinueShards	*fShards;
+		volatile uint32_t		fNextContextID;
+		DeallocateProc			fDeallocProcPtr;
 };
 
 #endif
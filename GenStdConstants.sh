@@ -0,0 +1,51 @@
+#!/bin/sh
+
+# Regenerates CoreFramework/Private/DSStdConstants.h from the standard auth method, record type, attribute
+# and attribute class constants in the API header.  Run from the top of the project after DirServicesConst.h
+# changes.  An optional argument writes somewhere else, see CheckStdConstants.sh.
+#
+# The ids handed out by dsGetStdConstantID() are positions in the generated list, so the constants already
+# listed keep their place and new ones are appended in sorted order.  Constants are never removed from the
+# API header, a name that disappears is treated as an error rather than renumbering everything after it.
+
+PINNED=CoreFramework/Private/DSStdConstants.h
+OUTPUT=${1:-$PINNED}
+
+CURRENT=/tmp/DSStdConstantsCurrent.$$
+EXISTING=/tmp/DSStdConstantsExisting.$$
+ADDED=/tmp/DSStdConstantsAdded.$$
+
+# constant names in header order, a name defined twice is listed once
+grep -E "^#define[[:space:]]+kDS(StdAuth|StdRecordType|1Attr|NAttr|Attributes)[A-Za-z0-9_]*[[:space:]]+\"" APIFramework/DirServicesConst.h | \
+	awk '{ print $2 }' | grep -v "Prefix$" | awk '!seen[$0]++' > $CURRENT
+
+# the order already handed out
+touch $EXISTING
+if [ -f $PINNED ]; then
+	sed -n 's/^DS_STD_CONSTANT( \(.*\) )$/\1/p' $PINNED | awk '!seen[$0]++' > $EXISTING
+fi
+
+MISSING=`grep -vxF -f $CURRENT $EXISTING`
+if [ -n "$MISSING" ]; then
+	echo "GenStdConstants.sh: no longer in DirServicesConst.h, ids would shift:" 1>&2
+	echo "$MISSING" 1>&2
+	rm -f $CURRENT $EXISTING $ADDED
+	exit 1
+fi
+
+grep -vxF -f $EXISTING $CURRENT | LC_ALL=C sort > $ADDED
+
+cat > $OUTPUT <<END
+/*
+ * Generated by GenStdConstants.sh from APIFramework/DirServicesConst.h, do not edit.
+ *
+ * Expanded into the dsGetStdConstantID() table in DSUtils.cpp and the kDSStdID_ enum in DSUtils.h,
+ * define DS_STD_CONSTANT(name) before including.
+ * A constant's id is its position in this list and never changes, new constants are appended.
+ */
+
+END
+
+cat $EXISTING $ADDED | sed 's/.*/DS_STD_CONSTANT( & )/' >> $OUTPUT
+
+rm -f $CURRENT $EXISTING $ADDED
@@ -161,9 +161,9 @@
 	return 0;
 }
 
-- (void)filterAttributes: (NSMutableDictionary *)inRecord attributes: (NSArray *)inRequestedAttribs
+- (void)filterAttributes: (NSMutableDictionary *)inRecord matcher: (const sBDPIAttributeMatcher *)inMatcher
 {
-	BaseDirectoryPlugin::FilterAttributes( (CFMutableDictionaryRef) inRecord, (CFArrayRef) inRequestedAttribs, (CFStringRef) fNodeName );
+	BaseDirectoryPlugin::FilterAttributes( (CFMutableDictionaryRef) inRecord, inMatcher, (CFStringRef) fNodeName );
 }
 
 @end
@@ -287,9 +287,9 @@ UInt32 BDPIVirtualNode::MaximumSizeForAttribute( CFStringRef inRecordType, CFStr
 	return 0;
 }
 
-void BDPIVirtualNode::FilterAttributes( CFMutableDictionaryRef inRecord, CFArrayRef inRequestedAttribs )
+void BDPIVirtualNode::FilterAttributes( CFMutableDictionaryRef inRecord, const sBDPIAttributeMatcher *inMatcher )
 {
-	BaseDirectoryPlugin::FilterAttributes( inRecord, inRequestedAttribs, fNodeName );
+	BaseDirectoryPlugin::FilterAttributes( inRecord, inMatcher, fNodeName );
 }
 
 #endif
@@ -75,7 +75,7 @@ class BDPIVirtualNode
 		virtual UInt32					MaximumSizeForAttribute( CFStringRef inRecordType, CFStringRef inAttribute );
 	
 	protected:
-		virtual void					FilterAttributes( CFMutableDictionaryRef inRecord, CFArrayRef inRequestedAttribs );
+		virtual void					FilterAttributes( CFMutableDictionaryRef inRecord, const sBDPIAttributeMatcher *inMatcher );
 	
 	protected:
 		CFStringRef			fNodeName;
@@ -99,7 +99,7 @@ class BDPIVirtualNode
 }
 
 - (id)init: (NSString *)inNodeName uid: (uid_t)inUID euid: (uid_t)inEffectiveUID;
-- (void)filterAttributes: (NSMutableDictionary *)record attributes: (NSArray *)requestedAttribs;
+- (void)filterAttributes: (NSMutableDictionary *)record matcher: (const sBDPIAttributeMatcher *)matcher;
 
 - (NSMutableDictionary *)copyNodeInfo:(NSArray *)inAttributes;
 - (NSString *)copyNodeName;
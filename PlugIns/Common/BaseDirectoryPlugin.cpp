@@ -1316,6 +1316,7 @@ tDirStatus BaseDirectoryPlugin::GetRecordList( sGetRecordList *inData )
 		pContinue->fPattMatchType = inData->fInPatternMatch;
 		pContinue->fValueList = CreateCFArrayFromList( inData->fInRecNameList );
 		pContinue->fReturnAttribList = CreateCFArrayFromList( inData->fInAttribTypeList );
+		pContinue->fReturnAttribMatcher = CreateAttributeMatcher( pContinue->fReturnAttribList );
 		pContinue->fAttribsOnly = inData->fInAttribInfoOnly;
 		pContinue->fIndex = 0;
 		pContinue->fMaxRecCount = inData->fOutRecEntryCount;
@@ -1454,6 +1455,7 @@ tDirStatus BaseDirectoryPlugin::DoAttributeValueSearchWithData( sDoAttrValueSear
 		pContinue->fPattMatchType = inData->fInPattMatchType;
 		pContinue->fAttribsOnly = inData->fInAttrInfoOnly;
 		pContinue->fReturnAttribList = cfAttrTypeRequest;
+		pContinue->fReturnAttribMatcher = CreateAttributeMatcher( pContinue->fReturnAttribList );
 		pContinue->fAttributeType = CFStringCreateWithCString( kCFAllocatorDefault, inData->fInAttrType->fBufferData, kCFStringEncodingUTF8 );
 		pContinue->fRecordTypeList = CreateCFArrayFromList( inData->fInRecTypeList );
 		pContinue->fValueList = cfSearchValues;
@@ -2971,6 +2973,18 @@ const char *BaseDirectoryPlugin::GetCStringFromCFString( CFStringRef inCFString,
 }
 
 tDirStatus BaseDirectoryPlugin::FillBuffer( CFMutableArrayRef inRecordList, BDPIOpaqueBuffer inBuffer )
+{
+	CFIndex		recordIndex			= 0;
+	tDirStatus	outRecEntryCount	= FillBuffer( (CFArrayRef) inRecordList, &recordIndex, inBuffer );
+	
+	// remove what we added to the buffer in one go
+	if ( recordIndex > 0 )
+		CFArrayReplaceValues( inRecordList, CFRangeMake(0, recordIndex), NULL, 0 );
+	
+	return outRecEntryCount;
+}
+
+tDirStatus BaseDirectoryPlugin::FillBuffer( CFArrayRef inRecordList, CFIndex *ioRecordIndex, BDPIOpaqueBuffer inBuffer )
 {
     // Lets get ready to fill the buffer
 	tDataBufferPtr	inDataBuff			= (tDataBufferPtr) inBuffer;
@@ -2982,8 +2996,9 @@ tDirStatus BaseDirectoryPlugin::FillBuffer( CFMutableArrayRef inRecordList, BDPI
     UInt32			startTag			= 'StdA';
     UInt32			endTag				= 'EndT';
     UInt32			outRecEntryCount	= 0;
+	CFIndex			recordCount			= (inRecordList != NULL ? CFArrayGetCount(inRecordList) : 0);
 
-	if ( inRecordList != NULL && CFArrayGetCount(inRecordList) > 0 )
+	if ( (*ioRecordIndex) < recordCount )
 	{
         // make buffer size and length the same
         inDataBuff->fBufferLength = inDataBuff->fBufferSize;
@@ -2994,44 +3009,37 @@ tDirStatus BaseDirectoryPlugin::FillBuffer( CFMutableArrayRef inRecordList, BDPI
         *numRecords = 0;
 
         // Now lets loop through the records until we fill the buffer...
-        while (buffLeft && CFArrayGetCount(inRecordList))
+        while ( buffLeft > 8 && (*ioRecordIndex) < recordCount )
 		{
-			CFDictionaryRef	cfRecDict	= (CFDictionaryRef) CFArrayGetValueAtIndex( inRecordList, 0 );
-            CFDataRef		pData		= GetDSBufferFromDictionary( cfRecDict );
-            UInt32			dataLength	= (UInt32) CFDataGetLength( pData );
+			CFDictionaryRef	cfRecDict	= (CFDictionaryRef) CFArrayGetValueAtIndex( inRecordList, (*ioRecordIndex) );
+			
+			// Build the record in the free space past its offset slot, need room for (record offset, Block length field = 8 bytes)
+			// + the Block, and the block has to be strictly smaller than what is left
+			char			*scratch	= bufferLoc + 4;
+            UInt32			dataLength	= SerializeRecord( cfRecDict, scratch, buffLeft - 9 );
 
-			// Need room for (record offset, Block length field = 8 bytes) + the Block, only need 8
-            if( dataLength && ((dataLength + 8) < buffLeft) )
-			{
-                // Now lets update all the offsets and buffer size
-                bufferOffset -= dataLength + 4;
-                buffLeft -= dataLength + 8;
-
-                // first put the offest in the buffer for the record
-                bcopy( (const void *)&bufferOffset, bufferLoc, 4 );
-                bufferLoc += 4; // move past the new byte
-
-                // Now copy length before the data block....
-                bcopy( (const void *)&dataLength, (bufferStart + bufferOffset), 4 );
-
-                // Now copy the bytes into the new location
-				CFDataGetBytes( pData, CFRangeMake(0, dataLength), (UInt8 *) (bufferStart + bufferOffset + 4) );
-
-                // Since we added a buffer, lets increment number of records
-                *numRecords += 1;
-                outRecEntryCount++;
-
-                // remove now that we added it to the buffer
-				CFArrayRemoveValueAtIndex( inRecordList, 0 );
-            }
-			else
+            if ( dataLength == 0 )
 			{
                 // break if we can't fit it so we can return....
-				DSCFRelease( pData );
                 break;
             }
 			
-			DSCFRelease( pData );
+			// Now lets update all the offsets and buffer size
+			bufferOffset -= dataLength + 4;
+			buffLeft -= dataLength + 8;
+
+			// first put the offest in the buffer for the record
+			bcopy( (const void *)&bufferOffset, bufferLoc, 4 );
+			bufferLoc += 4; // move past the new byte
+
+			// Now move the block to the end and put the length before it
+			memmove( bufferStart + bufferOffset + 4, scratch, dataLength );
+			bcopy( (const void *)&dataLength, (bufferStart + bufferOffset), 4 );
+
+			// Since we added a buffer, lets increment number of records
+			*numRecords += 1;
+			outRecEntryCount++;
+			(*ioRecordIndex)++;
         }
         // Close the record list....
         bcopy( (const void *)&endTag, bufferLoc, 4 );
@@ -3117,6 +3125,8 @@ tDirStatus BaseDirectoryPlugin::CleanContextData ( void *inContext )
 			DSCFRelease( tmpSearch->fRecordTypeList );
 			DSCFRelease( tmpSearch->fAttributeType );
 			DSCFRelease( tmpSearch->fValueList );
+			ReleaseAttributeMatcher( tmpSearch->fReturnAttribMatcher );
+			tmpSearch->fReturnAttribMatcher = NULL;
 			DSCFRelease( tmpSearch->fReturnAttribList );
 			if ( tmpSearch->fStateInfoCallback != NULL )
 				tmpSearch->fStateInfoCallback( tmpSearch->fStateInfo );
@@ -3186,103 +3196,194 @@ CFMutableArrayRef BaseDirectoryPlugin::CreateCFArrayFromList( tDataListPtr attri
 	return cfReturnValue;
 }
 
-CFDataRef BaseDirectoryPlugin::GetDSBufferFromDictionary( CFDictionaryRef inDictionary )
+// writes the record layout straight into the caller's buffer, any append that doesn't fit marks the cursor full
+struct sRecordCursor
+{
+	char	*fPos;
+	char	*fEnd;
+	bool	fFull;
+};
+
+static char *CursorReserve( sRecordCursor *inCursor, size_t inLength )
 {
-	CFMutableDataRef	cfData		= CFDataCreateMutable( kCFAllocatorDefault, 0 );
-	char				*tmpStr		= NULL;
-	const char			*pValue		= NULL;
-	UInt16				usLength	= 0;
+	if ( inCursor->fFull || (size_t) (inCursor->fEnd - inCursor->fPos) < inLength )
+	{
+		inCursor->fFull = true;
+		return NULL;
+	}
 	
-	// First do the Type of the record
-	CFStringRef	cfRecType = (CFStringRef) CFDictionaryGetValue( inDictionary, kBDPITypeKey );
+	char *where = inCursor->fPos;
+	inCursor->fPos += inLength;
 	
-	pValue = BaseDirectoryPlugin::GetCStringFromCFString( cfRecType, &tmpStr ); 
-	usLength = (UInt16) (pValue ? strlen( pValue ) : 0);
+	return where;
+}
+
+static void CursorAppend( sRecordCursor *inCursor, const void *inBytes, size_t inLength )
+{
+	char *where = CursorReserve( inCursor, inLength );
+	if ( where != NULL && inLength > 0 )
+		memcpy( where, inBytes, inLength );
+}
+
+// Same bytes as GetCStringFromCFString followed by strlen, the length is written as inLengthSize bytes and truncated
+// the same way the casts did.  Returns false if the string could not be converted so the caller can pick a fallback.
+static bool CursorAppendString( sRecordCursor *inCursor, CFStringRef inString, size_t inLengthSize )
+{
+	const char	*cStr		= (inString != NULL ? CFStringGetCStringPtr(inString, kCFStringEncodingUTF8) : NULL);
+	char		*lengthLoc	= NULL;
+	size_t		length		= 0;
 	
-	CFDataAppendBytes( cfData, (const UInt8 *) &usLength, 2 );
-	CFDataAppendBytes( cfData, (const UInt8 *) pValue, usLength );
+	if ( inString == NULL )
+		return false;
 	
-	DSFreeString( tmpStr );
+	if ( cStr != NULL )
+	{
+		length = strlen( cStr );
+		
+		if ( inLengthSize == 2 )
+		{
+			UInt16 usLength = (UInt16) length;
+			CursorAppend( inCursor, &usLength, 2 );
+			CursorAppend( inCursor, cStr, usLength );
+		}
+		else
+		{
+			UInt32 uiLength = (UInt32) length;
+			CursorAppend( inCursor, &uiLength, 4 );
+			CursorAppend( inCursor, cStr, uiLength );
+		}
+		
+		return true;
+	}
 	
-	// now get the record type and put that
-	// Next fill in the Name of the Record, if it has a RecordName, then lets give it....
-	CFStringRef	cfRecName = (CFStringRef) CFDictionaryGetValue( inDictionary, kBDPINameKey );
+	lengthLoc = CursorReserve( inCursor, inLengthSize );
+	if ( lengthLoc == NULL )
+		return true;
 	
-	pValue = BaseDirectoryPlugin::GetCStringFromCFString( cfRecName, &tmpStr ); 
-	if( pValue == NULL )
-		pValue = "No RecordName";
+	CFIndex		strLength	= CFStringGetLength( inString );
+	CFIndex		usedLen		= 0;
+	CFIndex		space		= inCursor->fEnd - inCursor->fPos;
+	CFIndex		converted	= CFStringGetBytes( inString, CFRangeMake(0, strLength), kCFStringEncodingUTF8, 0, false, 
+												(UInt8 *) inCursor->fPos, space, &usedLen );
 	
-	usLength = (UInt16) strlen( pValue );
-	CFDataAppendBytes( cfData, (const UInt8 *) &usLength, 2 );
-	CFDataAppendBytes( cfData, (const UInt8 *) pValue, usLength );
+	if ( converted < strLength )
+	{
+		// ran out of room, unless there was room for any conversion in which case it can't be converted
+		if ( space < CFStringGetMaximumSizeForEncoding(strLength, kCFStringEncodingUTF8) )
+		{
+			inCursor->fFull = true;
+			return true;
+		}
+		
+		inCursor->fPos = lengthLoc;
+		return false;
+	}
 	
-	DSFreeString( tmpStr );
+	// strlen stopped at an embedded NUL
+	length = strnlen( inCursor->fPos, usedLen );
+	
+	if ( inLengthSize == 2 )
+	{
+		UInt16 usLength = (UInt16) length;
+		memcpy( lengthLoc, &usLength, 2 );
+		inCursor->fPos += usLength;
+	}
+	else
+	{
+		UInt32 uiLength = (UInt32) length;
+		memcpy( lengthLoc, &uiLength, 4 );
+		inCursor->fPos += uiLength;
+	}
+	
+	return true;
+}
+
+UInt32 BaseDirectoryPlugin::SerializeRecord( CFDictionaryRef inDictionary, char *outBuffer, UInt32 inBufferSize )
+{
+	sRecordCursor	cursor		= { outBuffer, outBuffer + inBufferSize, false };
+	UInt16			usLength	= 0;
+	
+	// First do the Type of the record
+	CFStringRef	cfRecType = (CFStringRef) CFDictionaryGetValue( inDictionary, kBDPITypeKey );
+	
+	if ( CursorAppendString(&cursor, cfRecType, 2) == false )
+	{
+		usLength = 0;
+		CursorAppend( &cursor, &usLength, 2 );
+	}
+	
+	// Next fill in the Name of the Record, if it has a RecordName, then lets give it....
+	CFStringRef	cfRecName = (CFStringRef) CFDictionaryGetValue( inDictionary, kBDPINameKey );
+	
+	if ( CursorAppendString(&cursor, cfRecName, 2) == false )
+	{
+		usLength = (UInt16) strlen( "No RecordName" );
+		CursorAppend( &cursor, &usLength, 2 );
+		CursorAppend( &cursor, "No RecordName", usLength );
+	}
 	
 	CFDictionaryRef cfAttributes = (CFDictionaryRef) CFDictionaryGetValue( inDictionary, kBDPIAttributeKey );
 	if ( cfAttributes != NULL )
 	{
 		UInt16	usNumberAttribs	= CFDictionaryGetCount( cfAttributes );
 		
-		CFDataAppendBytes( cfData, (const UInt8 *) &usNumberAttribs, 2 );
+		CursorAppend( &cursor, &usNumberAttribs, 2 );
 		
-		if ( usNumberAttribs > 0 )
+		if ( usNumberAttribs > 0 && cursor.fFull == false )
 		{
-			CFTypeRef	*cfKeysList		= (CFTypeRef *) calloc( usNumberAttribs, sizeof(CFTypeRef *) );
-			CFTypeRef	*cfValuesList	= (CFTypeRef *) calloc( usNumberAttribs, sizeof(CFTypeRef *) );
+			CFIndex		count			= CFDictionaryGetCount( cfAttributes );
+			CFTypeRef	*cfKeysList		= (CFTypeRef *) calloc( count, sizeof(CFTypeRef) );
+			CFTypeRef	*cfValuesList	= (CFTypeRef *) calloc( count, sizeof(CFTypeRef) );
 			
 			CFDictionaryGetKeysAndValues( cfAttributes, cfKeysList, cfValuesList );
 			
-			for (UInt16 ii = 0; ii < usNumberAttribs; ii++)
+			for ( UInt16 ii = 0; ii < usNumberAttribs && cursor.fFull == false; ii++ )
 			{
 				CFStringRef	cfKey		= (CFStringRef) cfKeysList[ii];
 				CFArrayRef	cfValues	= (CFArrayRef) cfValuesList[ii];
 				
-				// Now build the attributes in a temp data object
-				CFMutableDataRef	cfTempData	= CFDataCreateMutable( kCFAllocatorDefault, 0 );
-				
-				pValue = BaseDirectoryPlugin::GetCStringFromCFString( cfKey, &tmpStr );
-				usLength = (UInt16) strlen( pValue );
+				// the block length goes in front once we know it
+				char		*blockLenLoc	= CursorReserve( &cursor, 4 );
 				
 				// first add the attribute name
-				CFDataAppendBytes( cfTempData, (const UInt8 *) &usLength, 2 );
-				CFDataAppendBytes( cfTempData, (const UInt8 *) pValue, usLength );
-				
-				DSFreeString( tmpStr );
+				if ( CursorAppendString(&cursor, cfKey, 2) == false )
+				{
+					usLength = 0;
+					CursorAppend( &cursor, &usLength, 2 );
+				}
 				
 				// Number of values
 				UInt16 usValuesCount = (UInt16) CFArrayGetCount( cfValues );
-				CFDataAppendBytes( cfTempData, (const UInt8 *) &usValuesCount, 2 );
+				CursorAppend( &cursor, &usValuesCount, 2 );
 				
 				// Loop through values
-				for( UInt16 zz = 0; zz < usValuesCount; zz++ )
+				for ( UInt16 zz = 0; zz < usValuesCount && cursor.fFull == false; zz++ )
 				{
 					CFTypeRef	cfValue	= CFArrayGetValueAtIndex( cfValues, zz );
 					
 					if ( CFGetTypeID(cfValue) == CFStringGetTypeID() )
 					{
-						pValue = GetCStringFromCFString( (CFStringRef) cfValue, &tmpStr );
-						UInt32 attribLen = (UInt32) strlen( pValue );
-						
-						CFDataAppendBytes( cfTempData, (const UInt8 *) &attribLen, 4 );
-						CFDataAppendBytes( cfTempData, (const UInt8 *) pValue, attribLen );
-						
-						DSFreeString( tmpStr );
+						if ( CursorAppendString(&cursor, (CFStringRef) cfValue, 4) == false )
+						{
+							UInt32 attribLen = 0;
+							CursorAppend( &cursor, &attribLen, 4 );
+						}
 					}
 					else
 					{
 						UInt32 attribLen = CFDataGetLength( (CFDataRef) cfValue );
 						
-						CFDataAppendBytes( cfTempData, (const UInt8 *) &attribLen, 4 );
-						CFDataAppendBytes( cfTempData, CFDataGetBytePtr((CFDataRef) cfValue), attribLen );
+						CursorAppend( &cursor, &attribLen, 4 );
+						CursorAppend( &cursor, CFDataGetBytePtr((CFDataRef) cfValue), attribLen );
 					}
 				}
 				
-				// Now append this attribute block
-				UInt32 attribBlockLen = CFDataGetLength( cfTempData );
-				CFDataAppendBytes( cfData, (const UInt8 *) &attribBlockLen, 4 );
-				CFDataAppendBytes( cfData, CFDataGetBytePtr(cfTempData), attribBlockLen );
-				
-				DSCFRelease( cfTempData );
+				// Now fill in the length of this attribute block
+				if ( cursor.fFull == false )
+				{
+					UInt32 attribBlockLen = (UInt32) (cursor.fPos - (blockLenLoc + 4));
+					memcpy( blockLenLoc, &attribBlockLen, 4 );
+				}
 			}
 			
 			DSFree( cfKeysList );
@@ -3290,20 +3391,50 @@ CFDataRef BaseDirectoryPlugin::GetDSBufferFromDictionary( CFDictionaryRef inDict
 		}
 	}
 	
-	return cfData;
+	return (cursor.fFull ? 0 : (UInt32) (cursor.fPos - outBuffer));
+}
+
+sBDPIAttributeMatcher *BaseDirectoryPlugin::CreateAttributeMatcher( CFArrayRef inRequestedAttribs )
+{
+	if ( inRequestedAttribs == NULL )
+		return NULL;
+	
+	sBDPIAttributeMatcher	*matcher	= (sBDPIAttributeMatcher *) calloc( 1, sizeof(sBDPIAttributeMatcher) );
+	CFIndex					iCount		= CFArrayGetCount( inRequestedAttribs );
+	CFTypeRef				*values		= (CFTypeRef *) calloc( iCount + 1, sizeof(CFTypeRef) );
+	
+	CFArrayGetValues( inRequestedAttribs, CFRangeMake(0, iCount), values );
+	
+	matcher->fRequested = CFSetCreate( kCFAllocatorDefault, values, iCount, &kCFTypeSetCallBacks );
+	matcher->fNeedStdAll = CFSetContainsValue( matcher->fRequested, CFSTR(kDSAttributesStandardAll) );
+	matcher->fNeedNativeAll = CFSetContainsValue( matcher->fRequested, CFSTR(kDSAttributesNativeAll) );
+	matcher->fNeedAll = ( (matcher->fNeedStdAll && matcher->fNeedNativeAll) || 
+						  CFSetContainsValue(matcher->fRequested, CFSTR(kDSAttributesAll)) );
+	matcher->fNeedNodeLocation = ( matcher->fNeedAll || matcher->fNeedStdAll || 
+								   CFSetContainsValue(matcher->fRequested, CFSTR(kDSNAttrMetaNodeLocation)) );
+	
+	DSFree( values );
+	
+	return matcher;
 }
 
-void BaseDirectoryPlugin::FilterAttributes( CFMutableDictionaryRef inRecord, CFArrayRef inRequestedAttribs, CFStringRef inNodeName )
+void BaseDirectoryPlugin::ReleaseAttributeMatcher( sBDPIAttributeMatcher *inMatcher )
 {
-	CFRange					cfAttribRange	= CFRangeMake( 0, CFArrayGetCount(inRequestedAttribs) );
-	bool					bNeedStdAll		= CFArrayContainsValue( inRequestedAttribs, cfAttribRange, CFSTR(kDSAttributesStandardAll) );
-	bool					bNeedNativeAll	= CFArrayContainsValue( inRequestedAttribs, cfAttribRange, CFSTR(kDSAttributesNativeAll) );
-	bool					bNeedAll		= ( (bNeedStdAll && bNeedNativeAll) || 
-												CFArrayContainsValue(inRequestedAttribs, cfAttribRange, CFSTR(kDSAttributesAll)) );
+	if ( inMatcher == NULL )
+		return;
+	
+	DSCFRelease( inMatcher->fRequested );
+	free( inMatcher );
+}
 
+void BaseDirectoryPlugin::FilterAttributes( CFMutableDictionaryRef inRecord, const sBDPIAttributeMatcher *inMatcher, CFStringRef inNodeName )
+{
 	CFMutableDictionaryRef	cfAttributes	= (CFMutableDictionaryRef) CFDictionaryGetValue( inRecord, kBDPIAttributeKey );
 	
-	if ( bNeedAll == false )
+	if ( inMatcher == NULL )
+		return;
+	
+	if ( inMatcher->fNeedAll == false )
 	{
 		CFIndex		iCount	= CFDictionaryGetCount( cfAttributes );
 		CFTypeRef	*keys	= (CFTypeRef *) calloc( iCount, sizeof(CFTypeRef) );
@@ -3312,11 +3443,11 @@ void BaseDirectoryPlugin::FilterAttributes( CFMutableDictionaryRef inRecord, CFA
 		
 		for (CFIndex ii = 0; ii < iCount; ii++ )
 		{
-			if ( CFArrayContainsValue(inRequestedAttribs, cfAttribRange, keys[ii]) == false )
+			if ( CFSetContainsValue(inMatcher->fRequested, keys[ii]) == false )
 			{
-				if ( (bNeedStdAll == false && bNeedNativeAll == false) ||
-					 (bNeedStdAll == true && CFStringHasPrefix((CFStringRef) keys[ii], CFSTR(kDSStdAttrTypePrefix)) == false) ||
-					 (bNeedNativeAll == true && CFStringHasPrefix((CFStringRef) keys[ii], CFSTR(kDSNativeAttrTypePrefix)) == false) )
+				if ( (inMatcher->fNeedStdAll == false && inMatcher->fNeedNativeAll == false) ||
+					 (inMatcher->fNeedStdAll == true && CFStringHasPrefix((CFStringRef) keys[ii], CFSTR(kDSStdAttrTypePrefix)) == false) ||
+					 (inMatcher->fNeedNativeAll == true && CFStringHasPrefix((CFStringRef) keys[ii], CFSTR(kDSNativeAttrTypePrefix)) == false) )
 				{
 					CFDictionaryRemoveValue( cfAttributes, keys[ii] );
 				}
@@ -3326,7 +3457,7 @@ void BaseDirectoryPlugin::FilterAttributes( CFMutableDictionaryRef inRecord, CFA
 		DSFree( keys );
 	}
 	
-	if ( bNeedAll || bNeedStdAll || CFArrayContainsValue( inRequestedAttribs, cfAttribRange, CFSTR(kDSNAttrMetaNodeLocation)) )
+	if ( inMatcher->fNeedNodeLocation )
 	{
 		CFArrayRef cfNodeLoc = CFArrayCreate( kCFAllocatorDefault, (CFTypeRef *) &inNodeName, 1, &kCFTypeArrayCallBacks );
 		CFDictionarySetValue( cfAttributes, CFSTR(kDSNAttrMetaNodeLocation), cfNodeLoc );
@@ -65,8 +65,11 @@ class BaseDirectoryPlugin : public CServerPlugin
 		virtual SInt32			ProcessRequest			( void *inData );
 
 		static tDirStatus		FillBuffer				( CFMutableArrayRef inRecordList, BDPIOpaqueBuffer inData );
+		static tDirStatus		FillBuffer				( CFArrayRef inRecordList, CFIndex *ioRecordIndex, BDPIOpaqueBuffer inData );
 		static const char		*GetCStringFromCFString	( CFStringRef inCFString, char **outCString );
-		static void				FilterAttributes		( CFMutableDictionaryRef inRecord, CFArrayRef inRequestedAttribs, CFStringRef inNodeName );
+		static void				FilterAttributes		( CFMutableDictionaryRef inRecord, const sBDPIAttributeMatcher *inMatcher, CFStringRef inNodeName );
+		static sBDPIAttributeMatcher	*CreateAttributeMatcher	( CFArrayRef inRequestedAttribs );
+		static void				ReleaseAttributeMatcher	( sBDPIAttributeMatcher *inMatcher );
 		char					*GetRecordTypeFromRef	( tRecordReference inRecRef );
 
 	protected:
@@ -166,7 +169,7 @@ class BaseDirectoryPlugin : public CServerPlugin
 	
 	private:
 		static CFMutableArrayRef	CreateCFArrayFromList( tDataListPtr attribList );
-		static CFDataRef			GetDSBufferFromDictionary( CFDictionaryRef inDictionary );
+		static UInt32				SerializeRecord			( CFDictionaryRef inDictionary, char *outBuffer, UInt32 inBufferSize );
 };
 
 #endif
@@ -65,6 +65,16 @@ enum CntxDataType
 typedef void *BDPIOpaqueBuffer;
 typedef void (*SearchCtxStateFree)(void *);
 
+// requested attribute list compiled once per query, see BaseDirectoryPlugin::CreateAttributeMatcher
+struct sBDPIAttributeMatcher
+{
+	CFSetRef			fRequested;
+	bool				fNeedAll;
+	bool				fNeedStdAll;
+	bool				fNeedNativeAll;
+	bool				fNeedNodeLocation;
+};
+
 struct sBDPINodeContext
 {
 	enum CntxDataType	fType;
@@ -87,6 +97,7 @@ struct sBDPISearchRecordsContext
 	CFIndex				fRecTypeIndex;
 	void				*fStateInfo;
 	SearchCtxStateFree	fStateInfoCallback;
+	sBDPIAttributeMatcher	*fReturnAttribMatcher;
 };
 
 struct sBDPIRecordEntryContext
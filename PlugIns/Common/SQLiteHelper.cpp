@@ -26,17 +26,39 @@
 #include <sys/stat.h>
 #include <DirectoryServiceCore/CLog.h>
 
-SQLiteHelper::SQLiteHelper( const char *inDatabasePath, uint32_t inExpectedVersion )
+SQLiteHelper::SQLiteHelper( const char *inDatabasePath, uint32_t inExpectedVersion, int inCacheSize )
 {
 	fDatabase = NULL;
 	fDatabasePath = strdup( inDatabasePath );
 	fVersion = inExpectedVersion;
 	fNewDatabase = false;
+	fCacheSize = inCacheSize;
+	fStatementClock = 0;
+	fRetired = NULL;
+	fGeneration = 0;
+	
+	bzero( fStatements, sizeof(fStatements) );
+	bzero( fReaders, sizeof(fReaders) );
 }
 
 SQLiteHelper::~SQLiteHelper( void )
 {
 	CloseDatabase();
+	
+	// statements still out at this point can't be handed back anymore
+	while ( fRetired != NULL ) {
+		sSQLiteRetiredConnection *retired = fRetired;
+		
+		for ( int ii = 0; ii < kSQLiteStatementCacheSize; ii++ )
+			retired->fStatements[ii].fInUse = false;
+		
+		FlushCache( retired->fStatements );
+		sqlite3_close( retired->fDatabase );
+		
+		fRetired = retired->fNext;
+		free( retired );
+	}
+	
 	DSFree( fDatabasePath );
 }
 
@@ -67,10 +89,16 @@ bool SQLiteHelper::OpenDatabase( bool inIntegrityCheck )
 		}
 	}
 	
-	// we lower the cache size to bare minimum, none of our tables are big enough and we have no need for cache
+	// WAL lets the read-only connections run while the writer is in a transaction, it sticks to the file
+	// so this is only a change the first time an older database is opened
+	if ( fDatabase != NULL && ExecSync("PRAGMA journal_mode = WAL") != SQLITE_ROW ) {
+		DbgLog( kLogError, "SQLiteHelper::OpenDatabase - unable to switch '%s' to write-ahead logging", fDatabasePath );
+	}
+	
+	// by default we lower the cache size to bare minimum, none of our tables are big enough and we have no need for cache
 	// we don't do complex queries that require multiple rows in memory
 	// let the disk cache for the system do most of the work as our indexes shouldn't be too large
-	ExecSync( "PRAGMA cache_size = 2" ); // 4k is plenty for anything we do
+	SetCacheSize( fCacheSize );
 	
 	fMutex.SignalLock();
 	
@@ -113,8 +141,27 @@ void SQLiteHelper::CloseDatabase( void )
 {
 	fMutex.WaitLock();
 
+	// readers still stepping a statement close their connection when they hand it back
+	CloseReaders();
+	
 	if ( fDatabase != NULL ) {
-		sqlite3_close( fDatabase );
+		FlushCache( fStatements );
+		
+		// sqlite3_close refuses to close with statements outstanding, those stay valid on the old
+		// connection so a later Step fails and Finalize hands them back instead of finalizing twice
+		if ( sqlite3_close(fDatabase) != SQLITE_OK ) {
+			sSQLiteRetiredConnection *retired = (sSQLiteRetiredConnection *) calloc( 1, sizeof(sSQLiteRetiredConnection) );
+			
+			retired->fDatabase = fDatabase;
+			memcpy( retired->fStatements, fStatements, sizeof(fStatements) );
+			bzero( fStatements, sizeof(fStatements) );
+			
+			retired->fNext = fRetired;
+			fRetired = retired;
+			
+			DbgLog( kLogPlugin, "SQLiteHelper::CloseDatabase - statements are still outstanding for '%s', closing when they are finalized",
+				    fDatabasePath );
+		}
 		fDatabase = NULL;
 		
 		DbgLog( kLogPlugin, "SQLiteHelper::CloseDatabase is closing database '%s'", fDatabasePath );
@@ -126,6 +173,8 @@ void SQLiteHelper::CloseDatabase( void )
 void SQLiteHelper::RemoveDatabase( void )
 {
 	char	journal[PATH_MAX];
+	char	wal[PATH_MAX];
+	char	shm[PATH_MAX];
 	
 	fMutex.WaitLock();
 
@@ -134,8 +183,16 @@ void SQLiteHelper::RemoveDatabase( void )
 	strlcpy( journal, fDatabasePath, sizeof(journal) );
 	strlcat( journal, "-journal", sizeof(journal) );
 	
+	strlcpy( wal, fDatabasePath, sizeof(wal) );
+	strlcat( wal, "-wal", sizeof(wal) );
+	
+	strlcpy( shm, fDatabasePath, sizeof(shm) );
+	strlcat( shm, "-shm", sizeof(shm) );
+	
 	unlink( fDatabasePath );
 	unlink( journal );
+	unlink( wal );
+	unlink( shm );
 
 	fMutex.SignalLock();
 
@@ -153,11 +210,12 @@ int SQLiteHelper::ExecSync( const char *command, int length )
 
 	if ( fDatabase != NULL )
 	{
-		status = sqlite3_prepare_v2( fDatabase, command, length, &pStmt, NULL );	
+		status = PrepareCached( fDatabase, fStatements, &fStatementClock, command, length, &pStmt );
 		if ( SQLITE_OK == status )
 		{
 			status = sqlite3_step( pStmt );
-			sqlite3_finalize( pStmt );
+			if ( ReleaseCached(fStatements, pStmt) == false )
+				sqlite3_finalize( pStmt );
 		}
 	}
 	
@@ -175,7 +233,7 @@ int SQLiteHelper::ExecSyncWithTypes( const char *command, int length, ... )
 	
 	if ( fDatabase != NULL )
 	{
-		status = sqlite3_prepare_v2( fDatabase, command, length, &pStmt, NULL );	
+		status = PrepareCached( fDatabase, fStatements, &fStatementClock, command, length, &pStmt );
 		if ( SQLITE_OK == status )
 		{
 			int				argIndex;
@@ -225,7 +283,8 @@ int SQLiteHelper::ExecSyncWithTypes( const char *command, int length, ... )
 			if ( status == SQLITE_OK )
 				status = sqlite3_step( pStmt );
 			
-			sqlite3_finalize( pStmt );
+			if ( ReleaseCached(fStatements, pStmt) == false )
+				sqlite3_finalize( pStmt );
 		}
 	}
 	
@@ -241,7 +300,11 @@ int SQLiteHelper::Prepare( const char *command, int length, sqlite3_stmt **stmt,
 	fMutex.WaitLock();
 	
 	if ( fDatabase != NULL ) {
-		result = sqlite3_prepare_v2( fDatabase, command, length, stmt, pzTail );	
+		// the cache doesn't remember where a statement ended, so callers walking a list of statements go direct
+		if ( pzTail == NULL )
+			result = PrepareCached( fDatabase, fStatements, &fStatementClock, command, length, stmt );
+		else
+			result = sqlite3_prepare_v2( fDatabase, command, length, stmt, pzTail );	
 	}
 
 	fMutex.SignalLock();
@@ -255,7 +318,8 @@ int SQLiteHelper::Step( sqlite3_stmt *inStmt )
 	
 	fMutex.WaitLock();
 	
-	if ( fDatabase != NULL && inStmt != NULL ) {
+	// statements from before CloseDatabase can no longer be stepped
+	if ( fDatabase != NULL && inStmt != NULL && sqlite3_db_handle(inStmt) == fDatabase ) {
 		status = sqlite3_step( inStmt );
 	}
 	
@@ -270,8 +334,8 @@ int SQLiteHelper::Finalize( sqlite3_stmt *&inStmt )
 	
 	fMutex.WaitLock();
 	
-	if ( fDatabase != NULL && inStmt != NULL ) {
-		status = sqlite3_finalize( inStmt );
+	if ( inStmt != NULL ) {
+		status = ReleaseStatement( inStmt );
 		inStmt = NULL;
 	}
 	
@@ -280,6 +344,102 @@ int SQLiteHelper::Finalize( sqlite3_stmt *&inStmt )
 	return status;
 }
 
+int SQLiteHelper::PrepareRead( const char *command, int length, sqlite3_stmt **stmt )
+{
+	int						status	= SQLITE_ERROR;
+	sSQLiteReadConnection	*reader	= AcquireReader();
+	
+	if ( reader != NULL ) {
+		status = PrepareCached( reader->fDatabase, reader->fStatements, &reader->fClock, command, length, stmt );
+		if ( SQLITE_OK != status ) {
+			fReadersMutex.WaitLock();
+			reader->fInUse = false;
+			fReadersMutex.SignalLock();
+		}
+	}
+	else {
+		// every reader is busy or the file can't be opened read-only yet, so the writer serves it
+		// and stays locked until FinishRead, just like Prepare/Step/Finalize done back to back
+		fMutex.WaitLock();
+		
+		if ( fDatabase != NULL )
+			status = PrepareCached( fDatabase, fStatements, &fStatementClock, command, length, stmt );
+		
+		if ( SQLITE_OK != status )
+			fMutex.SignalLock();
+	}
+	
+	return status;
+}
+
+void SQLiteHelper::FinishRead( sqlite3_stmt *&inStmt )
+{
+	if ( inStmt == NULL )
+		return;
+	
+	sqlite3	*database	= sqlite3_db_handle( inStmt );
+	bool	isReader	= false;
+	
+	fReadersMutex.WaitLock();
+	
+	for ( int ii = 0; ii < kSQLiteReadConnections; ii++ )
+	{
+		sSQLiteReadConnection *reader = &fReaders[ii];
+		if ( reader->fDatabase != database )
+			continue;
+		
+		if ( ReleaseCached(reader->fStatements, inStmt) == false )
+			sqlite3_finalize( inStmt );
+		
+		// database was closed or replaced while this reader was out
+		if ( reader->fGeneration != fGeneration ) {
+			FlushCache( reader->fStatements );
+			sqlite3_close( reader->fDatabase );
+			reader->fDatabase = NULL;
+		}
+		
+		reader->fInUse = false;
+		isReader = true;
+		break;
+	}
+	
+	fReadersMutex.SignalLock();
+	
+	// otherwise the writer served it and is still locked from PrepareRead
+	if ( isReader == false ) {
+		ReleaseStatement( inStmt );
+		fMutex.SignalLock();
+	}
+	
+	inStmt = NULL;
+}
+
+void SQLiteHelper::SetCacheSize( int inPages )
+{
+	char	command[64];
+	
+	snprintf( command, sizeof(command), "PRAGMA cache_size = %d", inPages );
+	
+	fMutex.WaitLock();
+	
+	fCacheSize = inPages;
+	ExecSync( command );
+	
+	fMutex.SignalLock();
+	
+	// idle readers pick it up now, busy ones when they are next opened
+	fReadersMutex.WaitLock();
+	
+	for ( int ii = 0; ii < kSQLiteReadConnections; ii++ )
+	{
+		sSQLiteReadConnection *reader = &fReaders[ii];
+		if ( reader->fDatabase != NULL && reader->fInUse == false )
+			sqlite3_exec( reader->fDatabase, command, NULL, NULL, NULL );
+	}
+	
+	fReadersMutex.SignalLock();
+}
+
 bool SQLiteHelper::BeginTransaction( const char *inName )
 {
 	char	command[256];
@@ -405,3 +565,194 @@ bool SQLiteHelper::IsDatabaseVersionCurrent( void )
 	return bIsCurrent;
 }
 
+int SQLiteHelper::PrepareCached( sqlite3 *inDatabase, sSQLiteCachedStatement *inCache, uint64_t *ioClock, const char *command,
+								 int length, sqlite3_stmt **outStmt )
+{
+	sSQLiteCachedStatement	*entry	= NULL;
+	size_t					cmdLen	= (length < 0 ? strlen(command) : strnlen(command, length));
+	uint32_t				hash	= 2166136261U;
+	
+	for ( size_t ii = 0; ii < cmdLen; ii++ )
+		hash = (hash ^ (uint8_t) command[ii]) * 16777619U;
+	
+	for ( int ii = 0; ii < kSQLiteStatementCacheSize; ii++ )
+	{
+		sSQLiteCachedStatement *slot = &inCache[ii];
+		
+		if ( slot->fStmt != NULL && slot->fInUse == false && slot->fHash == hash && strncmp(slot->fCommand, command, cmdLen) == 0 && 
+			 slot->fCommand[cmdLen] == '\0' )
+		{
+			slot->fInUse = true;
+			slot->fLastUsed = ++(*ioClock);
+			(*outStmt) = slot->fStmt;
+			return SQLITE_OK;
+		}
+		
+		// least recently used idle slot is the one we replace
+		if ( slot->fInUse == false && (entry == NULL || slot->fStmt == NULL || (entry->fStmt != NULL && slot->fLastUsed < entry->fLastUsed)) )
+			entry = slot;
+	}
+	
+	int status = sqlite3_prepare_v2( inDatabase, command, length, outStmt, NULL );
+	if ( SQLITE_OK != status || (*outStmt) == NULL || entry == NULL )
+		return status;
+	
+	if ( entry->fStmt != NULL ) {
+		sqlite3_finalize( entry->fStmt );
+		DSFree( entry->fCommand );
+	}
+	
+	entry->fCommand = strndup( command, cmdLen );
+	entry->fHash = hash;
+	entry->fStmt = (*outStmt);
+	entry->fLastUsed = ++(*ioClock);
+	entry->fInUse = true;
+	
+	return status;
+}
+
+bool SQLiteHelper::ReleaseCached( sSQLiteCachedStatement *inCache, sqlite3_stmt *inStmt )
+{
+	for ( int ii = 0; ii < kSQLiteStatementCacheSize; ii++ )
+	{
+		sSQLiteCachedStatement *slot = &inCache[ii];
+		
+		if ( slot->fStmt == inStmt ) {
+			sqlite3_reset( inStmt );
+			sqlite3_clear_bindings( inStmt );
+			slot->fInUse = false;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+// statements a caller still holds are left alone, they are finalized when handed back
+void SQLiteHelper::FlushCache( sSQLiteCachedStatement *inCache )
+{
+	for ( int ii = 0; ii < kSQLiteStatementCacheSize; ii++ )
+	{
+		sSQLiteCachedStatement *slot = &inCache[ii];
+		
+		if ( slot->fInUse == true )
+			continue;
+		
+		if ( slot->fStmt != NULL ) {
+			sqlite3_finalize( slot->fStmt );
+			slot->fStmt = NULL;
+		}
+		
+		DSFree( slot->fCommand );
+	}
+}
+
+// hands back a statement of the writer connection, or of one retired by CloseDatabase, fMutex must be held
+int SQLiteHelper::ReleaseStatement( sqlite3_stmt *inStmt )
+{
+	sqlite3	*database	= sqlite3_db_handle( inStmt );
+	
+	if ( fDatabase != NULL && database == fDatabase ) {
+		if ( ReleaseCached(fStatements, inStmt) == true )
+			return SQLITE_OK;
+		
+		return sqlite3_finalize( inStmt );
+	}
+	
+	for ( sSQLiteRetiredConnection **link = &fRetired; (*link) != NULL; link = &(*link)->fNext )
+	{
+		sSQLiteRetiredConnection *retired = (*link);
+		if ( retired->fDatabase != database )
+			continue;
+		
+		if ( ReleaseCached(retired->fStatements, inStmt) == false )
+			sqlite3_finalize( inStmt );
+		
+		// closes once nothing else is outstanding
+		FlushCache( retired->fStatements );
+		if ( sqlite3_close(retired->fDatabase) == SQLITE_OK ) {
+			(*link) = retired->fNext;
+			free( retired );
+		}
+		
+		return SQLITE_OK;
+	}
+	
+	return SQLITE_MISUSE;
+}
+
+sSQLiteReadConnection *SQLiteHelper::AcquireReader( void )
+{
+	sSQLiteReadConnection	*reader	= NULL;
+	
+	fReadersMutex.WaitLock();
+	
+	// prefer one that is already open so its statements get reused
+	for ( int ii = 0; ii < kSQLiteReadConnections && reader == NULL; ii++ )
+	{
+		if ( fReaders[ii].fInUse == false && fReaders[ii].fDatabase != NULL )
+			reader = &fReaders[ii];
+	}
+	
+	for ( int ii = 0; ii < kSQLiteReadConnections && reader == NULL; ii++ )
+	{
+		if ( fReaders[ii].fInUse == false )
+			reader = &fReaders[ii];
+	}
+	
+	if ( reader != NULL )
+		reader->fInUse = true;
+	
+	fReadersMutex.SignalLock();
+	
+	if ( reader != NULL && reader->fDatabase == NULL ) {
+		// open under the writer lock so we never pick up a file that CreateDatabase/RemoveDatabase is replacing
+		fMutex.WaitLock();
+		
+		if ( fDatabase != NULL && sqlite3_open_v2(fDatabasePath, &reader->fDatabase, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK ) {
+			char	command[64];
+			
+			snprintf( command, sizeof(command), "PRAGMA cache_size = %d", fCacheSize );
+			sqlite3_exec( reader->fDatabase, command, NULL, NULL, NULL );
+			sqlite3_busy_timeout( reader->fDatabase, kSQLiteReadBusyTimeout );
+			
+			reader->fGeneration = fGeneration;
+		}
+		else {
+			if ( reader->fDatabase != NULL ) {
+				sqlite3_close( reader->fDatabase );
+				reader->fDatabase = NULL;
+			}
+			
+			fReadersMutex.WaitLock();
+			reader->fInUse = false;
+			fReadersMutex.SignalLock();
+			
+			reader = NULL;
+		}
+		
+		fMutex.SignalLock();
+	}
+	
+	return reader;
+}
+
+void SQLiteHelper::CloseReaders( void )
+{
+	fReadersMutex.WaitLock();
+	
+	fGeneration++;
+	
+	for ( int ii = 0; ii < kSQLiteReadConnections; ii++ )
+	{
+		sSQLiteReadConnection *reader = &fReaders[ii];
+		
+		if ( reader->fDatabase != NULL && reader->fInUse == false ) {
+			FlushCache( reader->fStatements );
+			sqlite3_close( reader->fDatabase );
+			reader->fDatabase = NULL;
+		}
+	}
+	
+	fReadersMutex.SignalLock();
+}
@@ -38,10 +38,42 @@ typedef enum
 	kSQLTypeDone	= 99
 } SQLValueType;
 
+#define kSQLiteDefaultCacheSize		2		// pages, none of our tables need more, the system disk cache does the work
+#define kSQLiteReadConnections		4
+#define kSQLiteStatementCacheSize	16
+#define kSQLiteReadBusyTimeout		5000	// milliseconds
+
+struct sSQLiteCachedStatement
+{
+	uint32_t		fHash;
+	char			*fCommand;		// SQL text the statement was prepared from
+	sqlite3_stmt	*fStmt;
+	uint64_t		fLastUsed;
+	bool			fInUse;
+};
+
+// writer connection closed while statements from Prepare were still out, it stays open
+// until the last of them comes back through Finalize or FinishRead
+struct sSQLiteRetiredConnection
+{
+	sqlite3							*fDatabase;
+	sSQLiteCachedStatement			fStatements[kSQLiteStatementCacheSize];
+	struct sSQLiteRetiredConnection	*fNext;
+};
+
+struct sSQLiteReadConnection
+{
+	sqlite3					*fDatabase;
+	uint32_t				fGeneration;	// closed instead of reused once the database is reopened
+	bool					fInUse;
+	uint64_t				fClock;
+	sSQLiteCachedStatement	fStatements[kSQLiteStatementCacheSize];
+};
+
 class SQLiteHelper
 {
 	public:
-						SQLiteHelper( const char *inDatabasePath, uint32_t inExpectedVersion );
+						SQLiteHelper( const char *inDatabasePath, uint32_t inExpectedVersion, int inCacheSize = kSQLiteDefaultCacheSize );
 						~SQLiteHelper( void );
 
 		// will return true if succeeds, note it can be an empty database if integrity check fails or an old version
@@ -72,6 +104,13 @@ class SQLiteHelper
 		int				Prepare( const char *command, int length, sqlite3_stmt **stmt, const char **pzTail = NULL );
 		int				Step( sqlite3_stmt *inStmt );
 		int				Finalize( sqlite3_stmt *&inStmt );
+	
+		// runs on one of the read-only connections next to the writer, the statement is stepped
+		// directly with sqlite3_step and must be handed back with FinishRead
+		int				PrepareRead( const char *command, int length, sqlite3_stmt **stmt );
+		void			FinishRead( sqlite3_stmt *&inStmt );
+	
+		void			SetCacheSize( int inPages );
 
 		bool			BeginTransaction( const char *inName = NULL );
 		void			EndTransaction( const char *inName = NULL );
@@ -85,10 +124,29 @@ class SQLiteHelper
 		char				*fDatabasePath;
 		uint32_t			fVersion;
 		bool				fNewDatabase;
+		int					fCacheSize;
+	
+		// prepared statements of the writer connection, under fMutex
+		sSQLiteCachedStatement	fStatements[kSQLiteStatementCacheSize];
+		uint64_t				fStatementClock;
+		sSQLiteRetiredConnection	*fRetired;
+	
+		DSMutexSemaphore		fReadersMutex;
+		sSQLiteReadConnection	fReaders[kSQLiteReadConnections];
+		uint32_t				fGeneration;
 	
 	private:
 		bool		IntegrityCheck( void );
 		bool		IsDatabaseVersionCurrent( void );
+	
+		static int	PrepareCached( sqlite3 *inDatabase, sSQLiteCachedStatement *inCache, uint64_t *ioClock, const char *command,
+								   int length, sqlite3_stmt **outStmt );
+		static bool	ReleaseCached( sSQLiteCachedStatement *inCache, sqlite3_stmt *inStmt );
+		static void	FlushCache( sSQLiteCachedStatement *inCache );
+		int			ReleaseStatement( sqlite3_stmt *inStmt );
+	
+		sSQLiteReadConnection	*AcquireReader( void );
+		void					CloseReaders( void );
 };
 
 #endif
@@ -44,6 +44,7 @@
 #include <libkern/OSAtomic.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <algorithm>
 
 #include "DSCThread.h"		// for GetCurThreadRunState()
 #include "DSTCPEndpoint.h"
@@ -86,11 +87,17 @@ DSTCPEndpoint::DSTCPEndpoint (	const UInt32	inOpenTimeout,
 								int				inSocket ) :
 	mRemoteHostIPAddr (0),
 	mConnectFD (inSocket),
+	mRecvBuffer (NULL),
+	mRecvBufferSize (0),
+	mRecvStart (0),
+	mRecvEnd (0),
 	mWeHaveClosed (false),
 	mOpenTimeout (inOpenTimeout),
 	mRWTimeout (inRWTimeout),
 	mDefaultTimeout(inRWTimeout),
-	fKeyState(eKeyStateAcceptClientKey)
+	fKeyState(eKeyStateAcceptClientKey),
+	fEncryptor(NULL),
+	fDecryptor(NULL)
 
 {
 	memset( &mMySockAddr, 0, sizeof(mMySockAddr) );
@@ -131,6 +138,14 @@ DSTCPEndpoint::~DSTCPEndpoint ( void )
 	{
 	}
 
+	ClearPipeline();
+	DSFree( mRecvBuffer );
+	
+	if ( fEncryptor != NULL )
+		CCCryptorRelease( fEncryptor );
+	if ( fDecryptor != NULL )
+		CCCryptorRelease( fDecryptor );
+	
 	cdsaFreeKey( fcspHandle, &fPrivateKey );
 	cdsaFreeKey( fcspHandle, &fPublicKey );
 	cdsaFreeKey( fcspHandle, &fDerivedKey );
@@ -301,6 +316,10 @@ void DSTCPEndpoint::CloseConnection ( void )
 			mWeHaveClosed = true;
 		}
 	}
+	
+	// anything left over belonged to the old connection
+	mRecvStart = mRecvEnd = 0;
+	ClearPipeline();
 }
 
 
@@ -427,111 +446,197 @@ int DSTCPEndpoint::DoTCPCloseSocket ( const int inSockFD )
 
 
 // ----------------------------------------------------------------------------
-//	* DoTCPRecvFrom ()
+//	* WaitForReadable ()
+//
+//		- blocks until the socket has data or mRWTimeout passes
 // ----------------------------------------------------------------------------
 
-UInt32 DSTCPEndpoint::DoTCPRecvFrom ( void *ioBuffer, const UInt32 inBufferSize )
+void DSTCPEndpoint::WaitForReadable ( void )
 {
+	struct pollfd	fdToPoll;
 	int				rc;
 	int				err;
-	int				bytesRead = 0;
-	fd_set			readSet;
-	struct timeval	tvTimeout		= { mRWTimeout, 0 };
-	struct timeval	tvTimeoutTime	= { mRWTimeout, 0 };
-	time_t			timeoutTime;
-
-	timeoutTime = ::time( NULL ) + mRWTimeout;
-
-	::gettimeofday (&tvTimeoutTime, NULL);
-	tvTimeoutTime.tv_sec += mRWTimeout;
+	time_t			timeoutTime = ::time( NULL ) + mRWTimeout;
+	
+	fdToPoll.fd = mConnectFD;
+	fdToPoll.events = POLLIN;
 	
 	do {
-		FD_ZERO( &readSet );
-		FD_SET( mConnectFD, &readSet );
-
-		rc = ::select( mConnectFD+1, &readSet, NULL, NULL, &tvTimeout );
-
-		// Recompute the timeout and break if timeout exceeded.
-		if ( (rc == -1) && (EINTR == errno) )
-		{
-			struct timeval	tvNow;
-			::gettimeofday( &tvNow, NULL );
-			timersub( &tvTimeoutTime, &tvNow, &tvTimeout );
-			if ( tvTimeout.tv_sec < 0 )
-			{
-#ifdef DSSERVERTCP
-				DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom: connection timeout?" );
-#else
-				LOG( kStdErr, "DoTCPRecvFrom: connection timeout?" );
-#endif
-				throw( (SInt32)eDSTCPReceiveError );
-			}
-		}
+		time_t remaining = timeoutTime - ::time( NULL );
+		
+		fdToPoll.revents = 0;
+		rc = ::poll( &fdToPoll, 1, (remaining > 0 ? (int) remaining * 1000 : 0) );
 	} while ( (rc == -1) && (EINTR == errno) );
-
-
+	
 	if ( rc == 0 )
 	{
 #ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom: timed out waiting for response." );
+		DbgLog( kLogTCPEndpoint, "WaitForReadable: timed out waiting for response." );
 #else
-			LOG( kStdErr, "DoTCPRecvFrom: timed out waiting for response." );
+		LOG( kStdErr, "WaitForReadable: timed out waiting for response." );
 #endif
-			throw( (SInt32)kTimeoutError );
+		throw( (SInt32)kTimeoutError );
 	}
 	else if ( rc == -1 )
 	{
- 		err = errno;
+		err = errno;
 #ifdef DSSERVERTCP
-		DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom: select() error %d: %s", err, strerror(err) );
+		DbgLog( kLogTCPEndpoint, "WaitForReadable: poll() error %d: %s", err, strerror(err) );
 #else
-		LOG2( kStdErr, "DoTCPRecvFrom: select() error %d: %s", err, strerror(err) );
+		LOG2( kStdErr, "WaitForReadable: poll() error %d: %s", err, strerror(err) );
 #endif
-		throw((SInt32)eDSTCPReceiveError);
-	} 
-	else if ( FD_ISSET(mConnectFD, &readSet) )
+		throw( (SInt32)eDSTCPReceiveError );
+	}
+	
+} // WaitForReadable
+
+
+// ----------------------------------------------------------------------------
+//	* ReceiveAvailable ()
+//
+//		- one non-blocking read of whatever the socket has into mRecvBuffer,
+//		  returns 0 if nothing was there and inWait is false
+// ----------------------------------------------------------------------------
+
+UInt32 DSTCPEndpoint::ReceiveAvailable ( bool inWait )
+{
+	ssize_t		bytesRead	= 0;
+	int			err			= 0;
+	
+	if ( mRecvBuffer == NULL )
 	{
-		// socket is ready for read - blocks until all read
-		//KW need a socket level timeout for this read to complete ie. setsocketopt call with SO_RCVTIMEO
-		//bytesRead = ::recvfrom( mConnectFD, ioBuffer, inBufferSize, MSG_DONTWAIT, NULL, NULL );
-		do
-		{
-			bytesRead = ::recvfrom( mConnectFD, ioBuffer, inBufferSize, MSG_WAITALL, NULL, NULL );
+		mRecvBufferSize = kDSTCPEndpointRecvBufferSize;
+		mRecvBuffer = (char *) malloc( mRecvBufferSize );
+		if ( mRecvBuffer == NULL )
+			throw( (SInt32)eMemoryAllocError );
+	}
 	
-		} while ( (bytesRead == -1) && (errno == EAGAIN) );
+	// slide the unconsumed bytes to the front so the read gets the most room
+	if ( mRecvStart > 0 )
+	{
+		if ( mRecvEnd > mRecvStart )
+			memmove( mRecvBuffer, mRecvBuffer + mRecvStart, mRecvEnd - mRecvStart );
+		mRecvEnd -= mRecvStart;
+		mRecvStart = 0;
+	}
+	
+	if ( mRecvEnd == mRecvBufferSize )
+		return 0;
+	
+	do
+	{
+		if ( inWait )
+			WaitForReadable();
+		
+		bytesRead = ::recv( mConnectFD, mRecvBuffer + mRecvEnd, mRecvBufferSize - mRecvEnd, MSG_DONTWAIT );
+		if ( bytesRead > 0 )
+			break;
 		
 		if ( bytesRead == 0 )
 		{
 			// connection closed from the other side
-			err = errno;
 #ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom: connection closed by peer - error is %d", err );
+			DbgLog( kLogTCPEndpoint, "ReceiveAvailable: connection closed by peer" );
 #else
-			LOG1( kStdErr, "DoTCPRecvFrom: connection closed by peer - error is %d", err );
+			LOG( kStdErr, "ReceiveAvailable: connection closed by peer" );
 #endif
 			throw( (SInt32)eDSTCPReceiveError );
 		}
-		else if ( bytesRead == -1 )
+		
+		err = errno;
+		if ( err != EAGAIN && err != EINTR )
 		{
-			err = errno;
 #ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom: recvfrom error %d: %s", err, strerror(err) );
+			DbgLog( kLogTCPEndpoint, "ReceiveAvailable: recv error %d: %s", err, strerror(err) );
 #else
-			LOG2( kStdErr, "DoTCPRecvFrom: recvfrom error %d: %s", err, strerror(err) );
+			LOG2( kStdErr, "ReceiveAvailable: recv error %d: %s", err, strerror(err) );
 #endif
 			throw( (SInt32)eDSTCPReceiveError );
 		}
-		else
-		{
+		
+	} while ( inWait || err == EINTR );
+	
+	if ( bytesRead < 0 )
+		return 0;
+	
+	mRecvEnd += bytesRead;
+	
 #ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "DoTCPRecvFrom(): received %d bytes with endpoint %ld and connectFD %d", bytesRead, (long)this, mConnectFD );
+	DbgLog( kLogTCPEndpoint, "ReceiveAvailable: received %d bytes with endpoint %ld and connectFD %d", (int) bytesRead, (long)this, mConnectFD );
 #else
-			LOG3( kStdErr, "DoTCPRecvFrom(): received %d bytes with endpoint %ld and connectFD %d", bytesRead, (long)this, mConnectFD );
+	LOG3( kStdErr, "ReceiveAvailable: received %d bytes with endpoint %ld and connectFD %d", (int) bytesRead, (long)this, mConnectFD );
 #endif
-		}
+	
+	return (UInt32) bytesRead;
+	
+} // ReceiveAvailable
+
+
+// ----------------------------------------------------------------------------
+//	* ParseFrameHeader ()
+//
+//		- finds the "DSPX" tag in the buffered bytes and returns the length
+//		  that follows it, the header is left in the buffer.  Anything that
+//		  does not start a frame is discarded so we resync on the next tag.
+// ----------------------------------------------------------------------------
+
+bool DSTCPEndpoint::ParseFrameHeader ( UInt32 *outFrameLen )
+{
+	UInt32	buffLen;
+	UInt32	skipped	= 0;
+	
+	while ( mRecvEnd - mRecvStart >= kDSTCPEndpointMessageTagSize )
+	{
+		if ( memcmp(mRecvBuffer + mRecvStart, "DSPX", kDSTCPEndpointMessageTagSize) == 0 )
+			break;
+		
+		mRecvStart++;
+		skipped++;
 	}
+	
+	if ( skipped > 0 )
+	{
+#ifdef DSSERVERTCP
+		DbgLog( kLogTCPEndpoint, "ParseFrameHeader: skipped %d bytes looking for the message tag", skipped );
+#else
+		LOG1( kStdErr, "ParseFrameHeader: skipped %d bytes looking for the message tag", skipped );
+#endif
+	}
+	
+	if ( mRecvEnd - mRecvStart < kDSTCPEndpointFrameHeaderSize )
+		return false;
+	
+	memcpy( &buffLen, mRecvBuffer + mRecvStart + kDSTCPEndpointMessageTagSize, sizeof(buffLen) );
+	(*outFrameLen) = ntohl( buffLen );
+	
+	return true;
+	
+} // ParseFrameHeader
+
 
-	return( (UInt32)bytesRead );
+// ----------------------------------------------------------------------------
+//	* DoTCPRecvFrom ()
+// ----------------------------------------------------------------------------
+
+UInt32 DSTCPEndpoint::DoTCPRecvFrom ( void *ioBuffer, const UInt32 inBufferSize )
+{
+	UInt32	copied	= 0;
+	
+	while ( copied < inBufferSize )
+	{
+		if ( mRecvStart == mRecvEnd )
+			ReceiveAvailable( true );
+		
+		UInt32 available = mRecvEnd - mRecvStart;
+		if ( available > inBufferSize - copied )
+			available = inBufferSize - copied;
+		
+		memcpy( (char *) ioBuffer + copied, mRecvBuffer + mRecvStart, available );
+		mRecvStart += available;
+		copied += available;
+	}
+	
+	return( copied );
 
 } // DoTCPRecvFrom
 
@@ -543,138 +648,134 @@ UInt32 DSTCPEndpoint::DoTCPRecvFrom ( void *ioBuffer, const UInt32 inBufferSize
 
 SInt32 DSTCPEndpoint::SyncToMessageBody(const Boolean inStripLeadZeroes, UInt32 *outBuffLen)
 {
-	UInt32			index = 0;
-	UInt32			readBytes = 0;
-	UInt32			newLen = 0;
-	UInt32			curIndex = kDSTCPEndpointMessageTagSize;
-	char		   *ourBuffer;
-	UInt32			buffLen = 0;
-	SInt32			result	= eDSNoErr;
-
-	ourBuffer = (char *) calloc(kDSTCPEndpointMaxMessageSize, 1);
+	UInt32	buffLen	= 0;
+	
+	// leading zeroes and anything else before the tag are skipped by ParseFrameHeader
+	(*outBuffLen) = 0;
 	
-	try 
+	try
 	{
-		readBytes = DoTCPRecvFrom(ourBuffer, kDSTCPEndpointMessageTagSize);
-		
-		if (readBytes != kDSTCPEndpointMessageTagSize)
-		{
-			//couldn't read even the minimum tag size so return zero
-			free(ourBuffer);
-			*outBuffLen = 0;
-#ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "SyncToMessageBody: attempted read of %d bytes failed with %d bytes read", kDSTCPEndpointMessageTagSize, readBytes );
-#else
-			LOG2( kStdErr, "SyncToMessageBody: attempted read of %d bytes failed with %d bytes read", kDSTCPEndpointMessageTagSize, readBytes );
-#endif
-			return eDSTCPReceiveError;
-		}
+		while ( ParseFrameHeader(&buffLen) == false )
+			ReceiveAvailable( true );
 	}
 	catch( SInt32 err )
 	{
-		if (ourBuffer != nil)
-		{
-			free(ourBuffer);
-		}
 #ifdef DSSERVERTCP
-		DbgLog( kLogTCPEndpoint, "SyncToMessageBody: attempted read of %d bytes failed in DoTCPRecvFrom with error %d", kDSTCPEndpointMessageTagSize, err );
+		DbgLog( kLogTCPEndpoint, "SyncToMessageBody: failed to read the message header with error %d", err );
 #else
-		LOG2( kStdErr, "SyncToMessageBody: attempted read of %d bytes failed in DoTCPRecvFrom with error %d", kDSTCPEndpointMessageTagSize, err );
+		LOG1( kStdErr, "SyncToMessageBody: failed to read the message header with error %d", err );
 #endif
 		return eDSTCPReceiveError;
 	}
 	
-	//TODO need to handle corrupted data? ie. continue searching for tag?
-	if (inStripLeadZeroes)
-	{
-		// strip any leading zeroes
-		for ( index=0; (index < kDSTCPEndpointMessageTagSize) && (ourBuffer[index] == 0x00); index++ )
-		{
-			readBytes--;
-		}
+	mRecvStart += kDSTCPEndpointFrameHeaderSize;
+	(*outBuffLen) = buffLen;
 	
-		try
+	return eDSNoErr;
+
+} // SyncToMessageBody
+
+
+// ----------------------------------------------------------------------------
+// * CopyNextFrame():	returns the next complete frame body without blocking
+// ----------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::CopyNextFrame( void **outFrame, UInt32 *outFrameLen )
+{
+	UInt32	frameLen	= 0;
+	
+	(*outFrame) = NULL;
+	(*outFrameLen) = 0;
+	
+	try
+	{
+		do
 		{
-			//keep reading one at a time if we encounter any leading zeroes
-			//don't expect this to ever happen
-			while ( (readBytes < kDSTCPEndpointMessageTagSize) && (curIndex < kDSTCPEndpointMaxMessageSize) )
+			if ( mRecvBuffer == NULL || ParseFrameHeader(&frameLen) == false )
+				continue;
+			
+			UInt32 needed = kDSTCPEndpointFrameHeaderSize + frameLen;
+			if ( needed < frameLen )
+				throw( (SInt32)eDSTCPReceiveError );
+			
+			if ( mRecvEnd - mRecvStart >= needed )
 			{
-				newLen = DoTCPRecvFrom(ourBuffer+curIndex, 1);
-				if (newLen != 1)
-				{
-					//couldn't read even one byte so return zero
-					free(ourBuffer);
-					*outBuffLen = 0;
-#ifdef DSSERVERTCP
-					DbgLog( kLogTCPEndpoint, "SyncToMessageBody: align frame by skipping leading zeroes - attempted read of one byte failed with %d bytes read", newLen );
-#else
-					LOG1( kStdErr, "SyncToMessageBody: align frame by skipping leading zeroes - attempted read of one byte failed with %d bytes read", newLen );
-#endif
-					return eDSTCPReceiveError;
-				}
-				if (ourBuffer[curIndex] != 0x00)
+				void *frame = malloc( frameLen > 0 ? frameLen : 1 );
+				if ( frame == NULL )
+					throw( (SInt32)eMemoryAllocError );
+				
+				memcpy( frame, mRecvBuffer + mRecvStart + kDSTCPEndpointFrameHeaderSize, frameLen );
+				mRecvStart += needed;
+				
+				// don't hang on to the room a large frame needed
+				if ( mRecvStart == mRecvEnd && mRecvBufferSize > kDSTCPEndpointRecvBufferSize )
 				{
-					readBytes++;
+					DSFree( mRecvBuffer );
+					mRecvBufferSize = 0;
+					mRecvStart = mRecvEnd = 0;
 				}
-				curIndex++;
+				
+				(*outFrame) = frame;
+				(*outFrameLen) = frameLen;
+				break;
 			}
-		}		
-		catch( SInt32 err )
-		{
-			if (ourBuffer != nil)
+			
+			// make room for the whole frame, ReceiveAvailable moves the header to the front
+			if ( needed > mRecvBufferSize )
 			{
-				free(ourBuffer);
+				char *newBuffer = (char *) realloc( mRecvBuffer, needed );
+				if ( newBuffer == NULL )
+					throw( (SInt32)eMemoryAllocError );
+				
+				mRecvBuffer = newBuffer;
+				mRecvBufferSize = needed;
 			}
+			
+		} while ( ReceiveAvailable(false) > 0 );
+	}
+	catch( SInt32 err )
+	{
 #ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "SyncToMessageBody: align frame by skipping leading zeroes - failed in DoTCPRecvFrom with error %l", err );
+		DbgLog( kLogTCPEndpoint, "CopyNextFrame: failed with error %d", err );
 #else
-			LOG1( kStdErr, "SyncToMessageBody: align frame by skipping leading zeroes - failed in DoTCPRecvFrom with error %l", err );
+		LOG1( kStdErr, "CopyNextFrame: failed with error %d", err );
 #endif
-			return eDSTCPReceiveError;
-		}
+		return eDSTCPReceiveError;
 	}
+	
+	return eDSNoErr;
+	
+} // CopyNextFrame
+
 
-	//check if we found the tag we are looking for
-	if ( (readBytes == kDSTCPEndpointMessageTagSize) && (strncmp(ourBuffer+curIndex-kDSTCPEndpointMessageTagSize,"DSPX",kDSTCPEndpointMessageTagSize) == 0) )
+// ----------------------------------------------------------------------------
+// * ReadFrame():	blocking version of CopyNextFrame
+// ----------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::ReadFrame( void **outFrame, UInt32 *outFrameLen )
+{
+	SInt32	result	= eDSNoErr;
+	
+	do
 	{
+		result = CopyNextFrame( outFrame, outFrameLen );
+		if ( result != eDSNoErr || (*outFrame) != NULL )
+			break;
+		
 		try
 		{
-			//now get the buffer length
-			//check here to determine if buffLen is at least sizeof(sComData)
-			newLen = DoTCPRecvFrom(&buffLen , 4);
-			if (newLen != 4) //|| (buffLen < sizeof(sComData)) )
-			{
-#ifdef DSSERVERTCP
-				DbgLog( kLogTCPEndpoint, "SyncToMessageBody: get the buffer length - attempted read of four bytes failed with %d bytes read", newLen );
-#else
-				LOG1( kStdErr, "SyncToMessageBody: get the buffer length - attempted read of four bytes failed with %d bytes read", newLen );
-#endif
-				*outBuffLen = 0;
-			}
-			else
-			{
-				*outBuffLen = ntohl(buffLen);
-			}
-		}		
+			WaitForReadable();
+		}
 		catch( SInt32 err )
 		{
-			if (ourBuffer != nil)
-			{
-				free(ourBuffer);
-			}
-#ifdef DSSERVERTCP
-			DbgLog( kLogTCPEndpoint, "SyncToMessageBody: get the buffer length - failed in DoTCPRecvFrom with error %l", err );
-#else
-			LOG1( kStdErr, "SyncToMessageBody: get the buffer length - failed in DoTCPRecvFrom with error %l", err );
-#endif
-			return eDSTCPReceiveError;
+			result = eDSTCPReceiveError;
 		}
-	}
+		
+	} while ( result == eDSNoErr );
 	
-	free(ourBuffer);
 	return result;
-
-} // SyncToMessageBody
+	
+} // ReadFrame
 
 
 //------------------------------------------------------------------------------
@@ -685,25 +786,42 @@ SInt32 DSTCPEndpoint::SyncToMessageBody(const Boolean inStripLeadZeroes, UInt32
 SInt32 DSTCPEndpoint::SendBuffer ( void *inBuffer, UInt32 inLength )
 {
 	SInt32				result		= eDSNoErr;
-	UInt32				sendBuffLen = sizeof("DSPX") + sizeof(UInt32) + inLength;
+	UInt32				sendBuffLen = kDSTCPEndpointFrameHeaderSize + inLength;
 	char				*sendBuff	= (char *) calloc( sendBuffLen, sizeof(char) );
-	uint32_t			offset		= 0;
 	
 	bcopy( "DSPX", sendBuff, kDSTCPEndpointMessageTagSize );
 	*((UInt32 *) (sendBuff + kDSTCPEndpointMessageTagSize)) = htonl( inLength );
-	bcopy( inBuffer, sendBuff + kDSTCPEndpointMessageTagSize + sizeof(UInt32), inLength);
+	bcopy( inBuffer, sendBuff + kDSTCPEndpointFrameHeaderSize, inLength);
+
+	result = SendFrame( sendBuff, sendBuffLen );
+	
+	DSFree( sendBuff );
+
+	return result;
+
+} // SendBuffer
+
 
+//------------------------------------------------------------------------------
+//	* SendFrame
+//
+//		- writes a frame that already has its tag and length
+//------------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::SendFrame ( char *inFrame, UInt32 inFrameLen )
+{
+	uint32_t			offset		= 0;
+	
 	// TODO: use dispatch, but not yet (wait until we redo this class to use it completely)
 	do
 	{
-		ssize_t sentBytes = send( mConnectFD, sendBuff + offset, sendBuffLen - offset, 0 );
+		ssize_t sentBytes = send( mConnectFD, inFrame + offset, inFrameLen - offset, 0 );
 		if ( sentBytes < 0 ) {
 			switch ( errno ) {
 				case EINTR:
 				case EAGAIN:
 					break;
 				default:
-					DSFree( sendBuff );
 					return eDSTCPSendError;
 			}
 		}
@@ -711,7 +829,7 @@ SInt32 DSTCPEndpoint::SendBuffer ( void *inBuffer, UInt32 inLength )
 			offset += sentBytes;
 		}
 		
-		if ( offset < sendBuffLen ) {
+		if ( offset < inFrameLen ) {
 			
 			fd_set	writeSet;
 			struct timeval tvTimeout = { 10, 0 };
@@ -726,11 +844,76 @@ SInt32 DSTCPEndpoint::SendBuffer ( void *inBuffer, UInt32 inLength )
 		break;
 	} while ( 1 );
 	
-	DSFree( sendBuff );
+	return eDSNoErr;
 
-	return result;
+} // SendFrame
 
-} // SendBuffer
+
+//------------------------------------------------------------------------------
+//	* CreateSessionCryptors
+//
+//		- CommonCrypto picks the AES instructions of the CPU when it has them.
+//		  Same AES-128 CBC, PKCS7 and zero IV as the CDSA path so the other side
+//		  can't tell the difference.
+//------------------------------------------------------------------------------
+
+bool DSTCPEndpoint::CreateSessionCryptors ( void )
+{
+	static const uint8_t zeroIV[kCCBlockSizeAES128] = { 0 };
+	
+	if ( fEncryptor != NULL && fDecryptor != NULL )
+		return true;
+	
+	if ( fKeyState != eKeyStateValidKey || fDerivedKey.KeyData.Data == NULL || fDerivedKey.KeyData.Length != kCCKeySizeAES128 )
+		return false;
+	
+	if ( fEncryptor == NULL && CCCryptorCreate(kCCEncrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, fDerivedKey.KeyData.Data,
+											   fDerivedKey.KeyData.Length, zeroIV, &fEncryptor) != kCCSuccess )
+	{
+		fEncryptor = NULL;
+		return false;
+	}
+	
+	if ( fDecryptor == NULL && CCCryptorCreate(kCCDecrypt, kCCAlgorithmAES128, kCCOptionPKCS7Padding, fDerivedKey.KeyData.Data,
+											   fDerivedKey.KeyData.Length, zeroIV, &fDecryptor) != kCCSuccess )
+	{
+		fDecryptor = NULL;
+		return false;
+	}
+	
+	return true;
+	
+} // CreateSessionCryptors
+
+
+//------------------------------------------------------------------------------
+//	* SessionCrypt
+//
+//		- every message starts over from the zero IV, outData may be inData
+//------------------------------------------------------------------------------
+
+CCCryptorStatus DSTCPEndpoint::SessionCrypt ( CCCryptorRef inCryptor, const void *inData, size_t inDataLen, void *outData,
+											  size_t inOutDataSize, size_t *outDataLen )
+{
+	static const uint8_t	zeroIV[kCCBlockSizeAES128] = { 0 };
+	size_t					moved	= 0;
+	size_t					total	= 0;
+	CCCryptorStatus			status	= CCCryptorReset( inCryptor, zeroIV );
+	
+	if ( status == kCCSuccess )
+		status = CCCryptorUpdate( inCryptor, inData, inDataLen, outData, inOutDataSize, &moved );
+	
+	if ( status == kCCSuccess ) {
+		total = moved;
+		status = CCCryptorFinal( inCryptor, (char *) outData + total, inOutDataSize - total, &moved );
+		total += moved;
+	}
+	
+	(*outDataLen) = (status == kCCSuccess ? total : 0);
+	
+	return status;
+	
+} // SessionCrypt
 
 
 //------------------------------------------------------------------------------
@@ -739,6 +922,21 @@ SInt32 DSTCPEndpoint::SendBuffer ( void *inBuffer, UInt32 inLength )
 //------------------------------------------------------------------------------
 
 SInt32 DSTCPEndpoint::SendMessage( sComData *inMsg )
+{
+	UInt32	msgID	= 0;
+	
+	return SendPipelinedMessage( inMsg, &msgID );
+} // SendMessage
+
+
+//------------------------------------------------------------------------------
+//	* SendPipelinedMessage
+//
+//		- sends without waiting for earlier replies, up to kDSTCPEndpointMaxInFlight
+//		  requests can be outstanding before we start reading replies ahead
+//------------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::SendPipelinedMessage( sComData *inMsg, UInt32 *outMsgID )
 {
 	UInt32			messageSize = 0;
 	sComProxyData  *inProxyMsg  = nil;
@@ -746,6 +944,16 @@ SInt32 DSTCPEndpoint::SendMessage( sComData *inMsg )
 	void			*outBuffer	= NULL;
 	UInt32			outLength	= 0;
 	
+	(*outMsgID) = 0;
+	
+	// window is full, read replies ahead so the server isn't left blocked writing them
+	while ( mInFlight.size() - mReplies.size() >= kDSTCPEndpointMaxInFlight )
+	{
+		sendResult = ReceiveNextReply();
+		if ( sendResult != eDSNoErr )
+			return sendResult;
+	}
+	
 	inProxyMsg = AllocToProxyStruct( (sComData *)inMsg );
 	
 	//let us only send the data that is present and not the entire buffer
@@ -754,70 +962,214 @@ SInt32 DSTCPEndpoint::SendMessage( sComData *inMsg )
 	
 	inProxyMsg->fIPAddress = mRemoteHostIPAddr;
 	inProxyMsg->fPID = ntohs( mRemoteSockAddr.sin_port );
-	inProxyMsg->fMsgID = OSAtomicIncrement32( &mMessageID );
+	
+	// 0 is what a server that doesn't echo IDs sends back, never hand it out
+	do {
+		inProxyMsg->fMsgID = OSAtomicIncrement32( &mMessageID );
+	} while ( inProxyMsg->fMsgID == 0 );
+	
+	UInt32 msgID = inProxyMsg->fMsgID;
 	
 	if ( inProxyMsg->type.msgt_translate != 2 ) {
 		SwapProxyMessage( inProxyMsg, kDSSwapHostToNetworkOrder );
 	}
 
-	ProcessData( true, inProxyMsg, messageSize, outBuffer, outLength );
-
-	sendResult = SendBuffer( outBuffer, outLength );
+	if ( CreateSessionCryptors() )
+	{
+		// encrypt straight into the frame we send instead of into a buffer that gets copied
+		size_t	frameSize	= kDSTCPEndpointFrameHeaderSize + CCCryptorGetOutputLength( fEncryptor, messageSize, true );
+		size_t	cipherLen	= 0;
+		char	*frame		= (char *) malloc( frameSize );
+		
+		if ( frame != NULL && SessionCrypt(fEncryptor, inProxyMsg, messageSize, frame + kDSTCPEndpointFrameHeaderSize,
+										   frameSize - kDSTCPEndpointFrameHeaderSize, &cipherLen) == kCCSuccess )
+		{
+			bcopy( "DSPX", frame, kDSTCPEndpointMessageTagSize );
+			*((UInt32 *) (frame + kDSTCPEndpointMessageTagSize)) = htonl( (UInt32) cipherLen );
+			
+			sendResult = SendFrame( frame, kDSTCPEndpointFrameHeaderSize + (UInt32) cipherLen );
+		}
+		else
+		{
+			sendResult = eDSTCPSendError;
+		}
+		
+		DSFree( frame );
+	}
+	else
+	{
+		ProcessData( true, inProxyMsg, messageSize, outBuffer, outLength );
+		
+		sendResult = SendBuffer( outBuffer, outLength );
+	}
+	
+	if ( sendResult == eDSNoErr ) {
+		mInFlight.push_back( msgID );
+		(*outMsgID) = msgID;
+	}
 	
 	DSFree( inProxyMsg );
 	DSFree( outBuffer );
 	
 	return sendResult;
-} // SendMessage
+} // SendPipelinedMessage
 
 
 //------------------------------------------------------------------------------
 //	* GetReplyMessage
+//
+//		- reply to the oldest outstanding request
 //------------------------------------------------------------------------------
 
 SInt32 DSTCPEndpoint::GetReplyMessage( sComData **outMsg )
+{
+	if ( mInFlight.empty() )
+		return ReadReplyMessage( outMsg );
+	
+	// send order, the IDs themselves wrap
+	return GetPipelinedReply( outMsg, mInFlight.front() );
+} // GetReplyMessage
+
+
+//------------------------------------------------------------------------------
+//	* GetPipelinedReply
+//------------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::GetPipelinedReply( sComData **outMsg, UInt32 inMsgID )
+{
+	std::map<UInt32, sComData *>::iterator	iter;
+	SInt32									siResult	= eDSNoErr;
+	
+	// never sent or its reply was already taken
+	if ( std::find(mInFlight.begin(), mInFlight.end(), inMsgID) == mInFlight.end() )
+		return eDSTCPReceiveError;
+	
+	while ( (iter = mReplies.find(inMsgID)) == mReplies.end() )
+	{
+		siResult = ReceiveNextReply();
+		if ( siResult != eDSNoErr )
+			return siResult;
+	}
+	
+	(*outMsg) = iter->second;
+	mReplies.erase( iter );
+	mInFlight.erase( std::find(mInFlight.begin(), mInFlight.end(), inMsgID) );
+	
+	return eDSNoErr;
+} // GetPipelinedReply
+
+
+//------------------------------------------------------------------------------
+//	* ReceiveNextReply
+//
+//		- reads one reply off the connection and files it under its request
+//------------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::ReceiveNextReply( void )
+{
+	sComData	*reply		= NULL;
+	SInt32		siResult	= eDSNoErr;
+	
+	if ( mInFlight.size() == mReplies.size() )
+		return eDSTCPReceiveError;
+	
+	siResult = ReadReplyMessage( &reply );
+	if ( siResult == eDSNoErr && reply == NULL )
+		siResult = eDSTCPReceiveError;
+	
+	if ( siResult != eDSNoErr )
+	{
+		// we can't tell which request lost its reply, so none of them will get one
+		ClearPipeline();
+		return siResult;
+	}
+	
+	std::deque<UInt32>::iterator iter = mInFlight.begin();
+	
+	if ( reply->fMsgID == 0 )
+	{
+		// a server that doesn't echo the ID still answers in order, so it's the oldest still waiting
+		while ( iter != mInFlight.end() && mReplies.find(*iter) != mReplies.end() )
+			iter++;
+	}
+	else
+	{
+		iter = std::find( mInFlight.begin(), mInFlight.end(), (UInt32) reply->fMsgID );
+		if ( iter != mInFlight.end() && mReplies.find(*iter) != mReplies.end() )
+			iter = mInFlight.end();
+	}
+	
+	if ( iter == mInFlight.end() )
+	{
+		// not a reply to anything we're waiting on, the stream is out of step
+		DbgLog( kLogTCPEndpoint, "ReceiveNextReply: reply for unknown message ID %u", (UInt32) reply->fMsgID );
+		free( reply );
+		ClearPipeline();
+		return eDSTCPReceiveError;
+	}
+	
+	mReplies[*iter] = reply;
+	
+	return eDSNoErr;
+} // ReceiveNextReply
+
+
+//------------------------------------------------------------------------------
+//	* ClearPipeline
+//------------------------------------------------------------------------------
+
+void DSTCPEndpoint::ClearPipeline( void )
+{
+	for ( std::map<UInt32, sComData *>::iterator iter = mReplies.begin(); iter != mReplies.end(); iter++ )
+		free( iter->second );
+	
+	mReplies.clear();
+	mInFlight.clear();
+} // ClearPipeline
+
+
+//------------------------------------------------------------------------------
+//	* ReadReplyMessage
+//------------------------------------------------------------------------------
+
+SInt32 DSTCPEndpoint::ReadReplyMessage( sComData **outMsg )
 {
 	SInt32					siResult		= eDSNoErr;
 	UInt32					buffLen			= 0;
-	UInt32					readBytes 		= 0;
 	void				   *inBuffer		= nil;
 	UInt32					inLength		= 0;
 	sComProxyData		   *outProxyMsg		= nil;
 
-	//need to read a tag and then a buffer length
-	siResult = SyncToMessageBody(true, &inLength);
+	//the tag, buffer length and message body usually arrive in one read
+	siResult = ReadFrame( &inBuffer, &inLength );
 	
-	if ( (siResult == eDSNoErr) && (inLength != 0) )
+	if ( (siResult == eDSNoErr) && (inLength != 0) && CreateSessionCryptors() )
 	{
-		try
+		// plaintext is never longer than the ciphertext so decrypt where it is
+		size_t plainLen = 0;
+		
+		if ( SessionCrypt(fDecryptor, inBuffer, inLength, inBuffer, inLength, &plainLen) == kCCSuccess && plainLen >= sizeof(sComProxyData) )
 		{
-			//go ahead and read the message body of length inLength
-			//put the message data into inBuffer
-			inBuffer = (void *)calloc(1,inLength);
-			readBytes = DoTCPRecvFrom(inBuffer, inLength);
-			if (readBytes != inLength)
-			{
-				//TODO need to recover somehow
-				LOG( kStdErr, "GetServerReply: Couldn't read entire message block" );
-				siResult = eDSTCPReceiveError;
-			}
-			else
-			{
-				void *tmpOutMsg = nil;
-				ProcessData( false, inBuffer, inLength, tmpOutMsg, buffLen );
-				outProxyMsg = (sComProxyData *)tmpOutMsg;
-				if (buffLen == 0)
-				{
-					free(outProxyMsg);
-					outProxyMsg	= (sComProxyData *)inBuffer;
-					inBuffer	= nil;
-					buffLen		= inLength;
-				}
-			}
+			outProxyMsg	= (sComProxyData *)inBuffer;
+			inBuffer	= nil;
+			buffLen		= (UInt32) plainLen;
 		}
-		catch( SInt32 err )
+		else
+		{
+			siResult = eDSCorruptBuffer;
+		}
+	}
+	else if ( (siResult == eDSNoErr) && (inLength != 0) )
+	{
+		void *tmpOutMsg = nil;
+		ProcessData( false, inBuffer, inLength, tmpOutMsg, buffLen );
+		outProxyMsg = (sComProxyData *)tmpOutMsg;
+		if (buffLen == 0)
 		{
-			siResult = eDSTCPReceiveError;
+			free(outProxyMsg);
+			outProxyMsg	= (sComProxyData *)inBuffer;
+			inBuffer	= nil;
+			buffLen		= inLength;
 		}
 	}
 	
@@ -840,7 +1192,7 @@ SInt32 DSTCPEndpoint::GetReplyMessage( sComData **outMsg )
 
 	return( siResult );
 
-} // GetReplyMessage
+} // ReadReplyMessage
 
 //------------------------------------------------------------------------------
 //	* ClientNegotiateKey
@@ -870,19 +1222,9 @@ SInt32 DSTCPEndpoint::ClientNegotiateKey( void )
 			DSFree( sendBuff );
 		}
 		
-		// read the buffer len
+		// read the reply
 		if ( result == eDSNoErr ) {
-			result = SyncToMessageBody( true, &recvBuffLen );
-		}
-		
-		// read the payload
-		if ( result == eDSNoErr ) {
-			recvBuff = (UInt8 *) calloc( recvBuffLen, sizeof(char) );
-			
-			UInt32 readBytes = DoTCPRecvFrom( recvBuff, recvBuffLen );
-			if ( readBytes != recvBuffLen ) {
-				result = eDSCorruptBuffer;
-			}
+			result = ReadFrame( &recvBuff, &recvBuffLen );
 		}
 		
 	} while ( result == eDSNoErr );
@@ -1127,7 +1469,25 @@ SInt32 DSTCPEndpoint::ProcessData( bool bEncrypt, void *inBuffer, UInt32 inBuffe
 			
 		case eKeyStateValidKey:
 			outBufferLen = 0;
-			if ( fDerivedKey.KeyData.Data != NULL )
+			if ( CreateSessionCryptors() )
+			{
+				CCCryptorRef	cryptor		= (bEncrypt ? fEncryptor : fDecryptor);
+				size_t			outSize		= CCCryptorGetOutputLength( cryptor, inBufferLen, true );
+				size_t			outLength	= 0;
+				
+				outBuffer = malloc( outSize > 0 ? outSize : 1 );
+				if ( outBuffer != NULL && SessionCrypt(cryptor, inBuffer, inBufferLen, outBuffer, outSize, &outLength) == kCCSuccess )
+				{
+					outBufferLen = (UInt32) outLength;
+					DbgLog( kLogDebug, "DSTCPEndpointProcessData - %s data - length %d", (bEncrypt ? "Encrypted" : "Decrypted"), outBufferLen );
+					result = eDSNoErr;
+				}
+				else
+				{
+					DSFree( outBuffer );
+				}
+			}
+			else if ( fDerivedKey.KeyData.Data != NULL )
 			{
 				if ( bEncrypt == true )
 				{
@@ -32,6 +32,9 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>		// struct sockaddr_in
+#include <map>
+#include <deque>
+#include <CommonCrypto/CommonCryptor.h>
 
 #include "DSNetworkUtilities.h"		// for some constants
 #include "SharedConsts.h"
@@ -65,6 +68,9 @@ const UInt32	kTCPErrorBufferLen		= 256;
 
 const UInt32 kDSTCPEndpointMaxMessageSize	= 1024; //used for searching for the TCP message tag
 const UInt32 kDSTCPEndpointMessageTagSize	= 4;	//for "DSPX" tag
+const UInt32 kDSTCPEndpointFrameHeaderSize	= 8;	//tag plus length
+const UInt32 kDSTCPEndpointRecvBufferSize	= 64 * 1024;
+const UInt32 kDSTCPEndpointMaxInFlight		= 8;	//requests sent whose replies have not been read yet
 
 // ----------------------------------------------------------------------------
 // DSTCPEndpoint: implementation of endpoint based on BSD sockets.
@@ -95,6 +101,8 @@ public:
 
 	virtual SInt32	SendMessage			( sComData *inMessage );
 	virtual SInt32	GetReplyMessage		( sComData **outMessage );
+	SInt32			SendPipelinedMessage( sComData *inMessage, UInt32 *outMsgID );
+	SInt32			GetPipelinedReply	( sComData **outMessage, UInt32 inMsgID );
 	SInt32			ClientNegotiateKey	( void );
 	SInt32			ServerNegotiateKey	( void *dataBuff, UInt32 dataBuffLen );
 
@@ -108,6 +116,10 @@ public:
 
 	SInt32		SyncToMessageBody		( const Boolean inStripLeadZeroes, UInt32 *outBuffLen );
 	
+	// never blocks, returns eDSNoErr with a NULL frame until a whole frame has arrived (for use from a read source)
+	SInt32		CopyNextFrame			( void **outFrame, UInt32 *outFrameLen );
+	SInt32		ReadFrame				( void **outFrame, UInt32 *outFrameLen );
+	
 	SInt32		SendBuffer				( void *inBuffer, UInt32 inLength );
 	
 	Boolean		Connected				( void ) const ;
@@ -124,6 +136,16 @@ public:
 
 protected:
 	UInt32			DoTCPRecvFrom			( void *ioBuffer, const UInt32 inBufferSize );
+	UInt32			ReceiveAvailable		( bool inWait );
+	bool			ParseFrameHeader		( UInt32 *outFrameLen );
+	void			WaitForReadable			( void );
+	SInt32			ReadReplyMessage		( sComData **outMessage );
+	SInt32			SendFrame				( char *inFrame, UInt32 inFrameLen );
+	bool			CreateSessionCryptors	( void );
+	CCCryptorStatus	SessionCrypt			( CCCryptorRef inCryptor, const void *inData, size_t inDataLen, void *outData,
+											  size_t inOutDataSize, size_t *outDataLen );
+	SInt32			ReceiveNextReply		( void );
+	void			ClearPipeline			( void );
 
 private:
 		
@@ -145,6 +167,14 @@ protected:
 		
 	// buffers
 	char			   *mErrorBuffer;
+	char			   *mRecvBuffer;		// bytes read from the socket but not consumed yet
+	UInt32				mRecvBufferSize;
+	UInt32				mRecvStart;
+	UInt32				mRecvEnd;
+	
+	// pipelining
+	std::deque<UInt32>				mInFlight;	// message IDs in the order they were sent, until their reply is collected
+	std::map<UInt32, sComData *>	mReplies;	// replies read but not collected yet, all for IDs in mInFlight
 
 	// states
 	Boolean				mWeHaveClosed;
@@ -165,6 +195,10 @@ private:
 	CSSM_KEY			fDerivedKey;
 	uint32_t			fChallengeValue;
 	
+	// created once the key is valid and reused for every message of the session
+	CCCryptorRef		fEncryptor;
+	CCCryptorRef		fDecryptor;
+	
 	static int32_t		mMessageID;		// this is used to track per-message ID globally for all remote messages
 };
 
@@ -26,6 +26,7 @@
 
 #include "CInternalDispatch.h"
 #include "CLog.h"
+#include "DSUtils.h"
 
 pthread_key_t	CInternalDispatch::fThreadKey	= NULL;
 
@@ -73,7 +74,8 @@ sComData* CInternalDispatch::GetCurrentMessageBuffer( void )
 void CInternalDispatch::PopCurrentMessageBuffer( void )
 {
 	if ( fInternalDispatchStackHeight > -1 && fInternalDispatchStackHeight < kMaxInternalDispatchRecursion ) {
-		DSFree( fInternalMsgDataList[fInternalDispatchStackHeight] );
+		dsFreeComDataPriv( fInternalMsgDataList[fInternalDispatchStackHeight] );
+		fInternalMsgDataList[fInternalDispatchStackHeight] = NULL;
 	}
 	
 	if ( fInternalDispatchStackHeight > -1 ) {
@@ -85,12 +87,7 @@ void CInternalDispatch::PushCurrentMessageBuffer( void )
 {
 	if ( fInternalDispatchStackHeight < kMaxInternalDispatchRecursion ) {
 		fInternalDispatchStackHeight++;
-		fInternalMsgDataList[fInternalDispatchStackHeight] = (sComData *) calloc( 1, sizeof(sComData) + kMsgBlockSize );
-		
-		if ( fInternalMsgDataList[fInternalDispatchStackHeight] != NULL ) {
-			fInternalMsgDataList[fInternalDispatchStackHeight]->fDataSize	= kMsgBlockSize;
-			fInternalMsgDataList[fInternalDispatchStackHeight]->fDataLength	= 0;
-		}
+		fInternalMsgDataList[fInternalDispatchStackHeight] = dsAllocComDataPriv( kMsgBlockSize );
 	}
 	else
 	{
@@ -72,7 +72,6 @@ extern	dsBool			gDSInstallDaemonMode;
 
 CNodeList::CNodeList ( void ) : fMutex("CNodeList::fMutex")
 {
-	fTreePtr					= nil;
 	fCount						= 0;
 	fNodeChangeToken			= 1001;	//some arbitrary start value
 	fLocalNode					= nil;
@@ -81,8 +80,6 @@ CNodeList::CNodeList ( void ) : fMutex("CNodeList::fMutex")
 	fContactsSearchNode			= nil;
 	fNetworkSearchNode			= nil;
 	fConfigureNode				= nil;
-	fLocalHostedNodes			= nil;
-	fDefaultNetworkNodes		= nil;
 	fBSDNode					= nil;
 } // CNodeList
 
@@ -93,8 +90,7 @@ CNodeList::CNodeList ( void ) : fMutex("CNodeList::fMutex")
 
 CNodeList::~CNodeList ( void )
 {
-	this->DeleteTree( &fTreePtr );
-	fTreePtr = nil;
+	this->DeleteTree( fNodeTree );
 
 	if ( fLocalNode != nil )
 	{
@@ -156,17 +152,8 @@ CNodeList::~CNodeList ( void )
 		fConfigureNode = nil;
 	}
 	
-	if ( fLocalHostedNodes != nil )
-	{
-		this->DeleteTree( &fLocalHostedNodes );
-		fLocalHostedNodes = nil;
-	}
-
-	if ( fDefaultNetworkNodes != nil )
-	{
-		this->DeleteTree( &fDefaultNetworkNodes );
-		fDefaultNetworkNodes = nil;
-	}
+	this->DeleteTree( fLocalHostedNodes );
+	this->DeleteTree( fDefaultNetworkNodes );
 	
 } // ~CNodeList
 
@@ -175,26 +162,32 @@ CNodeList::~CNodeList ( void )
 //	* DeleteTree ()
 // ---------------------------------------------------------------------------
 
-SInt32 CNodeList::DeleteTree ( sTreeNode **inTree )
+SInt32 CNodeList::DeleteTree ( tNodeTree &inTree )
 {
+	sTreeNode	   *aTree	= nil;
+
 	fMutex.WaitLock();
 
 	try
 	{
-		if ( *inTree != nil )
+		for ( tNodeTreeI iter = inTree.begin(); iter != inTree.end(); ++iter )
 		{
-			this->DeleteTree( &((*inTree)->left) );
-			this->DeleteTree( &((*inTree)->right) );
-			if ( (*inTree)->fDataListPtr != nil )
+			aTree = iter->second;
+			if ( aTree->fDataListPtr != nil )
 			{
-				::dsDataListDeallocatePriv( (*inTree)->fDataListPtr );
+				::dsDataListDeallocatePriv( aTree->fDataListPtr );
 				//need to free the header as well
-				free( (*inTree)->fDataListPtr );
-				(*inTree)->fDataListPtr = nil;
+				free( aTree->fDataListPtr );
+				aTree->fDataListPtr = nil;
+			}
+			if ( aTree->fNodeName != nil )
+			{
+				free( aTree->fNodeName );
+				aTree->fNodeName = nil;
 			}
-			delete( *inTree );
+			free( aTree );
 		}
-		*inTree = nil;
+		inTree.clear();
 	}
 
 	catch( SInt32 err )
@@ -228,10 +221,10 @@ SInt32 CNodeList::AddNode ( const char		*inNodeName,
 		switch(inType)
 		{
 			case kLocalHostedType:
-				siResult = AddNodeToTree( &fLocalHostedNodes, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
+				siResult = AddNodeToTree( fLocalHostedNodes, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
 				break;
 			case kDefaultNetworkNodeType:
-				siResult = AddNodeToTree( &fDefaultNetworkNodes, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
+				siResult = AddNodeToTree( fDefaultNetworkNodes, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
 				break;
 			case kSearchNodeType:
 				if (fAuthenticationSearchNode == nil)
@@ -305,7 +298,7 @@ SInt32 CNodeList::AddNode ( const char		*inNodeName,
 				}
 				break;
 			case kDirNodeType:
-				siResult = AddNodeToTree( &fTreePtr, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
+				siResult = AddNodeToTree( fNodeTree, inNodeName, inListPtr, inType, inPlugInPtr, inToken );
 				
 				// not really tDirStatus, anything other than 0 is success
 				if ( siResult != 0 )
@@ -398,8 +391,6 @@ SInt32 CNodeList::AddLocalNode (	const char		*inNodeName,
 		aLocalNode->fPlugInPtr		= inPlugInPtr;
 		aLocalNode->fPlugInToken	= inToken;
 		aLocalNode->fType			= inType;
-		aLocalNode->left			= nil;
-		aLocalNode->right			= nil;
 		fLocalNode					= aLocalNode;
 		fWaitForLN.PostEvent();
 		DbgLog( kLogApplication, "Added local node to node list." );
@@ -479,8 +470,6 @@ SInt32 CNodeList::AddCacheNode (	const char		*inNodeName,
 		aCacheNode->fPlugInPtr		= inPlugInPtr;
 		aCacheNode->fPlugInToken	= inToken;
 		aCacheNode->fType			= inType;
-		aCacheNode->left			= nil;
-		aCacheNode->right			= nil;
 		fCacheNode					= aCacheNode;
 		fWaitForCacheN.PostEvent();
 	}
@@ -555,8 +544,6 @@ SInt32 CNodeList:: AddAuthenticationSearchNode (	const char		*inNodeName,
 		anAuthenticationSearchNode->fPlugInPtr		= inPlugInPtr;
 		anAuthenticationSearchNode->fPlugInToken	= inToken;
 		anAuthenticationSearchNode->fType			= inType;
-		anAuthenticationSearchNode->left			= nil;
-		anAuthenticationSearchNode->right			= nil;
 		fAuthenticationSearchNode					= anAuthenticationSearchNode;
 		fWaitForAuthenticationSN.PostEvent();
 		DbgLog( kLogApplication, "Added authentication search node to node list." );
@@ -632,8 +619,6 @@ SInt32 CNodeList:: AddContactsSearchNode (	const char		*inNodeName,
 		aContactsSearchNode->fPlugInPtr		= inPlugInPtr;
 		aContactsSearchNode->fPlugInToken	= inToken;
 		aContactsSearchNode->fType			= inType;
-		aContactsSearchNode->left			= nil;
-		aContactsSearchNode->right			= nil;
 		fContactsSearchNode					= aContactsSearchNode;
 		fWaitForContactsSN.PostEvent();
 	}
@@ -708,8 +693,6 @@ SInt32 CNodeList:: AddNetworkSearchNode (	const char		*inNodeName,
 		aNetworkSearchNode->fPlugInPtr		= inPlugInPtr;
 		aNetworkSearchNode->fPlugInToken	= inToken;
 		aNetworkSearchNode->fType			= inType;
-		aNetworkSearchNode->left			= nil;
-		aNetworkSearchNode->right			= nil;
 		fNetworkSearchNode					= aNetworkSearchNode;
 		fWaitForNetworkSN.PostEvent();
 	}
@@ -784,8 +767,6 @@ SInt32 CNodeList:: AddConfigureNode (	const char		*inNodeName,
 		aConfigureNode->fPlugInPtr		= inPlugInPtr;
 		aConfigureNode->fPlugInToken	= inToken;
 		aConfigureNode->fType			= inType;
-		aConfigureNode->left			= nil;
-		aConfigureNode->right			= nil;
 		fConfigureNode					= aConfigureNode;
 		fWaitForConfigureN.PostEvent();
 	}
@@ -859,8 +840,6 @@ SInt32 CNodeList:: AddBSDNode (	const char		*inNodeName,
 		aBSDNode->fPlugInPtr	= inPlugInPtr;
 		aBSDNode->fPlugInToken	= inToken;
 		aBSDNode->fType			= inType;
-		aBSDNode->left			= nil;
-		aBSDNode->right			= nil;
 		fBSDNode				= aBSDNode;
 		fWaitForBSDN.PostEvent();
 	}
@@ -898,7 +877,7 @@ SInt32 CNodeList:: AddBSDNode (	const char		*inNodeName,
 //	* AddNodeToTree ()
 // ---------------------------------------------------------------------------
 
-SInt32 CNodeList:: AddNodeToTree (	sTreeNode	  **inTree,
+SInt32 CNodeList:: AddNodeToTree (	tNodeTree	   &inTree,
 									const char	   *inNodeName,
 									tDataList	   *inListPtr,
 									eDirNodeType	inType,
@@ -906,44 +885,26 @@ SInt32 CNodeList:: AddNodeToTree (	sTreeNode	  **inTree,
 									UInt32			 inToken )
 {
 	SInt32			siResult	= 1;
-	sTreeNode	   *current		= nil;
-	sTreeNode	   *parent		= nil;
 	sTreeNode	   *pNewNode	= nil;
-	bool			bAddNode	= true;
 
 	fMutex.WaitLock();
 
 	try
 	{
-		// Go down tree to find parent node of new insertion node
-		current = *inTree;
-		while ( current != nil )
+		if ( inNodeName == nil ) throw((SInt32)eDSNullParameter);
+
+		if ( inTree.find(inNodeName) != inTree.end() ) //we found a duplicate
 		{
-			parent = current;
-			siResult = CompareCString( inNodeName, current->fNodeName );
-			if ( siResult < 0 )
+			if (inListPtr != nil)
 			{
-				current = current->left;
-			}
-			else if ( siResult > 0 )
-			{
-				current = current->right;
-			}
-			else //we found a duplicate
-			{
-				current = nil;
-				if (inListPtr != nil)
-				{
-					::dsDataListDeallocatePriv( inListPtr );
-					//need to free the header as well
-					free ( inListPtr );
-					inListPtr = nil;
-				}
-				bAddNode = false;
+				::dsDataListDeallocatePriv( inListPtr );
+				//need to free the header as well
+				free ( inListPtr );
+				inListPtr = nil;
 			}
+			siResult = 0;
 		}
-
-		if (bAddNode)
+		else
 		{
 			pNewNode = (sTreeNode *)::calloc( 1, sizeof( sTreeNode ) );
 			if ( pNewNode == nil ) throw((SInt32)eMemoryAllocError);
@@ -956,30 +917,9 @@ SInt32 CNodeList:: AddNodeToTree (	sTreeNode	  **inTree,
 			pNewNode->fPlugInPtr	= inPlugInPtr;
 			pNewNode->fPlugInToken	= inToken;
 			pNewNode->fType			= inType;
-			pNewNode->left			= nil;
-			pNewNode->right			= nil;
 	
-			// If this is the first insertion then you are defining the root
-			if ( parent == nil )
-			{
-				*inTree = pNewNode;
-	
-				siResult = 1;
-			}
-			else
-			{
-				// Otherwise we are assigning a newnode to the left or right of the parent leaf node
-				siResult = CompareCString( inNodeName, parent->fNodeName );
-				if ( siResult < 0 )
-				{
-					parent->left = pNewNode;
-				}
-				else if ( siResult > 0 )
-				{
-					parent->right = pNewNode;
-				}
-			}
-		} //if (bAddNode)
+			inTree[ pNewNode->fNodeName ] = pNewNode;
+		}
 	}
 
 	catch( SInt32 err )
@@ -1251,7 +1191,7 @@ void CNodeList::RegisterAll ( void )
 
 	try
 	{
-		this->Register( fTreePtr );
+		this->Register( fNodeTree );
 		if (fAuthenticationSearchNode != NULL) {
 			od_passthru_register_node(fAuthenticationSearchNode->fNodeName, false);
 		}
@@ -1288,16 +1228,13 @@ void CNodeList::RegisterAll ( void )
 //	* Register ()
 // ---------------------------------------------------------------------------
 
-void CNodeList::Register ( sTreeNode *inTree )
+void CNodeList::Register ( tNodeTree &inTree )
 {
-	if ( inTree != nil )
+	for ( tNodeTreeI iter = inTree.begin(); iter != inTree.end(); ++iter )
 	{
-		if (inTree->fType == kDirNodeType) {
-			od_passthru_register_node(inTree->fNodeName, false);
+		if (iter->second->fType == kDirNodeType) {
+			od_passthru_register_node(iter->second->fNodeName, false);
 		}
-		
-		Register( inTree->left );
-		Register( inTree->right );
 	}
 } // Register
 
@@ -1332,7 +1269,7 @@ void CNodeList::CountNodes ( UInt32 *outCount )
 
 	try
 	{
-		this->Count( fTreePtr, outCount );
+		*outCount += fNodeTree.size();
 	}
 
 	catch( SInt32 err )
@@ -1344,23 +1281,6 @@ void CNodeList::CountNodes ( UInt32 *outCount )
 } // CountNodes
 
 
-// ---------------------------------------------------------------------------
-//	* Count ()
-// ---------------------------------------------------------------------------
-
-
-void CNodeList::Count ( sTreeNode *inTree, UInt32 *outCount )
-{
-	if ( inTree != nil )
-	{
-		Count( inTree->left, outCount );
-		*outCount += 1;
-		Count( inTree->right, outCount );
-	}
-
-} // Count
-
-
 // ---------------------------------------------------------------------------
 //	* GetNodes ()
 // ---------------------------------------------------------------------------
@@ -1516,7 +1436,7 @@ SInt32 CNodeList::GetNodes ( char			   *inStr,
 		}
 		else
 		{
-			siResult = this->DoGetNode( fTreePtr, inStr, inMatch, inBuff, &outNodePtr );
+			siResult = this->DoGetNode( fNodeTree, inStr, inMatch, inBuff, &outNodePtr );
 		}
 	}
 
@@ -1535,7 +1455,7 @@ SInt32 CNodeList::GetNodes ( char			   *inStr,
 //	* DoGetNode ()
 // ---------------------------------------------------------------------------
 
-SInt32 CNodeList::DoGetNode ( sTreeNode		   *inLeaf,
+SInt32 CNodeList::DoGetNode ( tNodeTree		   &inTree,
 							 char			   *inStr,
 							 tDirPatternMatch	inMatch,
 							 tDataBuffer	   *inBuff,
@@ -1544,13 +1464,30 @@ SInt32 CNodeList::DoGetNode ( sTreeNode		   *inLeaf,
 	char	   *aString1	= nil;
 	char	   *aString2	= nil;
 	bool		bAddToBuff	= false;
+	bool		bEndOfRange	= false;
 	SInt32		uiStrLen	= 0;
 	SInt32		uiInStrLen	= 0;
 	SInt32		siResult	= eDSNoErr;
+	sTreeNode  *inLeaf		= nil;
+	tNodeTreeI	iter		= inTree.begin();
+
+	// the tree is sorted, so exact and prefix matches only need to visit the matching range
+	if ( inStr != nil )
+	{
+		if ( inMatch == eDSExact )
+		{
+			iter = inTree.find( inStr );
+		}
+		else if ( inMatch == eDSStartsWith )
+		{
+			iter = inTree.lower_bound( inStr );
+		}
+	}
 
-	if ( inLeaf != nil )
+	for ( ; iter != inTree.end() && bEndOfRange == false && siResult == eDSNoErr; ++iter )
 	{
-		siResult = DoGetNode( inLeaf->left, inStr, inMatch, inBuff, outNodePtr );
+		inLeaf = iter->second;
+		bAddToBuff = false;
 
 		switch( inMatch )
 		{
@@ -1612,10 +1549,8 @@ SInt32 CNodeList::DoGetNode ( sTreeNode		   *inLeaf,
 
 			//KW is the following pattern matching UTF-8 capable?
 			case eDSExact:
-				if ( ::strcmp( inLeaf->fNodeName, inStr ) == 0 )
-				{
-					bAddToBuff = true;
-				}
+				bAddToBuff = ( inStr != nil );
+				bEndOfRange = true;
 				break;
 
 			case eDSStartsWith:
@@ -1624,6 +1559,10 @@ SInt32 CNodeList::DoGetNode ( sTreeNode		   *inLeaf,
 				{
 					bAddToBuff = true;
 				}
+				else
+				{
+					bEndOfRange = true;
+				}
 				break;
 
 			case eDSEndsWith:
@@ -1764,11 +1703,6 @@ SInt32 CNodeList::DoGetNode ( sTreeNode		   *inLeaf,
 			siResult = AddNodePathToTDataBuff( inLeaf->fDataListPtr, inBuff );
 			*outNodePtr = inLeaf;
 		}
-
-		if ( siResult == eDSNoErr )
-		{
-			siResult = DoGetNode( inLeaf->right, inStr, inMatch, inBuff, outNodePtr );
-		}
 	}
 
 	return( siResult );
@@ -1793,7 +1727,7 @@ bool CNodeList::DeleteNode ( char *inStr )
 	
 	found = DeleteNodeFromTree( inStr, fDefaultNetworkNodes ) || found;
 	
-	if (DeleteNodeFromTree( inStr, fTreePtr ))
+	if (DeleteNodeFromTree( inStr, fNodeTree ))
 	{
 		found = true;
 		fCount--;
@@ -1841,118 +1775,28 @@ bool CNodeList::DeleteNode ( char *inStr )
 //	* DeleteNodeFromTree ()
 // ---------------------------------------------------------------------------
 
-bool CNodeList::DeleteNodeFromTree ( char *inStr, sTreeNode  *inTree )
+bool CNodeList::DeleteNodeFromTree ( char *inStr, tNodeTree &inTree )
 {
 	bool			found  			= false;
-	SInt32			siResult		= 0;
-	sTreeNode	   *aTree			= inTree;
-	sTreeNode	   *aTreeParent		= nil;
-	sTreeNode	   *remTree			= nil;
-	sTreeNode	   *remTreeParent	= nil;
-	sTreeNode	   *remTreeChild	= nil;
-	eDirNodeType	aDirNodeType	= kUnknownNodeType;
+	sTreeNode	   *aTree			= nil;
+	tNodeTreeI		iter;
 
-	fMutex.WaitLock();
-
-	// looking only for the three node types that use trees
-	if (aTree == fLocalHostedNodes)
-	{
-		aDirNodeType = kLocalHostedType;
-	}
-	else if (aTree == fDefaultNetworkNodes)
-	{
-		aDirNodeType = kDefaultNetworkNodeType;
-	}
-	else if (aTree == fTreePtr)
-	{
-		aDirNodeType = kDirNodeType;
-	}
-	else
+	if ( inStr == nil )
 	{
-		aTree = nil;
+		return( false );
 	}
 
-	//find the matching node
-	while ( (!found) && (aTree != nil) )
-	{
-		siResult = CompareCString( inStr, aTree->fNodeName );
-		if ( siResult == 0 )
-		{
-			found = true;
-		}
-		else
-		{
-			aTreeParent = aTree;
-			if ( siResult < 0 )
-			{
-				aTree = aTree->left;
-			}
-			else
-			{
-				aTree = aTree->right;
-			}
-		}
-	}
+	fMutex.WaitLock();
 
-	//remove the matching node from the tree
-	if ( found == true )
+	//find the matching node
+	iter = inTree.find( inStr );
+	if ( iter != inTree.end() )
 	{
-		if ( aTree->left == nil )
-		{
-			remTree = aTree->right;
-		}
-		else
-		{
-			if ( aTree->right == nil )
-			{
-				remTree = aTree->left;
-			}
-			else
-			{
-				remTreeParent = aTree;
-				remTree = aTree->right;
-				remTreeChild = remTree->left;
-				while ( remTreeChild != nil )
-				{
-					remTreeParent = remTree;
-					remTree = remTreeChild;
-					remTreeChild = remTree->left;
-				}
-				if ( remTreeParent != aTree )
-				{
-					remTreeParent->left = remTree->right;
-					remTree->right = aTree->right;
-				}
-				remTree->left = aTree->left;
-			}
-		}
+		found = true;
+		aTree = iter->second;
 
-		if ( aTreeParent == nil )
-		{
-			if (aDirNodeType == kLocalHostedType)
-			{
-				fLocalHostedNodes = remTree;
-			}
-			else if (aDirNodeType == kDefaultNetworkNodeType)
-			{
-				fDefaultNetworkNodes = remTree;
-			}
-			else if (aDirNodeType == kDirNodeType)
-			{
-				fTreePtr = remTree;
-			}
-		}
-		else
-		{
-			if ( aTree == aTreeParent->left )
-			{
-				aTreeParent->left = remTree;
-			}
-			else
-			{
-				aTreeParent->right = remTree;
-			}
-		}
+		//remove the matching node from the tree
+		inTree.erase( iter );
 		
 		if ( aTree->fNodeName != nil )
 		{
@@ -1970,7 +1814,7 @@ bool CNodeList::DeleteNodeFromTree ( char *inStr, sTreeNode  *inTree )
 			aTree->fDataListPtr = nil;
 		}
 
-		delete( aTree );
+		free( aTree );
 	}
 	
 	fMutex.SignalLock();
@@ -1987,8 +1831,12 @@ bool CNodeList::DeleteNodeFromTree ( char *inStr, sTreeNode  *inTree )
 bool CNodeList::IsPresent ( const char *inStr, eDirNodeType inType )
 {
 	bool		found		= false;
-	SInt32		siResult	= 0;
-	sTreeNode  *current		= nil;
+	tNodeTree  *current		= nil;
+
+	if ( inStr == nil )
+	{
+		return( false );
+	}
 
 	fMutex.WaitLock();
 
@@ -2002,36 +1850,18 @@ bool CNodeList::IsPresent ( const char *inStr, eDirNodeType inType )
 	}
 	else if (inType == kLocalHostedType)
 	{
-		current = fLocalHostedNodes;
+		current = &fLocalHostedNodes;
 	}
 	else if (inType == kDefaultNetworkNodeType)
 	{
-		current = fDefaultNetworkNodes;
+		current = &fDefaultNetworkNodes;
 	}
 	else //this will be the simple node type
 	{
-		current = fTreePtr;
+		current = &fNodeTree;
 	}
 	
-	while ( (!found) && (current != nil) )
-	{
-		siResult = CompareCString( inStr, current->fNodeName );
-		if ( siResult == 0 )
-		{
-			found = true;
-		}
-		else
-		{
-			if ( siResult < 0 )
-			{
-				current = current->left;
-			}
-			else
-			{
-				current = current->right;
-			}
-		}
-	}
+	found = ( current->find(inStr) != current->end() );
 
 	fMutex.SignalLock();
 
@@ -2047,8 +1877,7 @@ bool CNodeList::IsPresent ( const char *inStr, eDirNodeType inType )
 bool CNodeList::GetPluginHandle ( const char *inStr, CServerPlugin **outPlugInPtr )
 {
 	bool		found		= false;
-	SInt32		siResult	= 0;
-	sTreeNode  *current		= nil;
+	tNodeTreeI	iter;
 
 	fMutex.WaitLock();
 
@@ -2141,28 +1970,13 @@ bool CNodeList::GetPluginHandle ( const char *inStr, CServerPlugin **outPlugInPt
 
 	//assumption here is that both the DefaultNetworkNodes and the LocalHostedNodes are also in the main node tree
 	//KW why do we keep duplicates across different node types?
-	current = fTreePtr;
-	while ( (!found) && (current != nil) )
+	iter = fNodeTree.find( inStr );
+	if ( iter != fNodeTree.end() )
 	{
-		siResult = CompareCString( inStr, current->fNodeName );
-		if ( siResult == 0 )
-		{
-			found = true;
-			if ( outPlugInPtr != nil )
-			{
-				*outPlugInPtr = GetPluginPtr(current);
-			}
-		}
-		else
+		found = true;
+		if ( outPlugInPtr != nil )
 		{
-			if ( siResult < 0 )
-			{
-				current = current->left;
-			}
-			else
-			{
-				current = current->right;
-			}
+			*outPlugInPtr = GetPluginPtr(iter->second);
 		}
 	}
 
@@ -2228,7 +2042,7 @@ SInt32 CNodeList::BuildNodeListBuff ( sGetDirNodeList *inData )
 
 	inData->fIOContinueData = nil;
 
-	siResult = this->DoBuildNodeListBuff( fTreePtr, inData->fOutDataBuff, &outCount );
+	siResult = this->DoBuildNodeListBuff( fNodeTree, inData->fOutDataBuff, &outCount );
 	inData->fOutNodeCount = outCount;
 
 	fMutex.SignalLock();
@@ -2242,30 +2056,23 @@ SInt32 CNodeList::BuildNodeListBuff ( sGetDirNodeList *inData )
 //	* DoBuildNodeListBuff ()
 // ---------------------------------------------------------------------------
 
-SInt32 CNodeList::DoBuildNodeListBuff ( sTreeNode *inTree, tDataBuffer *inBuff, UInt32 *outCount )
+SInt32 CNodeList::DoBuildNodeListBuff ( tNodeTree &inTree, tDataBuffer *inBuff, UInt32 *outCount )
 {
 	SInt32			siResult	= eDSNoErr;
 	tDataList	   *pNodeList	= nil;
 
-	if ( inTree != nil )
+	for ( tNodeTreeI iter = inTree.begin(); iter != inTree.end(); ++iter )
 	{
-		siResult = DoBuildNodeListBuff( inTree->left, inBuff, outCount );
-		if ( siResult == eDSNoErr )
+		pNodeList = iter->second->fDataListPtr;
+		if ( pNodeList != nil )
 		{
-			pNodeList = inTree->fDataListPtr;
-			if ( pNodeList != nil )
+			siResult = AddNodePathToTDataBuff( pNodeList, inBuff );
+			if ( siResult != eDSNoErr )
 			{
-				siResult = AddNodePathToTDataBuff( pNodeList, inBuff );
-				if ( siResult == eDSNoErr )
-				{
-					*outCount	+= 1;
-					siResult	= DoBuildNodeListBuff( inTree->right, inBuff, outCount );
-				}
-				else
-				{
-					*outCount = 0;
-				}
+				*outCount = 0;
+				break;
 			}
+			*outCount += 1;
 		}
 	}
 
@@ -85,10 +85,12 @@ typedef struct sTreeNode
 	CServerPlugin	*fPlugInPtr;
 	UInt32			fPlugInToken;
 	eDirNodeType	fType;
-   	sTreeNode		*left;
-   	sTreeNode		*right;
 } sTreeNode;
 
+// node trees are kept sorted by name, so lookups stay logarithmic and prefix matches are a range
+typedef map<string, sTreeNode*>		tNodeTree;
+typedef tNodeTree::iterator			tNodeTreeI;
+
 enum {
 	kBuffFull		= -128,
 	kBuffTooSmall	= -129,
@@ -126,23 +128,22 @@ public:
 
 protected:
 	// Protected member functions
-	SInt32		DeleteTree				( sTreeNode **inTree );	// called by the destructor
-	bool		DeleteNodeFromTree		( char *inStr, sTreeNode  *inTree );
+	SInt32		DeleteTree				( tNodeTree &inTree );	// called by the destructor
+	bool		DeleteNodeFromTree		( char *inStr, tNodeTree &inTree );
 
 	SInt32		AddNodePathToTDataBuff	( tDataList *inPtr, tDataBuffer *inBuff );
 
 private:
 	// Private member functions
-	void		Count					( sTreeNode *inTree, UInt32 *outCount );
-	SInt32		DoGetNode				( sTreeNode *inTree, char *inStr, tDirPatternMatch inMatch, tDataBuffer *inBuff, sTreeNode **outNodePtr );
-	void		Register				( sTreeNode *inTree );
+	SInt32		DoGetNode				( tNodeTree &inTree, char *inStr, tDirPatternMatch inMatch, tDataBuffer *inBuff, sTreeNode **outNodePtr );
+	void		Register				( tNodeTree &inTree );
 	SInt32		CompareCString			( const char *inStr_1, const char *inStr_2 );
 
-	SInt32		DoBuildNodeListBuff		( sTreeNode *inTree, tDataBuffer *outData, UInt32 *outCount );
+	SInt32		DoBuildNodeListBuff		( tNodeTree &inTree, tDataBuffer *outData, UInt32 *outCount );
 
 	SInt32	   	AddLocalNode					( const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
 	SInt32	   	AddCacheNode					( const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
-	SInt32	   	AddNodeToTree					( sTreeNode **inTree, const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
+	SInt32	   	AddNodeToTree					( tNodeTree &inTree, const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
 	SInt32	   	AddAuthenticationSearchNode		( const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
 	SInt32	   	AddContactsSearchNode			( const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
 	SInt32	   	AddNetworkSearchNode			( const char *inStr, tDataList *inListPtr, eDirNodeType inType, CServerPlugin *inPlugInPtr, UInt32 inToken );
@@ -168,15 +169,15 @@ private:
 	void		WaitForNetworkSearchNode		( void );
 
 	// Private data members
-	sTreeNode		   *fTreePtr;
+	tNodeTree			fNodeTree;
 	sTreeNode		   *fLocalNode;
 	sTreeNode		   *fCacheNode;
 	sTreeNode		   *fConfigureNode;
 	sTreeNode		   *fAuthenticationSearchNode;
 	sTreeNode		   *fContactsSearchNode;
 	sTreeNode		   *fNetworkSearchNode;
-	sTreeNode		   *fLocalHostedNodes;
-	sTreeNode		   *fDefaultNetworkNodes;
+	tNodeTree			fLocalHostedNodes;
+	tNodeTree			fDefaultNetworkNodes;
 	sTreeNode		   *fBSDNode;
 	UInt32				fCount;
 	UInt32				fNodeChangeToken;
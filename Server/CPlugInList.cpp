@@ -40,6 +40,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <time.h>
 
 extern CFRunLoopRef			gPluginRunLoop;
 extern DSMutexSemaphore    *gKerberosMutex;
@@ -67,7 +68,12 @@ CPlugInList::CPlugInList ( void ) : fMutex("CPlugInList::fMutex")
 	fPICount	= 0;
 	fTable		= nil;
 	fTableTail  = nil;
+	bzero( fIndex, sizeof(fIndex) );
+	bzero( fNameIndex, sizeof(fNameIndex) );
+	bzero( fKeyIndex, sizeof(fKeyIndex) );
 	fCFRecordTypeRestrictions = NULL;
+	fRecTypeRestrictions = NULL;
+	fRetiredRecTypeRestrictions = NULL;
 
 } // CPlugInList
 
@@ -82,6 +88,67 @@ CPlugInList::~CPlugInList ( void )
 } // ~CPlugInList
 
 
+// ---------------------------------------------------------------------------
+//	* HashPlugInName ()
+//
+// ---------------------------------------------------------------------------
+
+static UInt32 HashPlugInName( const char *inName )
+{
+	UInt32 hash = 2166136261u;
+	
+	while ( *inName != '\0' )
+	{
+		hash = (hash ^ (UInt8) *inName++) * 16777619u;
+	}
+	
+	return( hash );
+	
+} // HashPlugInName
+
+
+// ---------------------------------------------------------------------------
+//	* FindEntry ()
+//
+//		Lock-free lookups, only AddPlugIn modifies the indexes.
+// ---------------------------------------------------------------------------
+
+CPlugInList::sTableData* CPlugInList::FindEntry ( const char *inName )
+{
+	UInt32		hash	= HashPlugInName( inName );
+	sTableData *entry	= nil;
+	
+	for ( UInt32 ii = 0; ii < kPlugInHashSize; ii++ )
+	{
+		entry = fNameIndex[(hash + ii) & (kPlugInHashSize - 1)];
+		if ( entry == nil )
+			break;
+		
+		// the name is nearly always the plugin's own string, so the compare is only done on a hash match
+		if ( entry->fNameHash == hash && (entry->fName == inName || ::strcmp(entry->fName, inName) == 0) )
+			return( entry );
+	}
+	
+	return( nil );
+	
+} // FindEntry
+
+CPlugInList::sTableData* CPlugInList::FindEntry ( const UInt32 inKey )
+{
+	sTableData *entry	= nil;
+	
+	for ( UInt32 ii = 0; ii < kPlugInHashSize; ii++ )
+	{
+		entry = fKeyIndex[(inKey + ii) & (kPlugInHashSize - 1)];
+		if ( entry == nil || entry->fKey == inKey )
+			break;
+	}
+	
+	return( entry );
+	
+} // FindEntry
+
+
 // ---------------------------------------------------------------------------
 //	* AddPlugIn ()
 //
@@ -117,6 +184,12 @@ SInt32 CPlugInList::AddPlugIn ( const char		*inName,
 
 	try
 	{
+		if ( fPICount >= kMaxPlugIns )
+		{
+			ErrLog( kLogApplication, "Plugin \"%s\" not added, the maximum of %d plug-ins has been reached.", inName, kMaxPlugIns );
+			throw( (SInt32)eDSInvalidPlugInConfigData );
+		}
+		
 		aTableEntry = (sTableData *)calloc(1, sizeof(sTableData));
 		if (fTableTail != nil)
 		{
@@ -155,7 +228,24 @@ SInt32 CPlugInList::AddPlugIn ( const char		*inName,
 		fTableTail->fKey = inKey;
 		
 		fTableTail->fState = pluginState | kUninitialized;
+		fTableTail->fNameHash = HashPlugInName( inName );
 
+		// entry must be complete before the lock-free readers can find it
+		__sync_synchronize();
+		
+		UInt32 slot = fTableTail->fNameHash;
+		while ( fNameIndex[slot & (kPlugInHashSize - 1)] != nil )
+			slot++;
+		fNameIndex[slot & (kPlugInHashSize - 1)] = fTableTail;
+		
+		slot = inKey;
+		while ( fKeyIndex[slot & (kPlugInHashSize - 1)] != nil )
+			slot++;
+		fKeyIndex[slot & (kPlugInHashSize - 1)] = fTableTail;
+		
+		fIndex[fPICount] = fTableTail;
+		__sync_synchronize();
+		
 		fPICount++;
 
 		siResult = eDSNoErr;
@@ -347,34 +437,12 @@ void CPlugInList::InitPlugIns ( eDSPluginLevel inLevel )
 
 SInt32 CPlugInList::IsPresent ( const char *inName )
 {
-	SInt32			siResult	= ePluginNameNotFound;
-	sTableData     *aTableEntry = nil;
-
 	if ( inName == nil )
 	{
 		return( eDSNullParameter );
 	}
 	
-	fMutex.WaitLock();
-
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
-	{
-		if ( aTableEntry->fName != nil )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				siResult = eDSNoErr;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
-	}
-
-	fMutex.SignalLock();
-
-	return( siResult );
+	return( FindEntry(inName) != nil ? eDSNoErr : ePluginNameNotFound );
 
 } // IsPresent
 
@@ -399,24 +467,16 @@ SInt32 CPlugInList::SetState ( const char *inName, const UInt32 inState )
 	
 	fMutex.WaitLock();
 
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
+	aTableEntry = FindEntry( inName );
+	if ( aTableEntry != nil )
 	{
-		if ( aTableEntry->fName != nil )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				curState = aTableEntry->fState;
-				
-				// this means we will try to load the plugin below
-				if ( (inState & kActive) && aTableEntry->fPluginPtr == NULL )
-					tmpTableEntry = MakeTableEntryCopy( aTableEntry );
+		curState = aTableEntry->fState;
+		
+		// this means we will try to load the plugin below
+		if ( (inState & kActive) && aTableEntry->fPluginPtr == NULL )
+			tmpTableEntry = MakeTableEntryCopy( aTableEntry );
 
-				pluginEntry = aTableEntry;
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
+		pluginEntry = aTableEntry;
 	}
 
 	fMutex.SignalLock();
@@ -477,7 +537,6 @@ SInt32 CPlugInList::SetState ( const char *inName, const UInt32 inState )
 
 SInt32 CPlugInList::GetState ( const char *inName, UInt32 *outState )
 {
-	SInt32			siResult		= ePluginNameNotFound;
 	sTableData     *aTableEntry		= nil;
 
 	if ( inName == nil )
@@ -485,28 +544,15 @@ SInt32 CPlugInList::GetState ( const char *inName, UInt32 *outState )
 		return( eDSNullParameter );
 	}
 	
-	fMutex.WaitLock();
-
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
+	aTableEntry = FindEntry( inName );
+	if ( aTableEntry == nil )
 	{
-		if ( aTableEntry->fName != nil )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				*outState = aTableEntry->fState;
-
-				siResult = eDSNoErr;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
+		return( ePluginNameNotFound );
 	}
+	
+	*outState = aTableEntry->fState;
 
-	fMutex.SignalLock();
-
-	return( siResult );
+	return( eDSNoErr );
 
 } // GetState
 
@@ -518,7 +564,6 @@ SInt32 CPlugInList::GetState ( const char *inName, UInt32 *outState )
 
 SInt32 CPlugInList::UpdateValidDataStamp ( const char *inName )
 {
-	SInt32			siResult		= ePluginNameNotFound;
 	sTableData     *aTableEntry		= nil;
 
 	if ( inName == nil )
@@ -526,28 +571,15 @@ SInt32 CPlugInList::UpdateValidDataStamp ( const char *inName )
 		return( eDSNullParameter );
 	}
 	
-	fMutex.WaitLock();
-
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
+	aTableEntry = FindEntry( inName );
+	if ( aTableEntry == nil )
 	{
-		if ( aTableEntry->fName != nil )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				aTableEntry->fValidDataStamp++;
-
-				siResult = eDSNoErr;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
+		return( ePluginNameNotFound );
 	}
+	
+	__sync_add_and_fetch( &aTableEntry->fValidDataStamp, 1 );
 
-	fMutex.SignalLock();
-
-	return( siResult );
+	return( eDSNoErr );
 
 } // UpdateValidDataStamp
 
@@ -559,7 +591,6 @@ SInt32 CPlugInList::UpdateValidDataStamp ( const char *inName )
 
 UInt32 CPlugInList::GetValidDataStamp ( const char *inName )
 {
-	UInt32			outStamp		= 0;
 	sTableData     *aTableEntry		= nil;
 
 	if ( inName == nil )
@@ -567,26 +598,9 @@ UInt32 CPlugInList::GetValidDataStamp ( const char *inName )
 		return( eDSNullParameter );
 	}
 	
-	fMutex.WaitLock();
+	aTableEntry = FindEntry( inName );
 
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
-	{
-		if ( aTableEntry->fName != nil )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				outStamp = aTableEntry->fValidDataStamp;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
-	}
-
-	fMutex.SignalLock();
-
-	return( outStamp );
+	return( aTableEntry != nil ? aTableEntry->fValidDataStamp : 0 );
 
 } // GetValidDataStamp
 
@@ -698,30 +712,31 @@ CServerPlugin* CPlugInList::GetPlugInPtr ( const char *inName, bool loadIfNeeded
 		return( nil );
 	}
 	
+	aTableEntry = FindEntry( inName );
+	if ( aTableEntry == nil )
+	{
+		return( nil );
+	}
+	
+	// already loaded plugins never change, so no need for the mutex
+	pResult = aTableEntry->fPluginPtr;
+	if ( pResult != nil || loadIfNeeded == false )
+	{
+		return( pResult );
+	}
+	
 	fMutex.WaitLock();
 
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
+	// if someone specifically asks for a node, even if not active, we should load the plugin
+	// this can be for configure nodes, otherwise inactive nodes cannot be configured
+	if ( aTableEntry->fPluginPtr == NULL )
 	{
-		if ( (aTableEntry->fName != nil) )
-		{
-			if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-			{
-				// if someone specifically asks for a node, even if not active, we should load the plugin
-				// this can be for configure nodes, otherwise inactive nodes cannot be configured
-				if ( (aTableEntry->fPluginPtr == NULL) && loadIfNeeded )
-				{
-					// this means we will try to load the plugin below
-					tmpTableEntry = MakeTableEntryCopy( aTableEntry );
-					break;
-				}	
-
-				pResult = aTableEntry->fPluginPtr;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
+		// this means we will try to load the plugin below
+		tmpTableEntry = MakeTableEntryCopy( aTableEntry );
+	}
+	else
+	{
+		pResult = aTableEntry->fPluginPtr;
 	}
 
 	fMutex.SignalLock();
@@ -736,37 +751,25 @@ CServerPlugin* CPlugInList::GetPlugInPtr ( const char *inName, bool loadIfNeeded
 
 		// we actually loaded the plugin so go ahead and update the table
 		fMutex.WaitLock();
-		aTableEntry = fTable;
-		while ( aTableEntry != nil )
+		if ( loadIfNeeded && aTableEntry->fPluginPtr == NULL )
 		{
-			if ( aTableEntry->fName != nil )
-			{
-				if ( ::strcmp( aTableEntry->fName, inName ) == 0 )
-				{
-					if ( loadIfNeeded && aTableEntry->fPluginPtr == NULL )
-					{
-						// now use the tmpTableEntry
-						aTableEntry->fPluginPtr = tmpTableEntry->fPluginPtr;
-						aTableEntry->fState = tmpTableEntry->fState;
+			// now use the tmpTableEntry
+			aTableEntry->fPluginPtr = tmpTableEntry->fPluginPtr;
+			aTableEntry->fState = tmpTableEntry->fState;
 
-						if ( aTableEntry->fPluginPtr != NULL )
-						{
-							// save in newState so that we can call out to the plugin ouside the lock.
+			if ( aTableEntry->fPluginPtr != NULL )
+			{
+				// save in newState so that we can call out to the plugin ouside the lock.
 #ifndef DISABLE_CONFIGURE_PLUGIN
-							newState = gPluginConfig->GetPluginState( aTableEntry->fPluginPtr->GetPluginName() );
+				newState = gPluginConfig->GetPluginState( aTableEntry->fPluginPtr->GetPluginName() );
 #else
-							newState = kActive;
+				newState = kActive;
 #endif
-							aTableEntry->fState = newState;
-						}
-					}
-						
-					pResult = aTableEntry->fPluginPtr;
-					break;
-				}
+				aTableEntry->fState = newState;
 			}
-			aTableEntry = aTableEntry->pNext;
 		}
+			
+		pResult = aTableEntry->fPluginPtr;
 		
 		fMutex.SignalLock();
 		DSFree(tmpTableEntry);
@@ -796,32 +799,33 @@ CServerPlugin* CPlugInList::GetPlugInPtr ( const UInt32 inKey, bool loadIfNeeded
 	sTableData     *tmpTableEntry	= nil;
 	ePluginState	newState		= kUnknownState;
 
+	aTableEntry = FindEntry( inKey );
+	if ( aTableEntry == nil )
+	{
+		return( nil );
+	}
+	
+	// already loaded plugins never change, so no need for the mutex
+	pResult = aTableEntry->fPluginPtr;
+	if ( pResult != nil || loadIfNeeded == false )
+	{
+		return( pResult );
+	}
+	
 	fMutex.WaitLock();
 
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
-	{
-		if ( (aTableEntry->fName != nil) )
-		{
-			if ( aTableEntry->fKey == inKey )
-			{
-				if (	aTableEntry->fPluginPtr == NULL
+	if (	aTableEntry->fPluginPtr == NULL
 #ifndef DISABLE_CONFIGURE_PLUGIN
-					&&	(gPluginConfig->GetPluginState(aTableEntry->fName) & kActive)
+		&&	(gPluginConfig->GetPluginState(aTableEntry->fName) & kActive)
 #endif
-					&&	loadIfNeeded )
-				{
-					// this means we will try to load the plugin below
-					tmpTableEntry = MakeTableEntryCopy( aTableEntry );
-					break;
-				}	
-
-				pResult = aTableEntry->fPluginPtr;
-
-				break;
-			}
-		}
-		aTableEntry = aTableEntry->pNext;
+	   )
+	{
+		// this means we will try to load the plugin below
+		tmpTableEntry = MakeTableEntryCopy( aTableEntry );
+	}
+	else
+	{
+		pResult = aTableEntry->fPluginPtr;
 	}
 
 	fMutex.SignalLock();
@@ -836,43 +840,30 @@ CServerPlugin* CPlugInList::GetPlugInPtr ( const UInt32 inKey, bool loadIfNeeded
 
 		// we actually loaded the plugin so go ahead and update the table
 		fMutex.WaitLock();
-		aTableEntry = fTable;
-		while ( aTableEntry != nil )
-		{
-			if ( aTableEntry->fName != nil )
-			{
-				if ( aTableEntry->fKey == inKey )
-				{
-					if (	aTableEntry->fPluginPtr == NULL
+		if (	aTableEntry->fPluginPtr == NULL
 #ifndef DISABLE_CONFIGURE_PLUGIN
-						&&	(gPluginConfig->GetPluginState(aTableEntry->fName) & kActive)
+			&&	(gPluginConfig->GetPluginState(aTableEntry->fName) & kActive)
 #endif
-						&&	loadIfNeeded )
-					{
-						// now use the tmpTableEntry
-						aTableEntry->fPluginPtr = tmpTableEntry->fPluginPtr;
-						aTableEntry->fState = tmpTableEntry->fState;
-						
-						
-						if ( aTableEntry->fPluginPtr != NULL )
-						{
-							// save in newState so that we can call out to the plugin ouside the lock.
+			&&	loadIfNeeded )
+		{
+			// now use the tmpTableEntry
+			aTableEntry->fPluginPtr = tmpTableEntry->fPluginPtr;
+			aTableEntry->fState = tmpTableEntry->fState;
+			
+			if ( aTableEntry->fPluginPtr != NULL )
+			{
+				// save in newState so that we can call out to the plugin ouside the lock.
 #ifndef DISABLE_CONFIGURE_PLUGIN
-							newState = gPluginConfig->GetPluginState( aTableEntry->fPluginPtr->GetPluginName() );
+				newState = gPluginConfig->GetPluginState( aTableEntry->fPluginPtr->GetPluginName() );
 #else
-							newState = kActive;
+				newState = kActive;
 #endif
-							aTableEntry->fState = newState;
-						}
-					}
-	
-					pResult = aTableEntry->fPluginPtr;
-	
-					break;
-				}
+				aTableEntry->fState = newState;
 			}
-			aTableEntry = aTableEntry->pNext;
 		}
+
+		pResult = aTableEntry->fPluginPtr;
+
 		fMutex.SignalLock();
 		DSFree(tmpTableEntry);
 
@@ -898,34 +889,20 @@ CServerPlugin* CPlugInList::GetPlugInPtr ( const UInt32 inKey, bool loadIfNeeded
 CServerPlugin* CPlugInList::Next ( UInt32 *inIndex )
 {
 	CServerPlugin	   *pResult			= nil;
-	UInt32				tableIndex		= 0;
-	sTableData		   *aTableEntry		= nil;
-
-	fMutex.WaitLock();
+	UInt32				tableIndex		= *inIndex;
+	UInt32				count			= fPICount;
 
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
+	while ( tableIndex < count )
 	{
-		if (tableIndex == *inIndex)
+		sTableData *aTableEntry = fIndex[tableIndex++];
+		if ( (aTableEntry->fName != nil) && (aTableEntry->fPluginPtr != nil) )
 		{
-			if ( (aTableEntry->fName != nil) && (aTableEntry->fPluginPtr != nil) )
-			{
-				pResult = aTableEntry->fPluginPtr;
-				tableIndex++;
-				break;
-			}
-			else
-			{
-				*inIndex = tableIndex + 1;	// keep looking for next loaded plugin
-			}
+			pResult = aTableEntry->fPluginPtr;
+			break;
 		}
-		tableIndex++;
-		aTableEntry = aTableEntry->pNext;
 	}
 
-	*inIndex = tableIndex;
-
-	fMutex.SignalLock();
+	*inIndex = (tableIndex > count ? count : tableIndex);
 
 	return( pResult );
 
@@ -939,25 +916,7 @@ CServerPlugin* CPlugInList::Next ( UInt32 *inIndex )
 
 CPlugInList::sTableData* CPlugInList::GetPlugInInfo ( UInt32 inIndex )
 {
-	UInt32				tableIndex		= 0;
-	sTableData		   *aTableEntry		= nil;
-
-	fMutex.WaitLock();
-
-	aTableEntry = fTable;
-	while ( aTableEntry != nil )
-	{
-		if (tableIndex == inIndex)
-		{
-			break;
-		}
-		tableIndex++;
-		aTableEntry = aTableEntry->pNext;
-	}
-
-	fMutex.SignalLock();
-
-	return( aTableEntry );
+	return( inIndex < fPICount ? fIndex[inIndex] : nil );
 
 } // GetPlugInInfo
 
@@ -1001,6 +960,7 @@ void CPlugInList::SetRecordTypeRestrictionsDictionary( CFMutableDictionaryRef in
 		
 		CFRetain( inDictionary );
 		fCFRecordTypeRestrictions = inDictionary;
+		CompileRecordTypeRestrictions();
 		
 		sPath = CFStringCreateWithCString( kCFAllocatorDefault, kRecTypeRestrictionsFilePath, kCFStringEncodingUTF8 );
 		if (sPath != NULL)
@@ -1198,6 +1158,8 @@ SInt32 CPlugInList::ReadRecordTypeRestrictions( void )
     
 	DSCFRelease(configFileCorruptedURL); // seems okay to dealloc since Create used and done with it now
 	
+	CompileRecordTypeRestrictions();
+	
 	fMutex.SignalLock();
 
     return( siResult );
@@ -1230,109 +1192,284 @@ bool CPlugInList::CreatePrefDirectory( void )
 } //CreatePrefDirectory
 
     
+// ---------------------------------------------------------------------------
+//	* Record type restriction helpers
+// ---------------------------------------------------------------------------
+
+static char *CopyCStringFromCFString( CFStringRef inString )
+{
+	if ( inString == NULL || CFGetTypeID(inString) != CFStringGetTypeID() )
+		return NULL;
+	
+	CFIndex	length	= CFStringGetMaximumSizeForEncoding( CFStringGetLength(inString), kCFStringEncodingUTF8 ) + 1;
+	char	*cStr	= (char *) calloc( length, sizeof(char) );
+	
+	if ( cStr != NULL && CFStringGetCString(inString, cStr, length, kCFStringEncodingUTF8) == false )
+		DSFree( cStr );
+	
+	return cStr;
+}
+
+static void CollectRecordTypes( CFDictionaryRef inRestrictions, CFStringRef inKey, CFMutableArrayRef ioTypes )
+{
+	CFArrayRef cfTypes = (CFArrayRef) CFDictionaryGetValue( inRestrictions, inKey );
+	if ( cfTypes == NULL || CFGetTypeID(cfTypes) != CFArrayGetTypeID() )
+		return;
+	
+	CFIndex count = CFArrayGetCount( cfTypes );
+	for ( CFIndex i = 0; i < count; i++ )
+	{
+		CFStringRef cfType = (CFStringRef) CFArrayGetValueAtIndex( cfTypes, i );
+		if ( CFGetTypeID(cfType) == CFStringGetTypeID() )
+			CFArrayAppendValue( ioTypes, cfType );
+	}
+}
+
+static void CompileRecordTypeRule( CFDictionaryRef inRestrictionDict, sRecTypeRule *outRule )
+{
+	CFStringRef	cfKey	= NULL;
+	
+	outRule->fKind = kRecTypeRuleNone;
+	
+	if ( inRestrictionDict == NULL || CFGetTypeID(inRestrictionDict) != CFDictionaryGetTypeID() )
+		return;
+	
+	//Deny list is ONLY used if Allow list is NOT present
+	if ( CFDictionaryContainsKey(inRestrictionDict, CFSTR(kRTRAllowKey)) ) {
+		outRule->fKind = kRecTypeRuleAllow;
+		cfKey = CFSTR(kRTRAllowKey);
+	}
+	else if ( CFDictionaryContainsKey(inRestrictionDict, CFSTR(kRTRDenyKey)) ) {
+		outRule->fKind = kRecTypeRuleDeny;
+		cfKey = CFSTR(kRTRDenyKey);
+	}
+	else {
+		return;
+	}
+	
+	CFMutableArrayRef cfTypes = CFArrayCreateMutable( kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks );
+	CollectRecordTypes( inRestrictionDict, cfKey, cfTypes );
+	
+	CFIndex count = CFArrayGetCount( cfTypes );
+	outRule->fTypes = (char **) calloc( count + 1, sizeof(char *) );
+	for ( CFIndex i = 0; i < count; i++ )
+	{
+		char *type = CopyCStringFromCFString( (CFStringRef) CFArrayGetValueAtIndex(cfTypes, i) );
+		
+		// an empty type never matched with CFStringFindWithOptions, keep it that way
+		if ( type != NULL && type[0] != '\0' )
+			outRule->fTypes[outRule->fTypeCount++] = type;
+		else
+			DSFree( type );
+	}
+	
+	DSCFRelease( cfTypes );
+}
+
+static void FreeRecordTypeRestrictions( sRecTypeRestrictions *inRestrictions )
+{
+	if ( inRestrictions == NULL )
+		return;
+	
+	for ( UInt32 ii = 0; ii < inRestrictions->fPluginCount; ii++ )
+	{
+		sRecTypePluginRules *plugin = &inRestrictions->fPlugins[ii];
+		
+		for ( UInt32 jj = 0; jj < plugin->fRuleCount; jj++ )
+		{
+			sRecTypeRule *rule = &plugin->fRules[jj];
+			
+			for ( UInt32 kk = 0; kk < rule->fTypeCount; kk++ )
+				DSFree( rule->fTypes[kk] );
+			DSFree( rule->fTypes );
+			DSFree( rule->fNodeName );
+		}
+		DSFree( plugin->fRules );
+		DSFree( plugin->fPluginName );
+	}
+	DSFree( inRestrictions->fPlugins );
+	
+	free( inRestrictions );
+}
+
+// a reader holds a table only for the length of one IsOKToServiceQuery call
+#define kRecTypeRestrictionsGracePeriod		30
+
+// ---------------------------------------------------------------------------
+//	* CompileRecordTypeRestrictions
+//
+//		Builds the lookup structure used by IsOKToServiceQuery from
+//		fCFRecordTypeRestrictions.  Must be called with fMutex held.  The
+//		replaced table is retired rather than freed, since readers may still
+//		be using it, and retired tables are freed by a later swap once they
+//		are older than the grace period.  Swaps only happen on a reload.
+// ---------------------------------------------------------------------------
+
+void CPlugInList::CompileRecordTypeRestrictions( void )
+{
+	sRecTypeRestrictions	*restrictions	= NULL;
+	
+	if ( fCFRecordTypeRestrictions != NULL )
+	{
+		CFIndex			pluginCount	= CFDictionaryGetCount( fCFRecordTypeRestrictions );
+		CFStringRef		*pluginKeys	= (CFStringRef *) calloc( pluginCount, sizeof(CFStringRef) );
+		CFDictionaryRef	*pluginVals	= (CFDictionaryRef *) calloc( pluginCount, sizeof(CFDictionaryRef) );
+		
+		CFDictionaryGetKeysAndValues( fCFRecordTypeRestrictions, (const void **) pluginKeys, (const void **) pluginVals );
+		
+		restrictions = (sRecTypeRestrictions *) calloc( 1, sizeof(sRecTypeRestrictions) );
+		restrictions->fPlugins = (sRecTypePluginRules *) calloc( pluginCount, sizeof(sRecTypePluginRules) );
+		
+		// build the per plugin, per node rules
+		for ( CFIndex ii = 0; ii < pluginCount; ii++ )
+		{
+			if ( CFGetTypeID(pluginVals[ii]) != CFDictionaryGetTypeID() )
+				continue;
+			
+			char *pluginName = CopyCStringFromCFString( pluginKeys[ii] );
+			if ( pluginName == NULL )
+				continue;
+			
+			sRecTypePluginRules	*plugin		= &restrictions->fPlugins[restrictions->fPluginCount++];
+			CFIndex				nodeCount	= CFDictionaryGetCount( pluginVals[ii] );
+			CFStringRef			*nodeKeys	= (CFStringRef *) calloc( nodeCount, sizeof(CFStringRef) );
+			CFDictionaryRef		*nodeVals	= (CFDictionaryRef *) calloc( nodeCount, sizeof(CFDictionaryRef) );
+			
+			plugin->fPluginName = pluginName;
+			plugin->fRules = (sRecTypeRule *) calloc( nodeCount, sizeof(sRecTypeRule) );
+			
+			CFDictionaryGetKeysAndValues( pluginVals[ii], (const void **) nodeKeys, (const void **) nodeVals );
+			for ( CFIndex jj = 0; jj < nodeCount; jj++ )
+			{
+				char *nodeName = CopyCStringFromCFString( nodeKeys[jj] );
+				if ( nodeName == NULL )
+					continue;
+				
+				sRecTypeRule *rule = &plugin->fRules[plugin->fRuleCount++];
+				
+				rule->fNodeName = nodeName;
+				CompileRecordTypeRule( nodeVals[jj], rule );
+				if ( strcmp(nodeName, "General") == 0 )
+					plugin->fGeneralRule = rule;
+			}
+			
+			DSFree( nodeKeys );
+			DSFree( nodeVals );
+		}
+		
+		DSFree( pluginKeys );
+		DSFree( pluginVals );
+	}
+	
+	// the CAS is a full barrier, the table is complete before readers can see it
+	sRecTypeRestrictions *oldRestrictions;
+	do {
+		oldRestrictions = fRecTypeRestrictions;
+	} while ( __sync_bool_compare_and_swap(&fRecTypeRestrictions, oldRestrictions, restrictions) == false );
+	
+	time_t now = time( NULL );
+	
+	// free what was retired long enough ago that no reader can still have it
+	sRecTypeRestrictions **retired = &fRetiredRecTypeRestrictions;
+	while ( (*retired) != NULL && now - (*retired)->fRetiredAt < kRecTypeRestrictionsGracePeriod )
+		retired = &(*retired)->fRetiredNext;
+	
+	while ( (*retired) != NULL )
+	{
+		sRecTypeRestrictions *expired = (*retired);
+		
+		(*retired) = expired->fRetiredNext;
+		FreeRecordTypeRestrictions( expired );
+	}
+	
+	if ( oldRestrictions != NULL )
+	{
+		oldRestrictions->fRetiredAt = now;
+		oldRestrictions->fRetiredNext = fRetiredRecTypeRestrictions;
+		fRetiredRecTypeRestrictions = oldRestrictions;
+	}
+	
+} // CompileRecordTypeRestrictions
+
+
 // ---------------------------------------------------------------------------
 //	* IsOKToServiceQuery
+//
+//		Evaluated against the compiled restrictions without taking fMutex and
+//		without allocating.  inRecordTypeList is the ";" separated list of the
+//		requested record types, each restriction entry matches when it is a
+//		case-insensitive substring of that list.
 // ---------------------------------------------------------------------------
 
 bool CPlugInList::IsOKToServiceQuery( const char *inPluginName, const char *inNodeName, const char *inRecordTypeList, UInt32 inNumberRecordTypes )
 {
-	bool isOK = true;
+	sRecTypeRestrictions	*restrictions	= NULL;
+	sRecTypePluginRules		*plugin			= NULL;
+	sRecTypeRule			*rule			= NULL;
+	bool					isOK			= true;
 	
 	if (inRecordTypeList == NULL) //can't see this ever happening as we check before calling this routine
 		return(isOK);
 	
-	fMutex.WaitLock();
+	if ( inPluginName == NULL || inNodeName == NULL )
+		return(isOK);
 	
-	if (fCFRecordTypeRestrictions != NULL && inPluginName != NULL)
+	// a single load, a table replaced while we use it stays valid for the grace period
+	restrictions = fRecTypeRestrictions;
+	if ( restrictions == NULL )
+		return(isOK);
+	
+	for ( UInt32 ii = 0; ii < restrictions->fPluginCount && plugin == NULL; ii++ )
 	{
-		CFStringRef cfPluginName = NULL;
-		cfPluginName = CFStringCreateWithCString( kCFAllocatorDefault, inPluginName, kCFStringEncodingUTF8 );
-		if ( CFDictionaryContainsKey( fCFRecordTypeRestrictions, cfPluginName ) ) //plugin entry is in the dictionary
+		if ( strcmp(restrictions->fPlugins[ii].fPluginName, inPluginName) == 0 )
+			plugin = &restrictions->fPlugins[ii];
+	}
+	
+	if ( plugin != NULL )
+	{
+		for ( UInt32 ii = 0; ii < plugin->fRuleCount && rule == NULL; ii++ )
 		{
-			CFDictionaryRef cfPluginRestrictions = NULL;
-			cfPluginRestrictions = (CFDictionaryRef)CFDictionaryGetValue( fCFRecordTypeRestrictions, cfPluginName );
-			if (inNodeName != NULL) //we have a node name that we can check for
+			if ( strcmp(plugin->fRules[ii].fNodeName, inNodeName) == 0 )
+				rule = &plugin->fRules[ii];
+		}
+		
+		if ( rule == NULL )
+			rule = plugin->fGeneralRule;
+	}
+	
+	if ( rule != NULL && rule->fKind == kRecTypeRuleAllow )
+	{
+		UInt32 countMatchesFound = 0;
+		
+		isOK = false; //init to false since we look over allowed record types
+		for ( UInt32 ii = 0; ii < rule->fTypeCount; ii++ )
+		{
+			//if the allowed type is contained within inRecordTypeList
+			if ( strcasestr(inRecordTypeList, rule->fTypes[ii]) != NULL )
 			{
-				CFStringRef cfNodeName = NULL;
-				cfNodeName = CFStringCreateWithCString( kCFAllocatorDefault, inNodeName, kCFStringEncodingUTF8 );
-				bool useRestrictions = false;
-				if ( CFDictionaryContainsKey( cfPluginRestrictions, cfNodeName ) ) //nodename entry is in the dictionary
-				{
-					useRestrictions = true;
-				}
-				else if ( CFDictionaryContainsKey( cfPluginRestrictions, CFSTR("General") ) ) //General entry is in the dictionary
-				{
-					DSCFRelease(cfNodeName);
-					cfNodeName = CFStringCreateWithCString( kCFAllocatorDefault, "General", kCFStringEncodingUTF8 );
-					useRestrictions = true;
-				}
-				
-				if (useRestrictions)
+				countMatchesFound++;
+				//confirm that inNumberRecordTypes is equal to countMatchesFound
+				if ( inNumberRecordTypes == countMatchesFound )
 				{
-					//the record type list requested
-					CFStringRef cfRecordTypeList = NULL;
-					cfRecordTypeList = CFStringCreateWithCString( kCFAllocatorDefault, inRecordTypeList, kCFStringEncodingUTF8 );
-
-					//get the restrictions dictionary
-					CFDictionaryRef cfRestrictions = NULL;
-					cfRestrictions = (CFDictionaryRef)CFDictionaryGetValue( cfPluginRestrictions, cfNodeName );
-
-					if ( CFDictionaryContainsKey( cfRestrictions, CFSTR(kRTRAllowKey) ) ) //Allow record type entry is in the dictionary
-					{
-						isOK = false; //init to false since we look over allowed record types
-						
-						//get the allow record type array
-						CFArrayRef cfAllowRecordTypes = NULL;
-						cfAllowRecordTypes = (CFArrayRef)CFDictionaryGetValue( cfRestrictions, CFSTR(kRTRAllowKey) );
-						
-						CFIndex cfNumberRecordTypesInArray = CFArrayGetCount( cfAllowRecordTypes );
-						UInt32 countMatchesFound = 0;
-						for( CFIndex i = 0; i<cfNumberRecordTypesInArray; i++ )
-						{
-							CFStringRef cfRecordType = (CFStringRef)CFArrayGetValueAtIndex( cfAllowRecordTypes, i );
-							//if cfRecordType is contained within cfRecordTypeList
-							if (CFStringFindWithOptions(cfRecordTypeList, cfRecordType, CFRangeMake( 0, CFStringGetLength( cfRecordTypeList )), kCFCompareCaseInsensitive, NULL))
-							{
-								countMatchesFound++;
-								//confirm that inNumberRecordTypes is equal to countMatchesFound
-								if (inNumberRecordTypes == countMatchesFound)
-								{
-									isOK = true;
-									break;
-								}
-							}
-						}
-					}
-					//check for Deny list ONLY if Allow list is NOT present
-					else if ( CFDictionaryContainsKey( cfRestrictions, CFSTR(kRTRDenyKey) ) ) //Deny record type entry is in the dictionary
-					{
-						//get the deny record type array
-						CFArrayRef cfDenyRecordTypes = NULL;
-						cfDenyRecordTypes = (CFArrayRef)CFDictionaryGetValue( cfRestrictions, CFSTR(kRTRDenyKey) );
-						
-						CFIndex cfNumberRecordTypesInArray = CFArrayGetCount( cfDenyRecordTypes );
-						for( CFIndex i = 0; i<cfNumberRecordTypesInArray; i++ )
-						{
-							CFStringRef cfRecordType = (CFStringRef)CFArrayGetValueAtIndex( cfDenyRecordTypes, i );
-							//if cfRecordType is contained within cfRecordTypeList
-							if (CFStringFindWithOptions(cfRecordTypeList, cfRecordType, CFRangeMake( 0, CFStringGetLength( cfRecordTypeList )), kCFCompareCaseInsensitive, NULL))
-							{
-								isOK = false; //first match we break out
-								break;
-							}
-						}
-					}
-					
-					DSCFRelease(cfRecordTypeList);
+					isOK = true;
+					break;
 				}
-				DSCFRelease(cfNodeName);
 			}
 		}
-		DSCFRelease(cfPluginName);
+	}
+	else if ( rule != NULL && rule->fKind == kRecTypeRuleDeny )
+	{
+		for ( UInt32 ii = 0; ii < rule->fTypeCount; ii++ )
+		{
+			//if the denied type is contained within inRecordTypeList
+			if ( strcasestr(inRecordTypeList, rule->fTypes[ii]) != NULL )
+			{
+				isOK = false; //first match we break out
+				break;
+			}
+		}
 	}
 	
-	fMutex.SignalLock();
-
 	return(isOK);
 	
 } // IsOKToServiceQuery
@@ -88,16 +88,50 @@ typedef struct sTableData
 	CFUUIDRef			fCFuuidFactory;
 	UInt32				fULVers;
 	FourCharCode		fKey;
-	UInt32				fState;
-	UInt32				fValidDataStamp; //perhaps better if uuid can seed this mod count?
+	volatile UInt32		fState;
+	volatile UInt32		fValidDataStamp; //perhaps better if uuid can seed this mod count?
 	eDSPluginLevel		fLevel;
+	UInt32				fNameHash;
 	sTableData		   *pNext;
 } sTableData;
 
 enum {
-	kMaxPlugIns	= 128
+	kMaxPlugIns		= 128,
+	kPlugInHashSize	= 256	// power of 2 and at least twice kMaxPlugIns
 };
 
+// record type restrictions compiled from fCFRecordTypeRestrictions, immutable once published
+// and freed a grace period after being replaced
+enum eRecTypeRuleKind {
+	kRecTypeRuleNone	= 0,
+	kRecTypeRuleAllow,
+	kRecTypeRuleDeny
+};
+
+typedef struct sRecTypeRule
+{
+	char				*fNodeName;
+	eRecTypeRuleKind	fKind;
+	UInt32				fTypeCount;
+	char				**fTypes;		// allowed or denied types, matched as case-insensitive substrings
+} sRecTypeRule;
+
+typedef struct sRecTypePluginRules
+{
+	char				*fPluginName;
+	UInt32				fRuleCount;
+	sRecTypeRule		*fRules;
+	sRecTypeRule		*fGeneralRule;	// "General" entry used when the node has no entry of its own
+} sRecTypePluginRules;
+
+typedef struct sRecTypeRestrictions
+{
+	UInt32				fPluginCount;
+	sRecTypePluginRules	*fPlugins;
+	struct sRecTypeRestrictions	*fRetiredNext;	// older replaced tables still waiting to be freed
+	time_t				fRetiredAt;
+} sRecTypeRestrictions;
+
 public:
 				CPlugInList			( void );
 	virtual	   ~CPlugInList			( void );
@@ -147,15 +181,25 @@ protected:
 	bool		CreatePrefDirectory	( void );
 	sTableData*	MakeTableEntryCopy	( sTableData* inEntry );
 	void		SetPluginState		( CServerPlugin	*inPluginPtr, ePluginState inPluginState );
+	void		CompileRecordTypeRestrictions( void );
+	sTableData*	FindEntry			( const char *inName );
+	sTableData*	FindEntry			( const UInt32 inKey );
 
 
-	CFDictionaryRef		fCFRecordTypeRestrictions;
+	CFDictionaryRef					fCFRecordTypeRestrictions;
+	sRecTypeRestrictions * volatile	fRecTypeRestrictions;		// published with a CAS under fMutex, read without any lock
+	sRecTypeRestrictions			*fRetiredRecTypeRestrictions;	// replaced tables, newest first, under fMutex
 
 private:
 	UInt32				fPICount;
 	DSMutexSemaphore		fMutex;
 	sTableData			*fTable;
 	sTableData			*fTableTail;
+	
+	// entries are never removed, so these are filled in under fMutex and read without it
+	sTableData			*fIndex[kMaxPlugIns];			// in registration order
+	sTableData			*fNameIndex[kPlugInHashSize];	// open addressed by name hash
+	sTableData			*fKeyIndex[kPlugInHashSize];	// open addressed by signature
 	DSEventSemaphore   	fWaitToInit;
 };
 
@@ -439,6 +439,28 @@ SInt32 CPluginConfig::SetPluginState ( const char *inPluginName, const ePluginSt
 } // SetPluginState
 
 
+//--------------------------------------------------------------------------------------------------
+//	* GetConcurrentClientDispatch ()
+//
+//		per-client requests are served one at a time unless the preferences turn this on
+//--------------------------------------------------------------------------------------------------
+
+bool CPluginConfig::GetConcurrentClientDispatch ( void )
+{
+	bool	bConcurrent	= false;
+	
+	if ( fDictRef != nil )
+	{
+		CFBooleanRef cfBool = (CFBooleanRef) CFDictionaryGetValue( fDictRef, CFSTR(kXMLDSConcurrentClientDispatchKey) );
+		if ( cfBool != nil && CFGetTypeID(cfBool) == CFBooleanGetTypeID() )
+			bConcurrent = CFBooleanGetValue( cfBool );
+	}
+	
+	return( bConcurrent );
+	
+} // GetConcurrentClientDispatch
+
+
 //--------------------------------------------------------------------------------------------------
 //	* SaveConfigData ()
 //
@@ -38,6 +38,7 @@
 
 
 #define	kConfigFilePath		"/Library/Preferences/DirectoryService/DirectoryService.plist"
+#define kXMLDSConcurrentClientDispatchKey	"Concurrent Client Dispatch"	//per-client requests concurrent (serialized per ref chain) instead of serial
 #define kDefaultConfig		"<dict>\
 	<key>Version</key>\
 	<string>1.1</string>\
@@ -94,6 +95,8 @@ public:
 	ePluginState	GetPluginState		( const char *inPluginName );
 	SInt32			SetPluginState		( const char *inPluginName, const ePluginState inPluginState );
 
+	bool			GetConcurrentClientDispatch	( void );
+
 protected:
 
 private:
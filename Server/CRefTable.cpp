@@ -143,6 +143,8 @@ sClientEntry::ClearChildRefs( void )
 CRefTable::CRefTable( RefDeallocateProc *deallocProc ) : fDeallocProc(deallocProc)
 {
 	fNextIndex = 0;
+	fRefCount = 0;
+	fRefSlots = (sRefSlot *) calloc( kIndexMask + 1, sizeof(sRefSlot) );
 	fQueue = dispatch_queue_create( "CRefTable", NULL );
 	fCleanupQueue = dispatch_queue_create( "CRefTableCleanup", NULL );
 	dispatch_queue_set_width( fQueue, LONG_MAX );
@@ -153,19 +155,20 @@ CRefTable::~CRefTable( void )
 	dispatch_release( fCleanupQueue );
 	dispatch_release( fQueue );
 	fQueue = NULL;
+	
+	DSFree( fRefSlots );
 }
 
 sRefEntry *
 CRefTable::GetRefEntry( UInt32 inRef )
 {
-	__block sRefEntry		*entry = NULL;
-	__block tRefToEntryI	iter;
+	__block sRefEntry	*entry = NULL;
 	
 	dispatch_sync( fQueue,
 				   ^(void) {
-					   iter = fRefToEntry.find( inRef );
-					   if ( iter != fRefToEntry.end() ) {
-						   entry = iter->second->Retain();
+					   sRefSlot *slot = GetRefSlot( inRef );
+					   if ( slot != NULL ) {
+						   entry = slot->fEntry->Retain();
 					   }
 				   } );
 	
@@ -182,8 +185,6 @@ CRefTable::CreateReference( UInt32 *outRef, eRefType inType, CServerPlugin *inPl
 	__block sClientEntry			*client = NULL;
 	__block sRefEntry				*entry	= NULL;
 	__block sRefEntry				*parent = NULL;
-	__block tRefToClientEntryI		clientIter;
-	__block tRefToEntryI			refIter;
 	__block tPortToClientEntryI		portIter;
 	__block tMachPortToClientEntryI	machIter;
 	__block size_t					size;
@@ -199,14 +200,13 @@ CRefTable::CreateReference( UInt32 *outRef, eRefType inType, CServerPlugin *inPl
 		if ( VerifyReference(inParentID, GetRefType(inParentID), NULL, inMachPort, inSocket) == eDSNoErr ) {
 			dispatch_sync( fQueue, 
 						   ^(void) {
-							   refIter = fRefToEntry.find( inParentID );
-							   if ( refIter != fRefToEntry.end() ) {
-								   parent = refIter->second->Retain();
+							   sRefSlot *slot = GetRefSlot( inParentID );
+							   if ( slot != NULL ) {
+								   parent = slot->fEntry->Retain();
 								   
 								   // now get the client pointer
-								   clientIter = fRefToClientEntry.find( inParentID );
-								   if ( clientIter != fRefToClientEntry.end() ) {
-									   client = clientIter->second->Retain();
+								   if ( slot->fClient != NULL ) {
+									   client = slot->fClient->Retain();
 								   }
 							   }
 						   } );
@@ -254,18 +254,23 @@ CRefTable::CreateReference( UInt32 *outRef, eRefType inType, CServerPlugin *inPl
 	}
 	
 	// we shouldn't reach max limit, so don't expect it
-	if ( DSexpect_true(fRefToEntry.size() < 0xfffe) ) {
+	if ( DSexpect_true(fRefCount < 0xfffe) ) {
 		dispatch_barrier_sync( fQueue,
 					   ^(void) {
+						   sRefSlot	*slot;
+						   
 						   while ( 1 ) {
 							   // we should have mostly empty spots in normal case
-							   newRef = type | (fNextIndex++ & kIndexMask);
-							   refIter = fRefToEntry.find( newRef );
-							   if ( refIter == fRefToEntry.end() ) {
+							   slot = &fRefSlots[fNextIndex & kIndexMask];
+							   if ( slot->fEntry == NULL ) {
 								   break;
 							   }
+							   
+							   fNextIndex++;
 						   }
 						   
+						   newRef = type | (fNextIndex++ & kIndexMask);
+						   
 						   entry = new sRefEntry;
 						   entry->fParentID = inParentID;
 						   entry->fRefNum = newRef;
@@ -273,10 +278,11 @@ CRefTable::CreateReference( UInt32 *outRef, eRefType inType, CServerPlugin *inPl
 						   entry->fPlugin = inPlugin;
 						   entry->fRefTable = this;
 						   
-						   fRefToEntry[newRef] = entry->Retain();
+						   slot->fEntry = entry->Retain();
+						   fRefCount++;
 						   if ( client != NULL ) {
 							   client->fSubRefs[newRef] = entry->Retain();	// add to the subrefs
-							   fRefToClientEntry[newRef] = client->Retain();	// link to client
+							   slot->fClient = client->Retain();			// link to client
 							   
 							   size = client->fSubRefs.size();
 							   warnLimit = (inPID == gDaemonPID ? 2000 : gRefCountWarningLimit);
@@ -331,10 +337,9 @@ CRefTable::CreateReference( UInt32 *outRef, eRefType inType, CServerPlugin *inPl
 tDirStatus
 CRefTable::VerifyReference( UInt32 inRef, eRefType inType, CServerPlugin **outPlugin, mach_port_t inMachPort, int inSocket )
 {
-	__block tDirStatus			status	= eDSInvalidReference;
-	__block sClientEntry		*client	= NULL;
-	__block tRefToClientEntryI	clientIter;
-	__block tRefToEntryI		entryIter;
+	__block tDirStatus		status	= eDSInvalidReference;
+	__block sClientEntry	*client	= NULL;
+	__block CServerPlugin	*plugin	= NULL;
 	
 	if ( GetRefType(inRef) != inType ) {
 		DbgLog( kLogNotice, "CRefTable::VerifyReference - reference value of <%u> is not reference is wrong type.", inRef, inType );
@@ -343,9 +348,11 @@ CRefTable::VerifyReference( UInt32 inRef, eRefType inType, CServerPlugin **outPl
 
 	dispatch_sync( fQueue, 
 				   ^(void) {
-					   clientIter = fRefToClientEntry.find( inRef );
-					   if ( clientIter != fRefToClientEntry.end() ) {
-						   client = clientIter->second->Retain();
+					   // the client is only linked while the reference is in its subrefs
+					   sRefSlot *slot = GetRefSlot( inRef );
+					   if ( slot != NULL && slot->fClient != NULL ) {
+						   client = slot->fClient->Retain();
+						   plugin = slot->fEntry->fPlugin;
 					   }
 				   } );
 	
@@ -354,18 +361,9 @@ CRefTable::VerifyReference( UInt32 inRef, eRefType inType, CServerPlugin **outPl
 			if ( (client->fFlags & kClientTypeTCP) != 0 ) {
 				if ( client->portInfo.fSocket == inSocket ) {
 					if ( outPlugin != NULL ) {
-						dispatch_sync( fQueue, 
-									   ^(void) {
-										   entryIter = client->fSubRefs.find( inRef );
-										   if ( entryIter != client->fSubRefs.end() ) {
-											   (*outPlugin) = entryIter->second->fPlugin;
-											   status = eDSNoErr;
-										   }
-									   } );
-					}
-					else {
-						status = eDSNoErr;
+						(*outPlugin) = plugin;
 					}
+					status = eDSNoErr;
 				}
 			}
 			
@@ -378,18 +376,9 @@ CRefTable::VerifyReference( UInt32 inRef, eRefType inType, CServerPlugin **outPl
 			if ( (client->fFlags & kClientTypeMach) != 0 ) {
 				if ( client->portInfo.fMachPort == inMachPort ) {
 					if ( outPlugin != NULL ) {
-						dispatch_sync( fQueue, 
-									   ^(void) {
-										   entryIter = client->fSubRefs.find( inRef );
-										   if ( entryIter != client->fSubRefs.end() ) {
-											   (*outPlugin) = entryIter->second->fPlugin;
-											   status = eDSNoErr;
-										   }
-									   } );
-					}
-					else {
-						status = eDSNoErr;
+						(*outPlugin) = plugin;
 					}
+					status = eDSNoErr;
 				}
 			}
 			
@@ -410,54 +399,49 @@ CRefTable::VerifyReference( UInt32 inRef, eRefType inType, CServerPlugin **outPl
 
 struct sRemoveContext
 {
-	UInt32				refNum;
-	tRefToClientEntry	*refToClientEntry;
-	tRefToEntry			*refToEntry;
+	UInt32		refNum;
+	CRefTable	*refTable;
 };
 
 void
 CRefTable::RemoveReference( void *inContext )
 {
 	// need to delete from all tables
-	//   fRefToEntry
-	//   fRefToClientEntry
-	//		-- fSubRefs
+	//   fRefSlots
+	//		-- fClient->fSubRefs
 	//   fParent->fSubRefs
 	
-	sRemoveContext	*context = (sRemoveContext *) inContext;
+	sRemoveContext	*context	= (sRemoveContext *) inContext;
+	CRefTable		*refTable	= context->refTable;
 	
-	tRefToClientEntryI clientIter = context->refToClientEntry->find( context->refNum );
-	if ( clientIter != context->refToClientEntry->end() ) {
-		sClientEntry	*client = clientIter->second;
+	sRefSlot *slot = refTable->GetRefSlot( context->refNum );
+	if ( slot != NULL ) {
+		sRefEntry		*entry		= slot->fEntry;
+		sClientEntry	*client		= slot->fClient;
+		UInt32			parentID	= entry->fParentID;
 		
-		context->refToClientEntry->erase( clientIter );
+		slot->fEntry = NULL;
+		slot->fClient = NULL;
+		refTable->fRefCount--;
 		
-		tRefToEntryI refIter = client->fSubRefs.find( context->refNum );
-		if ( refIter != client->fSubRefs.end() ) {
-			sRefEntry *entry = refIter->second;
-			
-			client->fSubRefs.erase( refIter );
+		if ( client != NULL ) {
+			tRefToEntryI refIter = client->fSubRefs.find( context->refNum );
+			if ( refIter != client->fSubRefs.end() ) {
+				client->fSubRefs.erase( refIter );
+				
+				DbgLog( kLogDebug, "CRefTable::RemoveReference - Removed reference %d from client subrefs", context->refNum );
+				entry->Release();
+			}
 			
-			DbgLog( kLogDebug, "CRefTable::RemoveReference - Removed reference %d from client subrefs", context->refNum );
-			entry->Release();
+			client->Release();
 		}
 		
-		client->Release();
-	}
-	
-	tRefToEntryI refIter = context->refToEntry->find( context->refNum );
-	if ( refIter != context->refToEntry->end() ) {
-		sRefEntry *	entry = refIter->second;
-		UInt32		parentID = entry->fParentID;
-		
-		context->refToEntry->erase( refIter );
-		
 		if ( parentID != 0 ) {
-			refIter = context->refToEntry->find( parentID );
-			if ( refIter != context->refToEntry->end() ) {
-				sRefEntry *	parent = refIter->second;
+			sRefSlot *parentSlot = refTable->GetRefSlot( parentID );
+			if ( parentSlot != NULL ) {
+				sRefEntry	*parent = parentSlot->fEntry;
 				
-				refIter = parent->fSubRefs.find( context->refNum );
+				tRefToEntryI refIter = parent->fSubRefs.find( context->refNum );
 				if ( refIter != parent->fSubRefs.end() ) {
 					parent->fSubRefs.erase( refIter );
 					DbgLog( kLogDebug, "CRefTable::RemoveReference - Removed reference %d from parent %d subrefs", context->refNum, parentID );
@@ -486,8 +470,7 @@ CRefTable::RemoveReference( UInt32 inRef )
 {
 	sRemoveContext *context = new sRemoveContext;
 	context->refNum = inRef;
-	context->refToClientEntry = &fRefToClientEntry;
-	context->refToEntry = &fRefToEntry;
+	context->refTable = this;
 
 	// workaround dispatch + block related limitations
 	dispatch_barrier_async_f( fQueue, context, RemoveReference );
@@ -519,6 +502,28 @@ CRefTable::GetPluginForRef( UInt32 inRef )
 	return pluginPtr;
 }
 
+UInt32
+CRefTable::GetChainRef( UInt32 inRef )
+{
+	__block UInt32	chainRef	= inRef;
+	
+	// walk up to the owning node reference, records and lists hang off of it
+	dispatch_sync( fQueue,
+				   ^(void) {
+					   sRefSlot *slot = GetRefSlot( inRef );
+					   while ( slot != NULL ) {
+						   chainRef = slot->fEntry->fRefNum;
+						   if ( GetRefType(chainRef) == eRefTypeDirNode || slot->fEntry->fParentID == 0 ) {
+							   break;
+						   }
+						   
+						   slot = GetRefSlot( slot->fEntry->fParentID );
+					   }
+				   } );
+	
+	return chainRef;
+}
+
 char *
 CRefTable::CopyNodeRefName( tDirNodeReference inDirNodeRef )
 {
@@ -55,6 +55,10 @@ class CServerPlugin;
  * Indexes are not recycled until we loop back around.  Simplifies debugging so refs aren't
  * re-used immediately after they are freed.  Most references are freed anyway, so there should
  * always be free slots.
+ *
+ * An index is only ever in use by one reference regardless of type, so the index is used directly
+ * as the slot in the reference table.  The slot keeps the full reference value and lookups compare
+ * it, so a stale reference whose index has since been recycled under another type is rejected.
  */
 
 enum eRefType {
@@ -85,9 +89,6 @@ class CRefTable;
 typedef map<UInt32, sRefEntry *>					tRefToEntry;
 typedef map<UInt32, sRefEntry *>::iterator			tRefToEntryI;
 
-typedef map<UInt32, sClientEntry *>					tRefToClientEntry;
-typedef map<UInt32, sClientEntry *>::iterator		tRefToClientEntryI;
-
 typedef map<mach_port_t, sClientEntry *>			tMachPortToClientEntry;
 typedef map<mach_port_t, sClientEntry *>::iterator	tMachPortToClientEntryI;
 
@@ -142,6 +143,12 @@ protected:
 	virtual	~sClientEntry( void );
 };
 
+struct sRefSlot
+{
+	sRefEntry			*fEntry;
+	sClientEntry		*fClient;
+};
+
 #define kClientTypeMach	0x00000001
 #define kClientTypeTCP	0x00000002
 
@@ -180,6 +187,7 @@ public:
 	tDirStatus		SetNodePluginPtr	( tDirNodeReference inNodeRef, CServerPlugin *inPlugin );
 	
 	CServerPlugin	*GetPluginForRef	( UInt32 inRef );
+	UInt32			GetChainRef			( UInt32 inRef );
 
 	void			CleanRefsForSocket	( int inSocket );
 	void			CleanRefsForMachRefs( mach_port_t inMachPort );
@@ -193,6 +201,11 @@ public:
 
 private:
 	sRefEntry		*GetRefEntry		( UInt32 inRef );
+	inline sRefSlot	*GetRefSlot			( UInt32 inRef )
+	{
+		sRefSlot *slot = &fRefSlots[inRef & kIndexMask];
+		return ((slot->fEntry != NULL && slot->fEntry->fRefNum == inRef) ? slot : NULL);
+	}
 	static void		RemoveReference		( void *inContext );
 
 private:
@@ -201,8 +214,8 @@ private:
 	tMachPortToClientEntry	fMachPortToClientEntry;
 	tPortToClientEntry		fPortToClientEntry;
 	
-	tRefToEntry				fRefToEntry;
-	tRefToClientEntry		fRefToClientEntry;
+	sRefSlot				*fRefSlots;	// indexed by (ref & kIndexMask)
+	UInt32					fRefCount;
 	
 	uint16_t				fNextIndex;	// this is the circular ref value
 	
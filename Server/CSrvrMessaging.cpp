@@ -29,6 +29,7 @@
 #include "PrivateTypes.h"
 #include "DirServicesTypes.h"
 #include "DSUtils.h"
+#include "DataListPriv.h"
 #include "CLog.h"
 
 #include <string.h>
@@ -426,6 +427,7 @@ SInt32 CSrvrMessaging::Get_tDataList_FromMsg ( sComData *inMsg, tDataList **outL
 						pCurNodeData = pNewNodeData;
 						
 						pOutList->fDataNodeCount++;
+						dsDataListIndexAppendPriv( pOutList, (tDataNodePtr) pNewNodeData );
 					}
 					*outList = pOutList;
 				}
@@ -680,7 +682,6 @@ void CSrvrMessaging::ClearMessageBlock ( sComData *inMsg )
 
 void CSrvrMessaging::Grow ( sComData **inMsg, UInt32 inOffset, UInt32 inSize )
 {
-	UInt32			newSize		= 0;
 	sComData	   *pNewPtr		= nil;
 
 	// Is there anything to do
@@ -692,33 +693,16 @@ void CSrvrMessaging::Grow ( sComData **inMsg, UInt32 inOffset, UInt32 inSize )
 	// Do we need a bigger object
 	if ( ((*inMsg)->fDataLength + inSize) > (*inMsg)->fDataSize )
 	{
-		newSize = (*inMsg)->fDataSize;
-		//idea is to make the newSize a multiple of kMsgBlockSize
-		while( newSize < ((*inMsg)->fDataLength + inSize) )
-		{
-			newSize += kMsgBlockSize;
-		}
-
-		// Create the new pointer
-		pNewPtr = (sComData *)::calloc( 1, sizeof( sComData ) + newSize );
+		// grows geometrically, copies the old data and recycles the old block
+		pNewPtr = dsGrowComDataPriv( (*inMsg), (*inMsg)->fDataLength + inSize );
 		if ( pNewPtr == nil )
 		{
 			throw( (SInt32)eMemoryAllocError );
 		}
 
-		// Copy the old data to the new destination
-		::memcpy( pNewPtr, (*inMsg), sizeof( sComData ) + (*inMsg)->fDataLength );
-
-		// Dump the old data block
-		::free( (*inMsg) );
-		(*inMsg) = nil;
-
 		// Assign the new data block
-		(*inMsg) = (sComData *)pNewPtr;
+		(*inMsg) = pNewPtr;
 		pNewPtr = nil;
-
-		// Set the new data size
-		(*inMsg)->fDataSize = newSize;
 	}
 } // Grow
 
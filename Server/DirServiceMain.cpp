@@ -97,6 +97,7 @@ dsBool	gDSLocalOnlyMode		= false;
 dsBool	gDSInstallDaemonMode	= false;
 dsBool	gProperShutdown			= false;
 dsBool	gSafeBoot				= false;
+dsBool	gDSConcurrentClientDispatch	= false;	//per-client requests run concurrently, serialized per reference chain
 CFTypeRef		gEventPort		= NULL;
 uint32_t	gNumberOfCores		= 0;
 
@@ -444,6 +445,7 @@ int main ( int argc, char * const *argv )
 		
 		// Open the log files
 		CLog::Initialize(kLogNone, kLogNone, debugOpts, profileOpts, gDebugLogging, bProfiling, gDSLocalOnlyMode, od_passthru_log_message);
+		CLog::StartAsyncLogging(od_passthru_log_context, od_passthru_log_message_with_context);
 
 		SrvrLog( kLogApplication, "\n\n" );
 		SrvrLog(kLogApplication, "dspluginhelperd (build %s) starting up...", gStrDaemonBuildVersion);
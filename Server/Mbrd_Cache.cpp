@@ -34,6 +34,10 @@
 
 extern CPlugInList		   *gPlugins;
 
+// entries are bucketed by expiration so a sweep only visits entries that are due
+#define kExpiryBucketCount			256
+#define kExpiryBucketSeconds		60
+
 struct _MbrdCache
 {
 	int32_t					fRefCount;
@@ -50,6 +54,11 @@ struct _MbrdCache
 	UserGroup				*fListHead;
 	UserGroup				*fListTail;
 	
+	volatile uint32_t		fGeneration;		// bumped on node changes, entries are checked lazily
+	uint32_t				fGenerationTime;	// when fGeneration was last bumped
+	uint32_t				fLastSweepSlot;
+	UserGroup				*fExpiryBuckets[kExpiryBucketCount];
+	
 	struct HashTable		fGUIDHash;
 	struct HashTable		fSIDHash;
 	struct HashTable		fUIDHash;
@@ -113,6 +122,66 @@ static bool ItemOutdated( UserGroup* item, int flags )
 	return (item->fExpiration <= GetElapsedSeconds());
 }
 
+static void MbrdCache_UnscheduleExpiry( MbrdCache *cache, UserGroup *ug )
+{
+	if ( ug->fExpiryScheduled == false )
+		return;
+	
+	if ( ug->fExpiryLink != NULL )
+		ug->fExpiryLink->fExpiryBackLink = ug->fExpiryBackLink;
+	
+	if ( ug->fExpiryBackLink == NULL )
+		cache->fExpiryBuckets[ug->fExpiryBucket] = ug->fExpiryLink;
+	else
+		ug->fExpiryBackLink->fExpiryLink = ug->fExpiryLink;
+	
+	ug->fExpiryLink = NULL;
+	ug->fExpiryBackLink = NULL;
+	ug->fExpiryScheduled = false;
+}
+
+static void MbrdCache_ScheduleExpiry( MbrdCache *cache, UserGroup *ug )
+{
+	uint32_t bucket = (ug->fExpiration / kExpiryBucketSeconds) % kExpiryBucketCount;
+	
+	if ( ug->fExpiryScheduled == true ) {
+		if ( ug->fExpiryBucket == bucket )
+			return;
+		
+		MbrdCache_UnscheduleExpiry( cache, ug );
+	}
+	
+	ug->fExpiryBucket = bucket;
+	ug->fExpiryBackLink = NULL;
+	ug->fExpiryLink = cache->fExpiryBuckets[bucket];
+	if ( ug->fExpiryLink != NULL )
+		ug->fExpiryLink->fExpiryBackLink = ug;
+	cache->fExpiryBuckets[bucket] = ug;
+	ug->fExpiryScheduled = true;
+}
+
+// applies any node change that happened since the entry was last validated, returns true if the entry should be removed
+static bool MbrdCache_ApplyGeneration( MbrdCache *cache, UserGroup *ug )
+{
+	uint32_t generation = cache->fGeneration;
+	
+	if ( ug->fGeneration == generation )
+		return false;
+	
+	// we delete negative entries on node changes
+	if ( (ug->fFlags & kUGFlagNotFound) != 0 )
+		return true;
+	
+	if ( ug->fExpiration > cache->fGenerationTime ) {
+		ug->fExpiration = cache->fGenerationTime;
+		MbrdCache_ScheduleExpiry( cache, ug );
+	}
+	
+	ug->fGeneration = generation;
+	
+	return false;
+}
+
 static void MbrdCache_RemoveFromList( MbrdCache *cache, UserGroup* ug )
 {
 	if ( ug->fLink == NULL )
@@ -125,6 +194,7 @@ static void MbrdCache_RemoveFromList( MbrdCache *cache, UserGroup* ug )
 	else
 		ug->fBackLink->fLink = ug->fLink;
 	
+	MbrdCache_UnscheduleExpiry( cache, ug );
 	UserGroup_Release( ug );
 	__sync_sub_and_fetch( &cache->fNumItems, 1 );
 }
@@ -146,6 +216,7 @@ static void MbrdCache_AddToHeadOfList( MbrdCache *cache, UserGroup* ug )
 		cache->fListHead = ug;
 	}
 
+	MbrdCache_ScheduleExpiry( cache, ug );
 	__sync_add_and_fetch( &cache->fNumItems, 1 );
 }
 
@@ -155,6 +226,11 @@ static void MbrdCache_AddToHashes( MbrdCache *cache, UserGroup *ug )
 	
 	ug->fMaximumRefresh = secs + cache->fMaximumRefresh;
 	ug->fExpiration = secs + ((ug->fFlags & kUGFlagNotFound) != 0 ? cache->fDefaultNegativeExpiration : cache->fDefaultExpiration);
+	ug->fGeneration = cache->fGeneration;
+	
+	// only moves the entry if it is already in the cache
+	if ( ug->fExpiryScheduled == true )
+		MbrdCache_ScheduleExpiry( cache, ug );
 
 	// all records get added to the GUID hash
 	if ( (ug->fFlags & kUGFlagHasGUID) != 0 )
@@ -400,7 +476,7 @@ UserGroup* MbrdCache_GetAndRetain( MbrdCache *cache, int recordType, int idType,
 				cacheResult = HashTable_GetAndRetain( &cache->fUIDHash, idValue );
 			
 			if ( cacheResult == NULL )
-				DbgLog( kLogInfo, "%s - Membership - Cache miss - by UID %d", reqOrigin, *((id_t *) idValue) );
+				DbgTrace( kLogInfo, "%s - Membership - Cache miss - by UID %d", reqOrigin, *((id_t *) idValue) );
 			break;
 		
 		case ID_TYPE_GID:
@@ -408,7 +484,7 @@ UserGroup* MbrdCache_GetAndRetain( MbrdCache *cache, int recordType, int idType,
 				cacheResult = HashTable_GetAndRetain( &cache->fGIDHash, idValue );
 			
 			if ( cacheResult == NULL )
-				DbgLog( kLogInfo, "%s - Membership - Cache miss - by GID %d", reqOrigin, *((id_t *) idValue) );
+				DbgTrace( kLogInfo, "%s - Membership - Cache miss - by GID %d", reqOrigin, *((id_t *) idValue) );
 			break;
 			
 		case ID_TYPE_SID:
@@ -439,7 +515,7 @@ UserGroup* MbrdCache_GetAndRetain( MbrdCache *cache, int recordType, int idType,
 				cacheResult = HashTable_GetAndRetain( &cache->fComputerNameHash, idValue );
 			
 			if ( cacheResult == NULL )
-				DbgLog( kLogInfo, "%s - Membership - Cache miss - by Name %s for type %X", reqOrigin, (char *)idValue, recordType );
+				DbgTrace( kLogInfo, "%s - Membership - Cache miss - by Name %s for type %X", reqOrigin, (char *)idValue, recordType );
 			break;
 			
 		case ID_TYPE_GROUPNAME:
@@ -449,7 +525,7 @@ UserGroup* MbrdCache_GetAndRetain( MbrdCache *cache, int recordType, int idType,
 				cacheResult = HashTable_GetAndRetain( &cache->fComputerGroupNameHash, idValue );
 			
 			if ( cacheResult == NULL )
-				DbgLog( kLogInfo, "%s - Membership - Cache miss - by Name %s for type %X", reqOrigin, (char *)idValue, recordType );
+				DbgTrace( kLogInfo, "%s - Membership - Cache miss - by Name %s for type %X", reqOrigin, (char *)idValue, recordType );
 			break;
 			
 		case ID_TYPE_KERBEROS:
@@ -475,8 +551,24 @@ UserGroup* MbrdCache_GetAndRetain( MbrdCache *cache, int recordType, int idType,
 			break;
 	};
 	
+	// a node change happened since this entry was validated, apply it now instead of walking the whole cache
+	if ( cacheResult != NULL && cacheResult->fGeneration != cache->fGeneration ) {
+		assert( pthread_mutex_lock(&cache->fCacheLock) == 0 );
+		
+		// the entry could have been removed from the cache while we waited for the lock
+		if ( cacheResult->fExpiryScheduled == true && MbrdCache_ApplyGeneration(cache, cacheResult) == true ) {
+			DbgLog( kLogDebug, "%s - Membership - Cache entry %s (%X) removed due to node change", reqOrigin, 
+				    (cacheResult->fName ? : "\"no name\""), cacheResult );
+			MbrdCache_RemoveEntry( cache, cacheResult );
+			UserGroup_Release( cacheResult );
+			cacheResult = NULL;
+		}
+		
+		assert( pthread_mutex_unlock(&cache->fCacheLock) == 0 );
+	}
+	
 	if ( cacheResult != NULL ) {
-		DbgLog( kLogDebug, "%s - Membership - Cache hit - %s (%X)", reqOrigin, (cacheResult->fName ? : "\"no name\""), cacheResult );
+		DbgTrace( kLogDebug, "%s - Membership - Cache hit - %s (%p)", reqOrigin, (cacheResult->fName ? : "\"no name\""), cacheResult );
 	}
 		
 	return cacheResult;
@@ -589,6 +681,8 @@ UserGroup *MbrdCache_AddOrUpdate( MbrdCache *cache, UserGroup *entry, uint32_t f
 		result->fTimestamp = time( NULL );
 		result->fMaximumRefresh = secs + cache->fMaximumRefresh;
 		result->fExpiration = secs + ((result->fFlags & kUGFlagNotFound) != 0 ? cache->fDefaultNegativeExpiration : cache->fDefaultExpiration);
+		result->fGeneration = cache->fGeneration;
+		MbrdCache_ScheduleExpiry( cache, result );
 
 		result = MbrdCache_UpdateExistingRecord( cache, result, entry );
 	}
@@ -645,19 +739,35 @@ void MbrdCache_Sweep( MbrdCache *cache )
 {
 	if ( cache == NULL ) return;
 
+	uint32_t currentSlot = GetElapsedSeconds() / kExpiryBucketSeconds;
+	
 	assert( pthread_mutex_lock(&cache->fCacheLock) == 0 );
 	
-	UserGroup* temp = cache->fListHead;
-	while ( temp != NULL )
+	// only visit the buckets that came due since the last sweep, or all of them if we wrapped
+	uint32_t slot = cache->fLastSweepSlot;
+	if ( currentSlot - slot >= kExpiryBucketCount )
+		slot = currentSlot - kExpiryBucketCount + 1;
+	
+	for ( ; slot <= currentSlot; slot++ )
 	{
-		UserGroup *delItem = temp;
-		
-		temp = temp->fLink;
-		if ( ItemOutdated(delItem, 0) == true ) {
-			MbrdCache_RemoveEntry( cache, delItem );
+		UserGroup* temp = cache->fExpiryBuckets[slot % kExpiryBucketCount];
+		while ( temp != NULL )
+		{
+			UserGroup *delItem = temp;
+			
+			temp = temp->fExpiryLink;
+			if ( MbrdCache_ApplyGeneration(cache, delItem) == true || ItemOutdated(delItem, 0) == true ) {
+				MbrdCache_RemoveEntry( cache, delItem );
+			}
+			else {
+				// entries further out than one revolution or that were extended move to their current bucket
+				MbrdCache_ScheduleExpiry( cache, delItem );
+			}
 		}
 	}
 	
+	cache->fLastSweepSlot = currentSlot;
+	
 	assert( pthread_mutex_unlock(&cache->fCacheLock) == 0 );
 }
 
@@ -665,23 +775,11 @@ void MbrdCache_NodeChangeOccurred( MbrdCache *cache )
 {
 	if ( cache == NULL ) return;
 	
-	uint32_t currentTime = GetElapsedSeconds();
-	
 	assert( pthread_mutex_lock(&cache->fCacheLock) == 0);
 	
-	UserGroup* temp = cache->fListHead;
-	while ( temp != NULL ) {
-		UserGroup *delItem = temp;
-
-		temp = temp->fLink;
-		if ( (delItem->fFlags & kUGFlagNotFound) != 0 ) {
-			// we delete negative entries on node changes
-			MbrdCache_RemoveEntry( cache, delItem );
-		}
-		else {
-			delItem->fExpiration = currentTime;
-		}
-	}
+	// entries are expired or removed lazily when they are next looked up or swept
+	cache->fGenerationTime = GetElapsedSeconds();
+	__sync_add_and_fetch( &cache->fGeneration, 1 );
 	
 	assert( pthread_mutex_unlock(&cache->fCacheLock) == 0 );
 }
@@ -705,6 +803,14 @@ void MbrdCache_ResetCache( MbrdCache *cache )
 	UserGroup* temp = cache->fListHead;
 	cache->fListHead = NULL;
 	cache->fListTail = NULL;
+	bzero( cache->fExpiryBuckets, sizeof(cache->fExpiryBuckets) );
+	
+	for ( UserGroup *item = temp; item != NULL; item = item->fLink )
+	{
+		item->fExpiryLink = NULL;
+		item->fExpiryBackLink = NULL;
+		item->fExpiryScheduled = false;
+	}
 	assert( pthread_mutex_unlock(&cache->fCacheLock) == 0 );
 	
 	while (temp != NULL)
@@ -857,6 +963,9 @@ void MbrdCache_DumpState( MbrdCache *cache )
 	
 	assert( pthread_mutex_unlock(&cache->fCacheLock) == 0 );
 	
+	// cache hits and misses are always traced, and only logged while debug logging is on
+	CLog::DumpTrace( dumpFile );
+	
 	fclose( dumpFile );
 }
 
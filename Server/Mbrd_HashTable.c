@@ -25,123 +25,190 @@
 #include "Mbrd_HashTable.h"
 #include "Mbrd_UserGroup.h"
 #include <strings.h>
+#include <limits.h>
 #include <DirectoryServiceCore/CLog.h>
 #include <uuid/uuid.h>
 #include <syslog.h>
 #include <membershipPriv.h>
 
-// we have to use external struct because UserGroup records can be part of multiple rbtrees
-struct ug_rb_node {
-	struct rb_node		rbn;
-	long				index;	// index from keyoffset
-	struct UserGroup	*ug;
+// slots live inline in the table because UserGroup records can be part of multiple hashes
+struct HashSlot {
+	uint32_t			hash;	// precomputed hash of the key, used for probing and growth
+	uint32_t			index;	// index from keyoffset
+	struct UserGroup	*ug;	// NULL when the slot is empty
 };
 
+#define kHashTableMinSlots				16
+
 extern void ConvertSIDToString( char* string, ntsid_t* sid );
 
-#define RBNODE_TO_USERGROUP(n)			(((struct ug_rb_node *) n)->ug)
 #define USERGROUP_TO_KEY(ug,keyoff)		((void *) (((uintptr_t) ug) + keyoff))
 
-static int rbt_compare_id_nodes( const struct rb_node *n1, const struct rb_node *n2 )
+static const void *__HashTable_KeyForItem( HashTable *hash, UserGroup *item, long index )
 {
-	const id_t id1 = RBNODE_TO_USERGROUP(n1)->fID;
-	const id_t id2 = RBNODE_TO_USERGROUP(n2)->fID;
+	void *key = USERGROUP_TO_KEY( item, hash->fKeyOffset );
 	
-    if ( id1 < id2 ) {
-        return -1;
-    }
+	switch ( hash->fHashType )
+	{
+		case eNameHash:
+		case eKerberosHash:
+		case eX509DNHash:
+			// these are string pointers (kerberos and X509 are really an array)
+			return ((void **) key)[index];
+	}
 	
-    if ( id1 > id2 ) {
-        return 1;
-    }
-    return 0;
+	return key;
 }
 
-static int rbt_compare_id_key( const struct rb_node *n, const void *v )
+static uint32_t __HashTable_HashKey( HashTable *hash, const void *key )
 {
-	const id_t id1 = RBNODE_TO_USERGROUP(n)->fID;
-	const id_t id2 = *((id_t *) v);
+	const uint8_t	*bytes		= (const uint8_t *) key;
+	uint32_t		hashValue	= 2166136261U;	// FNV-1a
+	size_t			length		= 0;
+	size_t			ii;
 	
-    if ( id1 < id2 ) {
-        return -1;
-    }
+	switch ( hash->fHashType )
+	{
+		case eIDHash:
+			length = sizeof(id_t);
+			break;
+			
+		case eGUIDHash:
+			length = sizeof(uuid_t);
+			break;
+			
+		case eSIDHash:
+			length = sizeof(ntsid_t);
+			break;
+			
+		default:
+			while ( (*bytes) != '\0' ) {
+				hashValue = (hashValue ^ (*bytes++)) * 16777619U;
+			}
+			return hashValue;
+	}
 	
-    if ( id1 > id2 ) {
-        return 1;
-    }
-    return 0;
-}
-
-static int rbt_compare_name_nodes( const struct rb_node *n1, const struct rb_node *n2 )
-{
-	const char *name1 = RBNODE_TO_USERGROUP(n1)->fName;
-	const char *name2 = RBNODE_TO_USERGROUP(n2)->fName;
+	for ( ii = 0; ii < length; ii++ ) {
+		hashValue = (hashValue ^ bytes[ii]) * 16777619U;
+	}
 	
-	assert(name1);
-	assert(name2);
-	return strcmp( name1, name2 );
+	return hashValue;
 }
 
-static int rbt_compare_name_key( const struct rb_node *n, const void *v )
+static bool __HashTable_KeysEqual( HashTable *hash, const void *key1, const void *key2 )
 {
-	const char *name1 = RBNODE_TO_USERGROUP(n)->fName;
-	const char *name2 = (const char *) v;
+	switch ( hash->fHashType )
+	{
+		case eIDHash:
+			return (*((id_t *) key1) == *((id_t *) key2));
+			
+		case eGUIDHash:
+			return (uuid_compare(key1, key2) == 0);
+			
+		case eSIDHash:
+			return (bcmp(key1, key2, sizeof(ntsid_t)) == 0);
+	}
 	
-	assert(name1);
-	assert(name2);
-	return strcmp( name1, name2 );
-}
-
-static int rbt_compare_guid_nodes( const struct rb_node *n1, const struct rb_node *n2 )
-{
-	return uuid_compare( RBNODE_TO_USERGROUP(n1)->fGUID, RBNODE_TO_USERGROUP(n2)->fGUID );
-}
-
-static int rbt_compare_guid_key( const struct rb_node *n, const void *v )
-{
-	return uuid_compare( RBNODE_TO_USERGROUP(n)->fGUID, v );
+	assert( key1 != NULL );
+	assert( key2 != NULL );
+	return (strcmp((const char *) key1, (const char *) key2) == 0);
 }
 
-static int rbt_compare_sid_nodes( const struct rb_node *n1, const struct rb_node *n2 )
+static long __HashTable_FindSlot( HashTable *hash, const void *key, uint32_t keyHash )
 {
-	return bcmp( &RBNODE_TO_USERGROUP(n1)->fSID, &RBNODE_TO_USERGROUP(n2)->fSID, sizeof(ntsid_t) );
-}
-
-static int rbt_compare_sid_key( const struct rb_node *n, const void *v )
-{
-	return bcmp( &RBNODE_TO_USERGROUP(n)->fSID, v, sizeof(ntsid_t) );
+	if ( hash->fNumSlots == 0 ) return -1;
+	
+	unsigned long	mask	= hash->fNumSlots - 1;
+	unsigned long	ii		= keyHash & mask;
+	
+	// the table is never full, so we always hit an empty slot eventually
+	while ( hash->fSlots[ii].ug != NULL ) {
+		struct HashSlot *slot = &hash->fSlots[ii];
+		
+		if ( slot->hash == keyHash && __HashTable_KeysEqual(hash, __HashTable_KeyForItem(hash, slot->ug, slot->index), key) == true ) {
+			return (long) ii;
+		}
+		
+		ii = (ii + 1) & mask;
+	}
+	
+	return -1;
 }
 
-static int rbt_compare_kerberos_nodes( const struct rb_node *n1, const struct rb_node *n2 )
+static void __HashTable_PlaceSlot( struct HashSlot *slots, long numSlots, struct HashSlot *newSlot )
 {
-	const char *kerberos1 = RBNODE_TO_USERGROUP(n1)->fKerberos[((struct ug_rb_node *)n1)->index];
-	const char *kerberos2 = RBNODE_TO_USERGROUP(n2)->fKerberos[((struct ug_rb_node *)n2)->index];
+	unsigned long	mask	= numSlots - 1;
+	unsigned long	ii		= newSlot->hash & mask;
+	
+	while ( slots[ii].ug != NULL ) {
+		ii = (ii + 1) & mask;
+	}
 	
-	return strcmp( kerberos1, kerberos2 );
+	slots[ii] = (*newSlot);
 }
 
-static int rbt_compare_kerberos_key( const struct rb_node *n, const void *v )
+static void __HashTable_Resize( HashTable *hash, long numSlots )
 {
-	const char *kerberos1 = RBNODE_TO_USERGROUP(n)->fKerberos[((struct ug_rb_node *)n)->index];
-	const char *kerberos2 = (const char *) v;
+	struct HashSlot	*oldSlots		= hash->fSlots;
+	long			oldNumSlots		= hash->fNumSlots;
+	long			ii;
+	
+	hash->fSlots = (struct HashSlot *) calloc( numSlots, sizeof(struct HashSlot) );
+	assert( hash->fSlots != NULL );
+	hash->fNumSlots = numSlots;
+	
+	// hashes are stored in the slot so growing never touches the records
+	for ( ii = 0; ii < oldNumSlots; ii++ ) {
+		if ( oldSlots[ii].ug != NULL ) {
+			__HashTable_PlaceSlot( hash->fSlots, numSlots, &oldSlots[ii] );
+		}
+	}
 	
-	return strcmp( kerberos1, kerberos2 );
+	DSFree( oldSlots );
 }
 
-static int rbt_compare_x509dn_nodes( const struct rb_node *n1, const struct rb_node *n2 )
+static void __HashTable_InsertSlot( HashTable *hash, UserGroup *item, long index, uint32_t keyHash )
 {
-	const char *x509dn1 = RBNODE_TO_USERGROUP(n1)->fX509DN[((struct ug_rb_node *)n1)->index];
-	const char *x509dn2 = RBNODE_TO_USERGROUP(n2)->fX509DN[((struct ug_rb_node *)n2)->index];
+	struct HashSlot	newSlot;
+	
+	// keep the load factor under 3/4 so probe sequences stay short
+	if ( (hash->fNumEntries + 1) * 4 > hash->fNumSlots * 3 ) {
+		__HashTable_Resize( hash, (hash->fNumSlots != 0 ? hash->fNumSlots * 2 : kHashTableMinSlots) );
+	}
+	
+	newSlot.hash = keyHash;
+	newSlot.index = (uint32_t) index;
+	newSlot.ug = item;
 	
-	return strcmp( x509dn1, x509dn2 );
+	__HashTable_PlaceSlot( hash->fSlots, hash->fNumSlots, &newSlot );
+	hash->fNumEntries++;
 }
 
-static int rbt_compare_x509dn_key( const struct rb_node *n, const void *v )
+static void __HashTable_RemoveSlot( HashTable *hash, unsigned long hole )
 {
-	const char *x509dn1 = RBNODE_TO_USERGROUP(n)->fX509DN[((struct ug_rb_node *)n)->index];
-	const char *x509dn2 = (const char *) v;
+	unsigned long	mask	= hash->fNumSlots - 1;
+	unsigned long	ii		= hole;
+	
+	hash->fSlots[hole].ug = NULL;
+	
+	// shift following entries back into the hole so lookups never need tombstones
+	while ( 1 ) {
+		ii = (ii + 1) & mask;
+		
+		struct HashSlot *slot = &hash->fSlots[ii];
+		if ( slot->ug == NULL ) {
+			break;
+		}
+		
+		unsigned long home = slot->hash & mask;
+		if ( (ii > hole && (home <= hole || home > ii)) || (ii < hole && home <= hole && home > ii) ) {
+			hash->fSlots[hole] = (*slot);
+			slot->ug = NULL;
+			hole = ii;
+		}
+	}
 	
-	return strcmp( x509dn1, x509dn2 );
+	hash->fNumEntries--;
 }
 
 static bool __IsReservedGroup( UserGroup *item )
@@ -255,23 +322,18 @@ static bool __HashTable_Add( HashTable* hash, UserGroup* item, bool replaceExist
 
 	do
 	{
-		void *key = USERGROUP_TO_KEY( item, hash->fKeyOffset );
-		if ( hash->fHashType == eKerberosHash || hash->fHashType == eX509DNHash ) {
-			// if this is a kerberos hash or X509 hash, then it is really an array
-			key = ((void **) key)[iIndex];
-			if ( key == NULL ) {
-				goto bail;
-			}
-		} else if (hash->fHashType == eNameHash) {
-			key = ((void **)key)[0];
+		// if this is a kerberos hash or X509 hash, then it is really an array
+		const void *key = __HashTable_KeyForItem( hash, item, iIndex );
+		if ( key == NULL ) {
+			goto bail;
 		}
-
 		
+		uint32_t keyHash = __HashTable_HashKey( hash, key );
 		bool bBuiltin = __IsBuiltinGroup( item );
-		struct rb_node *node = rb_tree_find_node( &hash->fRBtree, key );
-		if ( node != NULL )
+		long slotIndex = __HashTable_FindSlot( hash, key, keyHash );
+		if ( slotIndex != -1 )
 		{
-			UserGroup *entry = RBNODE_TO_USERGROUP( node );
+			UserGroup *entry = hash->fSlots[slotIndex].ug;
 			
 			// if entry is in hash, nothing to do
 			if ( entry == item ) goto bail;
@@ -312,11 +374,11 @@ static bool __HashTable_Add( HashTable* hash, UserGroup* item, bool replaceExist
 				}
 				
 				if ( forceReplace == true ) {
-					DbgLog( kLogInfo, "mbr_mig - Membership - RBtree add - builtin group ID (forcing replace because it is local)" );
+					DbgLog( kLogInfo, "mbr_mig - Membership - Hash add - builtin group ID (forcing replace because it is local)" );
 					replaceExisting = true;
 				}
 				else {
-					DbgLog( kLogInfo, "mbr_mig - Membership - RBtree add - builtin group ID (not allowing replacement of existing entry)" );
+					DbgLog( kLogInfo, "mbr_mig - Membership - Hash add - builtin group ID (not allowing replacement of existing entry)" );
 					goto bail;
 				}
 			}
@@ -328,12 +390,11 @@ static bool __HashTable_Add( HashTable* hash, UserGroup* item, bool replaceExist
 			
 			if ( replaceExisting == true )
 			{
-				DbgLog( kLogDebug, "mbr_mig - Membership - RBtree add - %s - replacing existing entry %s (%X) - node %X", 
-						hash->fName ?: "", entry->fName ?: "", entry, node );
+				DbgLog( kLogDebug, "mbr_mig - Membership - Hash add - %s - replacing existing entry %s (%X) - slot %ld", 
+						hash->fName ?: "", entry->fName ?: "", entry, slotIndex );
 				
-				rb_tree_remove_node( &hash->fRBtree, node );
-				DSFree( node );
-				hash->fNumEntries--;
+				__HashTable_RemoveSlot( hash, slotIndex );
+				slotIndex = -1;
 				
 				// release it if owner and entry are not the same (don't self release)
 				if ( entry != hash->fOwner ) {
@@ -364,26 +425,18 @@ static bool __HashTable_Add( HashTable* hash, UserGroup* item, bool replaceExist
 			}
 		}
 		
-		struct ug_rb_node *ugnode = (struct ug_rb_node *) calloc( 1, sizeof(struct ug_rb_node) );
-		assert( ugnode != NULL );
-		
-		ugnode->ug = item;
-		ugnode->index = iIndex;
-		if ( rb_tree_insert_node(&hash->fRBtree, (struct rb_node *) ugnode) == true ) {
+		// an existing entry that was not replaced means we can't add this key
+		if ( slotIndex == -1 ) {
+			__HashTable_InsertSlot( hash, item, iIndex, keyHash );
 			
 			// retain it if owner and item are not the same (don't self retain)
 			if ( item != hash->fOwner ) {
 				(void) UserGroup_Retain( item );
 			}
-			hash->fNumEntries++;
-			DbgLog( kLogDebug, "mbr_mig - Membership - RBtree add - %s - adding entry %s (%X) - node %X", 
-					hash->fName, item->fName ? : "", item, ugnode );
+			DbgLog( kLogDebug, "mbr_mig - Membership - Hash add - %s - adding entry %s (%X)", 
+					hash->fName, item->fName ? : "", item );
 			bSuccess = true;
 		}
-		else {
-			// free the node if we didn't add it, should never happen since we searched beforehand, but safety
-			DSFree( ugnode );
-		}
 		
 		if ( bSuccess == true && 
 			 (hash->fHashType == eKerberosHash || hash->fHashType == eX509DNHash) && 
@@ -416,31 +469,6 @@ HashTable* HashTable_Create( const char *name, void *owner, eHashType hashType )
 
 void HashTable_Initialize( HashTable *hash, const char *name, void *owner, eHashType hashType )
 {
-	static const struct rb_tree_ops id_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_id_nodes,
-		.rbto_compare_key   = rbt_compare_id_key
-	};
-	static const struct rb_tree_ops guid_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_guid_nodes,
-		.rbto_compare_key   = rbt_compare_guid_key
-	};
-	static const struct rb_tree_ops sid_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_sid_nodes,
-		.rbto_compare_key   = rbt_compare_sid_key
-	};
-	static const struct rb_tree_ops name_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_name_nodes,
-		.rbto_compare_key   = rbt_compare_name_key
-	};
-	static const struct rb_tree_ops kerberos_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_kerberos_nodes,
-		.rbto_compare_key   = rbt_compare_kerberos_key
-	};
-	static const struct rb_tree_ops x509dn_rbt_ops = {
-		.rbto_compare_nodes = rbt_compare_x509dn_nodes,
-		.rbto_compare_key   = rbt_compare_x509dn_key
-	};
-	
 	bzero( hash, sizeof(HashTable) );
 	
 	hash->fRefCount = INT32_MAX;
@@ -449,35 +477,33 @@ void HashTable_Initialize( HashTable *hash, const char *name, void *owner, eHash
 	hash->fQueue = dispatch_queue_create( hash->fName, NULL );
 	hash->fHashType = hashType;
 	
+	// lookups are far more common than changes, so readers run concurrently and writers use barriers
+	dispatch_queue_set_width( hash->fQueue, LONG_MAX );
+	
+	// slots are allocated on first add since most membership hashes stay small or empty
 	switch( hashType )
 	{
 		case eIDHash:
-			rb_tree_init( &hash->fRBtree, &id_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fID);
 			break;
 			
 		case eGUIDHash:
-			rb_tree_init( &hash->fRBtree, &guid_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fGUID);
 			break;
 			
 		case eSIDHash:
-			rb_tree_init( &hash->fRBtree, &sid_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fSID);
 			break;
 			
 		case eNameHash:
-			rb_tree_init( &hash->fRBtree, &name_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fName);
 			break;
 			
 		case eKerberosHash:
-			rb_tree_init( &hash->fRBtree, &kerberos_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fKerberos);
 			break;
 			
 		case eX509DNHash:
-			rb_tree_init( &hash->fRBtree, &x509dn_rbt_ops );
 			hash->fKeyOffset = __offsetof(struct UserGroup, fX509DN);
 			break;
 	}
@@ -501,30 +527,28 @@ void HashTable_FreeContents( HashTable *hash )
 
 void HashTable_Reset( HashTable* hash )
 {
-	dispatch_sync( hash->fQueue, 
+	dispatch_barrier_sync( hash->fQueue, 
 				   ^(void) {
-					   struct rb_tree *tree = &hash->fRBtree;
-					   struct rb_node *node = RB_TREE_MIN( tree );
-						
-					   // we have to delete after we iterate forward
-					   while ( node != NULL ) {
-						   struct rb_node	*delNode	= node;
-						   struct UserGroup *entry		= RBNODE_TO_USERGROUP( delNode );
-							
-						   node = rb_tree_iterate( tree, node, RB_DIR_RIGHT );
-
-						   // now let's remove the node
-						   rb_tree_remove_node( tree, delNode );
-						   DSFree( delNode );
+					   struct HashSlot	*slots		= hash->fSlots;
+					   long				numSlots	= hash->fNumSlots;
+					   long				ii;
+					   
+					   // detach the slots first so releases can't see a partially cleared table
+					   hash->fSlots = NULL;
+					   hash->fNumSlots = 0;
+					   hash->fNumEntries = 0;
+					   
+					   for ( ii = 0; ii < numSlots; ii++ ) {
+						   struct UserGroup *entry = slots[ii].ug;
 						   
 						   // release it if owner and entry are not the same (don't self release)
-						   if ( entry != hash->fOwner ) {
+						   if ( entry != NULL && entry != hash->fOwner ) {
 							   UserGroup_Release( entry );
 							   entry = NULL;
 						   }
-					   };
-						
-					   hash->fNumEntries = 0;
+					   }
+					   
+					   DSFree( slots );
 				   } );
 }
 
@@ -532,28 +556,29 @@ int HashTable_ResetMemberships( HashTable *hash )
 {
 	__block int offlineCount = 0;
 	
-	dispatch_sync( hash->fQueue, 
+	dispatch_barrier_sync( hash->fQueue, 
 				   ^(void) {
 					   if ( hash->fNumEntries > 0 )
 					   {
-						   struct rb_tree *tree = &hash->fRBtree;
-						   struct rb_node *node = RB_TREE_MIN( tree );
+						   struct HashSlot	*slots		= hash->fSlots;
+						   long				numSlots	= hash->fNumSlots;
+						   long				ii;
 						   
-						   while ( node != NULL ) {
-							   struct rb_node	*delNode	= node;
-							   struct UserGroup *entry		= RBNODE_TO_USERGROUP( delNode );
+						   // removing in place would shift entries under the iterator, so rebuild with the offline entries
+						   hash->fSlots = (struct HashSlot *) calloc( numSlots, sizeof(struct HashSlot) );
+						   assert( hash->fSlots != NULL );
+						   hash->fNumEntries = 0;
+						   
+						   for ( ii = 0; ii < numSlots; ii++ ) {
+							   struct UserGroup *entry = slots[ii].ug;
 							   
-							   // we have to delete after we iterate forward
-							   node = rb_tree_iterate( tree, node, RB_DIR_RIGHT );
-
-							   // check the node to be deleted
+							   if ( entry == NULL ) {
+								   continue;
+							   }
+							   
+							   // check the entry to be deleted
 							   if ( entry->fNode == NULL || entry->fNodeAvailable == true ) {
 								   
-								   // safe to remove
-								   rb_tree_remove_node( tree, delNode );
-								   DSFree( delNode );
-								   hash->fNumEntries--;
-								   
 								   // release it if owner and entry are not the same (don't self release)
 								   if ( entry != hash->fOwner ) {
 									   UserGroup_Release( entry );
@@ -561,11 +586,16 @@ int HashTable_ResetMemberships( HashTable *hash )
 								   }
 							   }
 							   else {
+								   __HashTable_PlaceSlot( hash->fSlots, numSlots, &slots[ii] );
+								   hash->fNumEntries++;
+								   
 								   offlineCount++;
-								   DbgLog( kLogInfo, "mbr_mig - Membership - RBtree membership reset - %s - %s (%d) - node %s - offline", 
+								   DbgLog( kLogInfo, "mbr_mig - Membership - Hash membership reset - %s - %s (%d) - node %s - offline", 
 										   hash->fName, entry->fName ? :"", entry->fID, entry->fNode ? : "no node" );
 							   }
-						   };
+						   }
+						   
+						   DSFree( slots );
 					   }
 				    } );
 	
@@ -578,7 +608,7 @@ bool HashTable_Add( HashTable* hash, UserGroup* item, bool replaceExisting )
 	
 	__block bool bSuccess;
 	
-	dispatch_sync( hash->fQueue, 
+	dispatch_barrier_sync( hash->fQueue, 
 				   ^(void) {
 					   bSuccess = __HashTable_Add( hash, item, replaceExisting );
 				   } );
@@ -590,13 +620,15 @@ UserGroup* HashTable_GetAndRetain( HashTable* hash, const void* data )
 {
 	__block UserGroup	*entry	= NULL;
 	
-	if ( hash == NULL ) return NULL;
+	if ( hash == NULL || data == NULL ) return NULL;
+	
+	uint32_t keyHash = __HashTable_HashKey( hash, data );
 	
 	dispatch_sync( hash->fQueue,
 				   ^(void) {
-					   struct rb_node *node = rb_tree_find_node( &hash->fRBtree, data );
-					   if ( node != NULL ) {
-						   entry = UserGroup_Retain( RBNODE_TO_USERGROUP(node) );
+					   long slotIndex = __HashTable_FindSlot( hash, data, keyHash );
+					   if ( slotIndex != -1 ) {
+						   entry = UserGroup_Retain( hash->fSlots[slotIndex].ug );
 					   }
 				   } );
 
@@ -607,33 +639,31 @@ void HashTable_Remove( HashTable* hash, UserGroup* item )
 {
 	if ( hash == NULL ) return;
 	
-	dispatch_sync( hash->fQueue,
+	assert( hash->fHashType != eKerberosHash );
+	assert( hash->fHashType != eX509DNHash );
+	
+	const void *key = __HashTable_KeyForItem( hash, item, 0 );
+	if ( key == NULL ) return;
+	
+	uint32_t keyHash = __HashTable_HashKey( hash, key );
+	
+	dispatch_barrier_sync( hash->fQueue,
 				   ^(void) {
-					   void *key = USERGROUP_TO_KEY(item, hash->fKeyOffset);
-					   if (hash->fHashType == eNameHash) {
-						   key = ((void **)key)[0];
-					   } else {
-						   assert(hash->fHashType != eKerberosHash);
-						   assert(hash->fHashType != eX509DNHash);
-					   }
-
-					   struct rb_node *node = rb_tree_find_node( &hash->fRBtree, key );
-					   if ( node != NULL ) {
-						   UserGroup *tempItem = RBNODE_TO_USERGROUP( node );
+					   long slotIndex = __HashTable_FindSlot( hash, key, keyHash );
+					   if ( slotIndex != -1 ) {
+						   UserGroup *tempItem = hash->fSlots[slotIndex].ug;
 						
 						   // we only remove the exact entry because there could be conflicted authoritative entries
 						   if ( tempItem == item ) {
 							   
 							   // safe to remove
-							   rb_tree_remove_node( &hash->fRBtree, node );
-							   DSFree( node );
+							   __HashTable_RemoveSlot( hash, slotIndex );
 							   
 							   // release it if owner and entry are not the same (don't self release)
 							   if ( tempItem != hash->fOwner ) {
 								   UserGroup_Release( tempItem );
 								   tempItem = NULL;
 							   }
-							   hash->fNumEntries--;
 						   }
 					   }
 				   } );
@@ -646,10 +676,10 @@ void HashTable_Merge( HashTable* destination, HashTable* source )
 	int count = HashTable_CreateItemArray( source, &tempArray );
 	if ( count > 0 )
 	{
-		DbgLog( kLogInfo, "mbr_mig - Membership - RBtree merge - %s - merging %X into %s (%X)", 
+		DbgLog( kLogInfo, "mbr_mig - Membership - Hash merge - %s - merging %X into %s (%X)", 
 			    destination->fName, source, destination->fName, destination );
 		
-		dispatch_sync( destination->fQueue,
+		dispatch_barrier_sync( destination->fQueue,
 					   ^(void) {
 						   int i;
 							
@@ -680,11 +710,14 @@ int HashTable_CreateItemArray( HashTable *hash, UserGroup*** itemArray )
 						   (*itemArray) = tempArray = (UserGroup **) calloc( numEntries, sizeof(UserGroup *) );
 						   assert( tempArray != NULL );
 						   
-						   struct rb_node *node;
-						   struct rb_tree *rbtree = &hash->fRBtree;
+						   long ii;
 						   
-						   RB_TREE_FOREACH( node, rbtree ) {
-							   struct UserGroup *ug = RBNODE_TO_USERGROUP( node );
+						   for ( ii = 0; ii < hash->fNumSlots; ii++ ) {
+							   struct UserGroup *ug = hash->fSlots[ii].ug;
+							   if ( ug == NULL ) {
+								   continue;
+							   }
+							   
 							   tempArray[numResults++] = UserGroup_Retain( ug );
 							   
 							   // this should never happen, but a safety
@@ -28,7 +28,6 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <dispatch/dispatch.h>
-#include "rb.h"
 
 typedef enum eHashType
 {
@@ -40,12 +39,15 @@ typedef enum eHashType
 	eX509DNHash		= 6
 } eHashType;
 
+struct HashSlot;
+
 typedef struct HashTable
 {
 	volatile int32_t	fRefCount;
 	
 	dispatch_queue_t	fQueue;
-	struct rb_tree		fRBtree;
+	struct HashSlot *	fSlots;		// open addressed, power of 2 sized
+	long				fNumSlots;
 	uint32_t			fHashType;
 	long				fKeyOffset;
 	long				fNumEntries;
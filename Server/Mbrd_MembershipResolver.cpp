@@ -37,6 +37,7 @@
 #include <uuid/uuid.h>
 #include <DirectoryServiceCore/CLog.h>
 #include <DirectoryServiceCore/DSMutexSemaphore.h>
+#include <DirectoryServiceCore/DSUtils.h>
 #include <DirectoryService/DirectoryService.h>
 #include <DirectoryService/DirServicesConstPriv.h>
 #include <assert.h>
@@ -127,6 +128,22 @@ static pthread_mutex_t			sidMapLock = PTHREAD_MUTEX_INITIALIZER;	// waiting for
 static dispatch_queue_t			gLookupQueue = NULL;
 static pthread_key_t			gMembershipThreadKey = NULL;
 
+// identical membership searches issued by concurrent resolutions share one in-flight search
+// and the number of searches issued to the search node at once is bounded
+#define kMaxConcurrentMembershipSearches	8
+
+struct sInflightSearch
+{
+	int32_t				fRefCount;	// protected by gInflightSearchLock
+	dispatch_group_t	fGroup;
+	UserGroup			**fItems;
+	UInt32				fCount;
+};
+
+static map<string, sInflightSearch *>	gInflightSearches;
+static pthread_mutex_t					gInflightSearchLock = PTHREAD_MUTEX_INITIALIZER;
+static dispatch_semaphore_t				gMembershipSearchSemaphore = NULL;
+
 #ifndef DISABLE_CACHE_PLUGIN
 extern CCachePlugin				*gCacheNode;
 
@@ -802,8 +819,10 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 				status = dsGetRecordTypeFromEntry( recordEntryPtr, &recTypeStr );
 				if ( status == eDSNoErr )
 				{
+					SInt32 recTypeID = dsGetStdConstantID( recTypeStr );
+					
 					result = UserGroup_Create();
-					if ( strcmp(recTypeStr, kDSStdRecordTypeUsers) == 0 ) {
+					if ( recTypeID == kDSStdID_kDSStdRecordTypeUsers ) {
 #ifndef DISABLE_CACHE_PLUGIN
 						const char	*keys[] = { "pw_name", "pw_uid", "pw_gecos", NULL }; // "pw_uuid"
 						sCacheValidation *valid;
@@ -817,10 +836,10 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 						}
 #endif
 					}
-					else if ( strcmp(recTypeStr, kDSStdRecordTypeComputers) == 0 ) {
+					else if ( recTypeID == kDSStdID_kDSStdRecordTypeComputers ) {
 						result->fRecordType = kUGRecordTypeComputer;
 					}
-					else if ( strcmp(recTypeStr, kDSStdRecordTypeComputerGroups) == 0 ) {
+					else if ( recTypeID == kDSStdID_kDSStdRecordTypeComputerGroups ) {
 						result->fRecordType = kUGRecordTypeComputerGroup;
 					}
 					else {
@@ -862,9 +881,10 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 						status = dsGetAttributeValue(dirNode, searchBuffer, 1, attributeValueListRef, &attrValue);	
 						if (status == eDSNoErr)
 						{
-							// TODO: need to make this more efficient instead of scanning each one
+							// one hash lookup per attribute instead of a strcmp per branch
 							char* attrName = attributeInfo->fAttributeSignature.fBufferData;
-							if (strcmp(attrName, kDSNAttrRecordName) == 0)
+							SInt32 attrID = dsGetStdConstantID( attrName );
+							if (attrID == kDSStdID_kDSNAttrRecordName)
 							{
 								result->fName = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																	  attrValue->fAttributeValueData.fBufferLength );
@@ -918,24 +938,24 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 									break;
 								} while ( 1 );
 							}
-							else if (strcmp(attrName, kDS1AttrGeneratedUID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrGeneratedUID)
 							{
 								if ( attrValue->fAttributeValueData.fBufferLength >= sizeof(uuid_t) ) {
 									uuid_parse( attrValue->fAttributeValueData.fBufferData, result->fGUID );
 									result->fFlags |= kUGFlagHasGUID;
 								}
 							}
-							else if (strcmp(attrName, kDS1AttrSMBRID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrSMBRID)
 							{
 								smbRID = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 															   attrValue->fAttributeValueData.fBufferLength );
 							}
-							else if (strcmp(attrName, kDS1AttrSMBGroupRID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrSMBGroupRID)
 							{
 								smbGroupRID = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																    attrValue->fAttributeValueData.fBufferLength );
 							}
-							else if (strcmp(attrName, kDS1AttrSMBSID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrSMBSID)
 							{					 
 								char *temp = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																   attrValue->fAttributeValueData.fBufferLength );
@@ -944,7 +964,7 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 								}
 								DSFree( temp );
 							}
-							else if (strcmp(attrName, kDS1AttrUniqueID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrUniqueID)
 							{					 
 								char *temp = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																   attrValue->fAttributeValueData.fBufferLength );
@@ -957,7 +977,7 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 								
 								DSFree( temp );
 							}
-							else if (strcmp(attrName, kDS1AttrTimeToLive) == 0)
+							else if (attrID == kDSStdID_kDS1AttrTimeToLive)
 							{
 								int multiplier = 1;
 								char* endPtr = NULL; 
@@ -984,7 +1004,7 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 								
 								result->fExpiration = GetElapsedSeconds() + num * multiplier;
 							}
-							else if (strcmp(attrName, kDS1AttrPrimaryGroupID) == 0)
+							else if (attrID == kDSStdID_kDS1AttrPrimaryGroupID)
 							{					 
 								char *temp = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																   attrValue->fAttributeValueData.fBufferLength );
@@ -1003,7 +1023,7 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 								
 								DSFree( temp );
 							}
-							else if ( strcmp(attrName, kDSNAttrMetaNodeLocation) == 0 )
+							else if ( attrID == kDSStdID_kDSNAttrMetaNodeLocation )
 							{
 								char *temp = result->fNode = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																				   attrValue->fAttributeValueData.fBufferLength );
@@ -1019,21 +1039,21 @@ UserGroup **Mbrd_FindItemsAndRetain( tDirNodeReference dirNode, tDataListPtr rec
 								
 								temp = NULL; // don't free because fNode is owned
 							}
-							else if ( strcmp(attrName, kDS1AttrCopyTimestamp) == 0 && attrValue->fAttributeValueData.fBufferLength > 0 )
+							else if ( attrID == kDSStdID_kDS1AttrCopyTimestamp && attrValue->fAttributeValueData.fBufferLength > 0 )
 							{
 								// if the account has a copyTimeStamp it is not local so we flag it as remote
 								result->fFlags &= ~kUGFlagLocalAccount;
 								bWasSetByCopyTimestamp = true; // save this because attr order is not guaranteed
 							}
-							else if ( strcmp(attrName, kDS1AttrSMBPrimaryGroupSID) == 0 ) {
+							else if ( attrID == kDSStdID_kDS1AttrSMBPrimaryGroupSID ) {
 								smbPrimaryGroupSID = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																		   attrValue->fAttributeValueData.fBufferLength );
 							}
-							else if ( strcmp(attrName, kDS1AttrOriginalNodeName) == 0 ) {
+							else if ( attrID == kDSStdID_kDS1AttrOriginalNodeName ) {
 								origHome = dsCStrFromCharacters( attrValue->fAttributeValueData.fBufferData,
 																 attrValue->fAttributeValueData.fBufferLength );
 							}
-							else if ( strcmp(attrName, kDSNAttrKeywords) == 0 ) {
+							else if ( attrID == kDSStdID_kDSNAttrKeywords ) {
 								UInt32 index = 1;
 								do {
 									if ( strcmp(attrValue->fAttributeValueData.fBufferData, "com.apple.ServiceAccount") == 0 ) {
@@ -1587,6 +1607,90 @@ static UserGroup* Mbrd_GetItemWithIdentifierAndRetain( MbrdCache *cache, int idT
 	return item;
 }
 
+static void Mbrd_ReleaseInflightSearch( sInflightSearch *search )
+{
+	pthread_mutex_lock( &gInflightSearchLock );
+	bool bFree = (--search->fRefCount == 0);
+	pthread_mutex_unlock( &gInflightSearchLock );
+	
+	if ( bFree == true ) {
+		for ( UInt32 ii = 0; ii < search->fCount; ii++ ) {
+			UserGroup_Release( search->fItems[ii] );
+			search->fItems[ii] = NULL;
+		}
+		
+		DSFree( search->fItems );
+		dispatch_release( search->fGroup );
+		delete search;
+	}
+}
+
+static UserGroup **Mbrd_FindGroupsAndRetainShared( int idType, const char *value, uint32_t flags, UInt32 *recCount )
+{
+	sInflightSearch	*search		= NULL;
+	bool			bLeader		= false;
+	char			*keyStr		= NULL;
+	
+	asprintf( &keyStr, "%d:%u:%s", idType, flags, value );
+	string key( keyStr );
+	free( keyStr );
+	
+	pthread_mutex_lock( &gInflightSearchLock );
+	
+	map<string, sInflightSearch *>::iterator iter = gInflightSearches.find( key );
+	if ( iter != gInflightSearches.end() ) {
+		search = iter->second;
+		search->fRefCount++;
+	}
+	else {
+		search = new sInflightSearch;
+		search->fRefCount = 1;
+		search->fGroup = dispatch_group_create();
+		search->fItems = NULL;
+		search->fCount = 0;
+		
+		dispatch_group_enter( search->fGroup );
+		gInflightSearches[key] = search;
+		bLeader = true;
+	}
+	
+	pthread_mutex_unlock( &gInflightSearchLock );
+	
+	if ( bLeader == true ) {
+		// the slot is only held for the search itself, never while waiting on nested resolutions
+		dispatch_semaphore_wait( gMembershipSearchSemaphore, DISPATCH_TIME_FOREVER );
+		search->fItems = Mbrd_FindItemsAndRetain( gMbrdSearchNode, gAllGroupTypes, idType, value, flags, &search->fCount );
+		dispatch_semaphore_signal( gMembershipSearchSemaphore );
+		
+		pthread_mutex_lock( &gInflightSearchLock );
+		gInflightSearches.erase( key );
+		pthread_mutex_unlock( &gInflightSearchLock );
+		
+		dispatch_group_leave( search->fGroup );
+	}
+	else {
+		DbgLog( kLogDebug, "Membership - Resolve Groups - joining in-flight search for '%s'", value );
+		dispatch_group_wait( search->fGroup, DISPATCH_TIME_FOREVER );
+	}
+	
+	// every caller gets its own retained copy of the results
+	UserGroup **results = NULL;
+	
+	(*recCount) = search->fCount;
+	if ( search->fItems != NULL ) {
+		results = (UserGroup **) calloc( (search->fCount > 0 ? search->fCount : 1), sizeof(UserGroup *) );
+		assert( results != NULL );
+		
+		for ( UInt32 ii = 0; ii < search->fCount; ii++ ) {
+			results[ii] = UserGroup_Retain( search->fItems[ii] );
+		}
+	}
+	
+	Mbrd_ReleaseInflightSearch( search );
+	
+	return results;
+}
+
 static void Mbrd_ResolveGroupsForItem( UserGroup *item, uint32_t flags, UserGroup *membershipRoot = NULL )
 {
 	UserGroup **items;
@@ -1663,7 +1767,7 @@ static void Mbrd_ResolveGroupsForItem( UserGroup *item, uint32_t flags, UserGrou
 			}
 			
 			count = 0;
-			items = Mbrd_FindItemsAndRetain( gMbrdSearchNode, gAllGroupTypes, ID_TYPE_GROUPMEMBERSHIP, item->fName, flags, &count );
+			items = Mbrd_FindGroupsAndRetainShared( ID_TYPE_GROUPMEMBERSHIP, item->fName, flags, &count );
 			if ( items != NULL )
 			{
 				DbgLog( kLogInfo, "%s - Membership - Resolve Groups - adding %d direct name memberships via GUID to membership for '%s'", 
@@ -1721,7 +1825,7 @@ static void Mbrd_ResolveGroupsForItem( UserGroup *item, uint32_t flags, UserGrou
 		}
 
 		count = 0;
-		items = Mbrd_FindItemsAndRetain( gMbrdSearchNode, gAllGroupTypes, ID_TYPE_GROUPMEMBERS, guidString, flags, &count );
+		items = Mbrd_FindGroupsAndRetainShared( ID_TYPE_GROUPMEMBERS, guidString, flags, &count );
 		if ( items != NULL )
 		{
 			DbgLog( kLogInfo, "%s - Membership - Resolve Groups - adding %d direct UUID memberships to membership for '%s'", 
@@ -1742,7 +1846,7 @@ static void Mbrd_ResolveGroupsForItem( UserGroup *item, uint32_t flags, UserGrou
 	}
 	else if ( membershipRoot != NULL )
 	{
-		items = Mbrd_FindItemsAndRetain( gMbrdSearchNode, gAllGroupTypes, ID_TYPE_NESTEDGROUPS, guidString, flags, &count );
+		items = Mbrd_FindGroupsAndRetainShared( ID_TYPE_NESTEDGROUPS, guidString, flags, &count );
 		if ( items != NULL )
 		{
 			DbgLog( kLogInfo, "%s - Membership - Resolve Groups - adding %d nested groups to membership for '%s'", 
@@ -2111,6 +2215,7 @@ initialize:
 	assert( gMbrdCache != NULL );
 	
 	gLookupQueue = dispatch_queue_create( "Membership lookup queue", NULL );
+	gMembershipSearchSemaphore = dispatch_semaphore_create( kMaxConcurrentMembershipSearches );
 	pthread_key_create( &gMembershipThreadKey, NULL ); // no cleanup needed, just a flag
 
 	uuid_parse( "ABCDEFAB-CDEF-ABCD-EFAB-CDEF0000000C", gEveryoneUUID );
@@ -109,6 +109,31 @@ void UserGroup_Initialize( UserGroup *source )
 	HashTable_Initialize( &source->fGIDMembershipHash, "GID", source, eIDHash );
 }
 
+// must be called with fHashLock held
+static void UserGroup_InvalidateGIDList( UserGroup *ug )
+{
+	if ( ug->fGIDList != NULL ) {
+		UserGroupGIDList_Release( ug->fGIDList );
+		ug->fGIDList = NULL;
+	}
+}
+
+static int UserGroup_CompareGIDs( const void *a, const void *b )
+{
+	gid_t gid1 = *((const gid_t *) a);
+	gid_t gid2 = *((const gid_t *) b);
+	
+	if ( gid1 < gid2 ) {
+		return -1;
+	}
+	
+	if ( gid1 > gid2 ) {
+		return 1;
+	}
+	
+	return 0;
+}
+
 void UserGroup_Release( UserGroup *source )
 {
 	if ( dsReleaseObject(source, &source->fRefCount, false) == true ) {
@@ -142,6 +167,11 @@ void UserGroup_Free( UserGroup *source )
 	HashTable_FreeContents( &source->fSIDMembershipHash );
 	HashTable_FreeContents( &source->fGIDMembershipHash );
 	
+	if ( source->fGIDList != NULL ) {
+		UserGroupGIDList_Release( source->fGIDList );
+		source->fGIDList = NULL;
+	}
+	
 	pthread_mutex_destroy( &source->fMutex );
 	pthread_mutex_destroy( &source->fHashLock );
 }
@@ -155,7 +185,13 @@ void UserGroup_Merge( UserGroup *existing, UserGroup *source, bool includeMember
 	existing->fMaximumRefresh = source->fMaximumRefresh;
 	uuid_copy( existing->fGUID, source->fGUID );
 	existing->fID = source->fID;
-	existing->fPrimaryGroup = source->fPrimaryGroup;
+	if ( existing->fPrimaryGroup != source->fPrimaryGroup ) {
+		// the cached list falls back to the primary group when there are no memberships
+		assert( pthread_mutex_lock(&existing->fHashLock) == 0 );
+		existing->fPrimaryGroup = source->fPrimaryGroup;
+		UserGroup_InvalidateGIDList( existing );
+		assert( pthread_mutex_unlock(&existing->fHashLock) == 0 );
+	}
 	// do not change fRefreshActive here cause it could cancel an inflight lookup
 	// since we can lookup the user at the same time
 	
@@ -226,6 +262,8 @@ void UserGroup_Merge( UserGroup *existing, UserGroup *source, bool includeMember
 		HashTable_Reset( &existing->fGIDMembershipHash );
 		HashTable_Merge( &existing->fGIDMembershipHash, &source->fGIDMembershipHash );
 		
+		UserGroup_InvalidateGIDList( existing );
+		
 		assert( pthread_mutex_unlock(&existing->fHashLock) == 0 );
 
 		existing->fFlags |= kUGFlagValidMembership;
@@ -244,8 +282,10 @@ bool UserGroup_AddToHashes( UserGroup *item, UserGroup *group )
 	{
 		if ( (group->fFlags & kUGFlagHasGUID) != 0 )
 			bSuccess = HashTable_Add( &item->fGUIDMembershipHash, group, false );
-		if ( (group->fFlags & kUGFlagHasID) != 0 )
-			bSuccess = (HashTable_Add(&item->fGIDMembershipHash, group, false) ? true : bSuccess);
+		if ( (group->fFlags & kUGFlagHasID) != 0 && HashTable_Add(&item->fGIDMembershipHash, group, false) == true ) {
+			UserGroup_InvalidateGIDList( item );
+			bSuccess = true;
+		}
 		if ( (group->fFlags & kUGFlagHasSID) != 0 )
 			bSuccess = (HashTable_Add(&item->fSIDMembershipHash, group, false) ? true : bSuccess);
 	}
@@ -266,6 +306,7 @@ int UserGroup_ResetMemberships( UserGroup *ug )
 	totalOffline += HashTable_ResetMemberships( &ug->fGUIDMembershipHash );
 	totalOffline += HashTable_ResetMemberships( &ug->fSIDMembershipHash );
 	totalOffline += HashTable_ResetMemberships( &ug->fGIDMembershipHash );
+	UserGroup_InvalidateGIDList( ug );
 	DbgLog( kLogInfo, "mbr_mig - Membership - User/Group - Reset Memberships for %s (%d) - %d offline memberships", ug->fName ? :"\"no name\"", 
 		    ug->fID, totalOffline );
 	assert( pthread_mutex_unlock(&ug->fHashLock) == 0 );
@@ -375,63 +416,98 @@ const char *UserGroup_GetFoundByString( UserGroup *user, char *buffer, size_t bu
 	return buffer;
 }
 
-int UserGroup_Get16Groups( UserGroup* user, gid_t* gidArray )
+void UserGroupGIDList_Release( UserGroupGIDList *list )
 {
-	gid_t *tempArray = NULL;
-	
-	int numGroups = UserGroup_GetGroups( user, &tempArray );
-	if ( numGroups > 16 ) numGroups = 16;
-	
-	if ( numGroups > 0 ) {
-		bcopy( tempArray, gidArray, numGroups * sizeof(gid_t) );
-		free( tempArray );
+	if ( dsReleaseObject(list, &list->fRefCount, false) == true ) {
+		free( list );
 	}
-	
-	return numGroups;
 }
 
-int UserGroup_GetGroups( UserGroup* user, gid_t** gidArray )
+UserGroupGIDList *UserGroup_CopyGIDList( UserGroup *user )
 {
-	UserGroup	**groupArray	= NULL;
-	gid_t		*itemArray		= NULL;
-	int			itemArrayCount	= 0;
-	int			i				= 0;
-	gid_t		pgid			= -1;
+	UserGroupGIDList	*list		= NULL;
+	UserGroup			**groupArray	= NULL;
+	
+	if ( user == NULL ) return NULL;
 	
-	if ( user == NULL || gidArray == NULL ) return 0;
+	assert( pthread_mutex_lock(&user->fHashLock) == 0 );
 	
-	int groupArrayCount = HashTable_CreateItemArray( &user->fGUIDMembershipHash, &groupArray );
-	if ( groupArrayCount > 0 )
+	// only rebuilt after the memberships changed
+	if ( user->fGIDList == NULL )
 	{
-		(*gidArray) = itemArray = (gid_t *) calloc( groupArrayCount, sizeof(gid_t) );
-		assert( itemArray != NULL );
+		int groupArrayCount = HashTable_CreateItemArray( &user->fGIDMembershipHash, &groupArray );
+		
+		// safety if no groups, always return PGID
+		int allocCount = (groupArrayCount > 0 ? groupArrayCount : 1);
+		
+		list = (UserGroupGIDList *) calloc( 1, sizeof(UserGroupGIDList) + allocCount * sizeof(gid_t) );
+		assert( list != NULL );
 		
-		for ( i = 0; i < groupArrayCount; i++ )
+		list->fRefCount = 1;
+		list->fGIDs = (gid_t *) (list + 1);
+		
+		if ( groupArrayCount > 0 )
 		{
-			gid_t tempGID = groupArray[i]->fID;
-			if ( tempGID != pgid ) {
-				itemArray[itemArrayCount++] = tempGID;
+			for ( int ii = 0; ii < groupArrayCount; ii++ )
+			{
+				// the GID hash already guarantees these are unique
+				list->fGIDs[list->fCount++] = groupArray[ii]->fID;
+				
+				UserGroup_Release( groupArray[ii] );
+				groupArray[ii] = NULL;
 			}
 			
-			UserGroup_Release( groupArray[i] );
-			groupArray[i] = NULL;
-		}
-		
-		if ( groupArray != NULL ) {
 			free( groupArray );
 			groupArray = NULL;
+			
+			qsort( list->fGIDs, list->fCount, sizeof(gid_t), UserGroup_CompareGIDs );
 		}
+		else
+		{
+			list->fGIDs[0] = user->fPrimaryGroup;
+			list->fCount = 1;
+		}
+		
+		user->fGIDList = list;
 	}
-	else {
-		// safety if no groups, always return PGID
-		(*gidArray) = itemArray = (gid_t *) calloc( 1, sizeof(gid_t) );
-		assert( itemArray != NULL );
+	
+	list = UserGroupGIDList_Retain( user->fGIDList );
+	
+	assert( pthread_mutex_unlock(&user->fHashLock) == 0 );
+	
+	return list;
+}
 
-		itemArray[0] = user->fPrimaryGroup;
-		itemArrayCount = 1;
-	}
+int UserGroup_Get16Groups( UserGroup* user, gid_t* gidArray )
+{
+	UserGroupGIDList *list = UserGroup_CopyGIDList( user );
+	if ( list == NULL ) return 0;
+	
+	int numGroups = list->fCount;
+	if ( numGroups > 16 ) numGroups = 16;
+	
+	bcopy( list->fGIDs, gidArray, numGroups * sizeof(gid_t) );
+	UserGroupGIDList_Release( list );
 	
-	return itemArrayCount;
+	return numGroups;
+}
+
+int UserGroup_GetGroups( UserGroup* user, gid_t** gidArray )
+{
+	if ( gidArray == NULL ) return 0;
+	
+	UserGroupGIDList *list = UserGroup_CopyGIDList( user );
+	if ( list == NULL ) return 0;
+	
+	int numGroups = list->fCount;
+	
+	(*gidArray) = (gid_t *) malloc( numGroups * sizeof(gid_t) );
+	assert( (*gidArray) != NULL );
+	
+	bcopy( list->fGIDs, (*gidArray), numGroups * sizeof(gid_t) );
+	UserGroupGIDList_Release( list );
+	
+	return numGroups;
 }
 
 #endif // DISABLE_SEARCH_PLUGIN
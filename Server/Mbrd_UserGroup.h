@@ -86,6 +86,14 @@ enum
 
 #define kMaxAltIdentities	5
 
+// immutable once built, shared by reference until the memberships change
+typedef struct UserGroupGIDList
+{
+	volatile int32_t	fRefCount;
+	int					fCount;
+	gid_t				*fGIDs;		// sorted and unique
+} UserGroupGIDList;
+
 typedef struct UserGroup
 {
 	int32_t				fMagic;
@@ -94,6 +102,11 @@ typedef struct UserGroup
 	pthread_mutex_t		fMutex;
 	struct UserGroup*   fLink;		// owned by the Mbrd_Cache
 	struct UserGroup*   fBackLink;
+	struct UserGroup*   fExpiryLink;	// owned by the Mbrd_Cache expiry buckets
+	struct UserGroup*   fExpiryBackLink;
+	uint32_t			fExpiryBucket;
+	bool				fExpiryScheduled;
+	uint32_t			fGeneration;	// cache generation the entry was last validated against
 	uint32_t			fExpiration;
 	uint32_t			fMaximumRefresh;
 	uuid_t				fGUID;
@@ -121,6 +134,7 @@ typedef struct UserGroup
 	struct HashTable	fGUIDMembershipHash;
 	struct HashTable	fSIDMembershipHash;
 	struct HashTable	fGIDMembershipHash;
+	UserGroupGIDList	*fGIDList;	// built from fGIDMembershipHash on demand, protected by fHashLock
 } UserGroup;
 
 __BEGIN_DECLS
@@ -138,6 +152,10 @@ int UserGroup_ResetMemberships( UserGroup *ug );
 int UserGroup_Get16Groups( UserGroup* user, gid_t* gidArray );
 int UserGroup_GetGroups( UserGroup* user, gid_t** gidArray );
 
+UserGroupGIDList *UserGroup_CopyGIDList( UserGroup *user );
+#define UserGroupGIDList_Retain(a)	((UserGroupGIDList *) dsRetainObject(a, &a->fRefCount))
+void UserGroupGIDList_Release( UserGroupGIDList *list );
+
 const char *UserGroup_GetRecordTypeString( UserGroup *user );
 const char *UserGroup_GetFoundByString( UserGroup *user, char *buffer, size_t bufferLen );
 
@@ -58,6 +58,8 @@
 
 #include <mach/mach.h>
 #include <mach/notify.h>
+#include <pthread.h>
+#include <math.h>
 #include <sys/stat.h>							//used for mkdir and stat
 #include <IOKit/pwr_mgt/IOPMLib.h>				//required for power management handling
 #include <syslog.h>								// for syslog()
@@ -109,6 +111,7 @@ extern DSEventSemaphore gKickCacheRequests;
 #endif
 extern dsBool			gDSLocalOnlyMode;
 extern dsBool			gDSInstallDaemonMode;
+extern dsBool			gDSConcurrentClientDispatch;
 
 // ---------------------------------------------------------------------------
 //	* Globals
@@ -396,6 +399,98 @@ dsdispatch_process_wentaway( pid_t inProc )
 #define MY_MIG_OPTIONS	(MACH_RCV_TIMEOUT | MACH_RCV_TRAILER_ELEMENTS(MACH_RCV_TRAILER_CTX) | \
                         MACH_RCV_TRAILER_TYPE(MACH_MSG_TRAILER_FORMAT_0))
 
+// ---------------------------------------------------------------------------
+//	* Reference chain locks
+//
+//		When per-client requests are dispatched concurrently, requests from one
+//		client against the same node reference (and the records and lists opened
+//		under it) must still run one at a time since plugins keep per-node state.
+//		Each client/chain pair gets its own lock that only lives while requests
+//		on it are in flight, so unrelated clients and chains never wait on each other.
+// ---------------------------------------------------------------------------
+
+struct sRefChainLock
+{
+	pthread_mutex_t		fMutex;
+	UInt32				fUsers;		// requests holding or waiting on fMutex
+};
+
+typedef pair<mach_port_t, UInt32>							tRefChainKey;
+typedef map<tRefChainKey, sRefChainLock *>					tRefChainLockMap;
+typedef map<tRefChainKey, sRefChainLock *>::iterator		tRefChainLockMapI;
+
+static tRefChainLockMap		gRefChainLocks;
+static pthread_mutex_t		gRefChainLocksMutex	= PTHREAD_MUTEX_INITIALIZER;	// only held to look up or retire an entry
+
+static UInt32
+GetRequestChainRef( sComData *inRequest )
+{
+	// most specific reference first, the chain is resolved through the ref table
+	static const UInt32 kChainRefTypes[] = { ktRecRef, ktAttrListRef, ktAttrValueListRef, ktNodeRef, ktDirRef };
+	UInt32	chainRef	= 0;
+	
+	for ( UInt32 ii = 0; ii < sizeof(kChainRefTypes) / sizeof(kChainRefTypes[0]) && chainRef == 0; ii++ ) {
+		for ( UInt32 jj = 0; jj < 10; jj++ ) {
+			if ( inRequest->obj[jj].type == kChainRefTypes[ii] && inRequest->obj[jj].count != 0 ) {
+				chainRef = inRequest->obj[jj].count;
+				break;
+			}
+		}
+	}
+	
+	// requests without a reference (open/close of the directory session, etc.) don't need ordering
+	if ( chainRef == 0 ) {
+		return 0;
+	}
+	
+	return gRefTable.GetChainRef( chainRef );
+} // GetRequestChainRef
+
+static sRefChainLock *
+AcquireRefChainLock( mach_port_t inPort, UInt32 inChainRef )
+{
+	tRefChainKey	key( inPort, inChainRef );
+	sRefChainLock	*chainLock	= NULL;
+	
+	pthread_mutex_lock( &gRefChainLocksMutex );
+	
+	tRefChainLockMapI iter = gRefChainLocks.find( key );
+	if ( iter != gRefChainLocks.end() ) {
+		chainLock = iter->second;
+	}
+	else {
+		chainLock = new sRefChainLock;
+		pthread_mutex_init( &chainLock->fMutex, NULL );
+		chainLock->fUsers = 0;
+		gRefChainLocks[key] = chainLock;
+	}
+	
+	chainLock->fUsers++;
+	
+	pthread_mutex_unlock( &gRefChainLocksMutex );
+	
+	pthread_mutex_lock( &chainLock->fMutex );
+	
+	return chainLock;
+} // AcquireRefChainLock
+
+static void
+ReleaseRefChainLock( mach_port_t inPort, UInt32 inChainRef, sRefChainLock *inChainLock )
+{
+	pthread_mutex_unlock( &inChainLock->fMutex );
+	
+	pthread_mutex_lock( &gRefChainLocksMutex );
+	
+	// last one out retires the entry so the map only holds chains with requests in flight
+	if ( (--inChainLock->fUsers) == 0 ) {
+		gRefChainLocks.erase( tRefChainKey(inPort, inChainRef) );
+		pthread_mutex_destroy( &inChainLock->fMutex );
+		delete inChainLock;
+	}
+	
+	pthread_mutex_unlock( &gRefChainLocksMutex );
+} // ReleaseRefChainLock
+
 static dispatch_source_t
 CreateDispatchSourceForMachPort( mach_port_t newServer, size_t maxSize, pid_t inPID, bool bPerClientPort )
 {
@@ -405,9 +500,15 @@ CreateDispatchSourceForMachPort( mach_port_t newServer, size_t maxSize, pid_t in
     if ( bPerClientPort == true ) {
         dispatch_group_t mig_group = dispatch_group_create();
 
-        // we use serial queues for per-client ports to ensure ordered requests
-        machQueue = dispatch_queue_create( "per-client MIG queue", NULL );
-        assert( machQueue != NULL );
+        // serial queues for per-client ports ensure ordered requests, in concurrent mode ordering
+        // is only kept per reference chain (see dsmig_do_api_call)
+        if ( gDSConcurrentClientDispatch == true ) {
+            machQueue = dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 );
+        }
+        else {
+            machQueue = dispatch_queue_create( "per-client MIG queue", NULL );
+            assert( machQueue != NULL );
+        }
         
         machSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MACH_RECV, newServer, 0, machQueue);
         assert( machSource != NULL );
@@ -440,7 +541,9 @@ CreateDispatchSourceForMachPort( mach_port_t newServer, size_t maxSize, pid_t in
         mach_port_request_notification( mach_task_self(), newServer, MACH_NOTIFY_NO_SENDERS, 1, newServer, 
                                         MACH_MSG_TYPE_MAKE_SEND_ONCE, &oldTargetOfNotification );
         
-        dispatch_release( machQueue );
+        if ( gDSConcurrentClientDispatch == false ) {
+            dispatch_release( machQueue );
+        }
         
         // we only use the process source in localonly mode to track who is still around
         if ( gDSLocalOnlyMode == true && inPID > 0 ) {
@@ -582,7 +685,7 @@ kern_return_t dsmig_do_api_call( mach_port_t server,
 		{
 			// we need to copy because we will allocate/deallocate it in the handler
 			//   but based on the size it thinks it is
-			sComData *pRequest = (sComData *) calloc( sizeof(sComData) + dataSize, 1 );
+			sComData *pRequest = dsAllocComDataPriv( dataSize );
 			if ( pRequest == NULL )
 				return KERN_MEMORY_ERROR;
 			
@@ -608,8 +711,22 @@ kern_return_t dsmig_do_api_call( mach_port_t server,
 				reqStartTime = dsTimestamp();
 			}
 			
+			// the per-client queue is concurrent, so serialize this client's requests on the same reference chain
+			sRefChainLock	*chainLock	= NULL;
+			UInt32			chainRef	= 0;
+			if ( gDSConcurrentClientDispatch == true ) {
+				chainRef = GetRequestChainRef( pRequest );
+				if ( chainRef != 0 ) {
+					chainLock = AcquireRefChainLock( server, chainRef );
+				}
+			}
+			
 			handler.HandleRequest( &pRequest );
 			
+			if ( chainLock != NULL ) {
+				ReleaseRefChainLock( server, chainRef, chainLock );
+			}
+			
 			if ( (gDebugLogging) || (gLogAPICalls) )
 			{
 				reqEndTime = dsTimestamp();
@@ -648,7 +765,7 @@ kern_return_t dsmig_do_api_call( mach_port_t server,
 			}
 
 			// free our allocated request data...
-			free( pRequest );
+			dsFreeComDataPriv( pRequest );
 			pRequest = NULL;
 			
 			gAPICallCount++;
@@ -1387,10 +1504,6 @@ ServerControl::ServerControl ( void )
 	fMemberDaemonFlushCacheRequestCount	= 0;
 	
 #ifdef BUILD_IN_PERFORMANCE
-	fLastPluginCalled			= 0;
-	fPerfTableNumPlugins		= 0;
-	fPerfTable					= nil;
-	
 #if PERFORMANCE_STATS_ALWAYS_ON
 	fPerformanceStatGatheringActive	= true;
 #else
@@ -1598,8 +1711,13 @@ SInt32 ServerControl::StartUpServer ( void )
 			gPluginConfig = new CPluginConfig();
 			if ( gPluginConfig == nil ) throw( (SInt32)eMemoryAllocError );
 			gPluginConfig->Initialize();
+			
+			// fixed for the life of the process, must be known before the first per-client port is created
+			gDSConcurrentClientDispatch = gPluginConfig->GetConcurrentClientDispatch();
 		}
 #endif
+		SrvrLog( kLogApplication, "Per-client requests use %s dispatch",
+				 (gDSConcurrentClientDispatch ? "concurrent (serialized per reference chain)" : "serial") );
 		
 		if ( gPlugins == nil )
 		{
@@ -2139,118 +2257,241 @@ ServerControl::ToggleAPILogging( bool fromSignal )
 }
 
 #ifdef BUILD_IN_PERFORMANCE
-void ServerControl::DeletePerfStatTable( void )
+static PerformanceStatShard * volatile	gPerfStatShards		= NULL;
+static pthread_key_t					gPerfStatShardKey;
+static pthread_once_t					gPerfStatShardOnce	= PTHREAD_ONCE_INIT;
+static uint32_t							gPerfStatErrorSeq	= 0;
+
+static void ReleasePerfStatShard( void *inShard )
 {
-	PluginPerformanceStats**	table = fPerfTable;
-	UInt32						pluginCount = fPerfTableNumPlugins;
+	// shards are kept so their stats survive the thread, the next new thread reuses it
+	__sync_lock_release( &((PerformanceStatShard *) inShard)->inUse );
+}
 
-	fPerfTable = NULL;
-	fPerfTableNumPlugins = 0;
+static void CreatePerfStatShardKey( void )
+{
+	pthread_key_create( &gPerfStatShardKey, ReleasePerfStatShard );
+}
+
+static PerformanceStatShard *GetPerfStatShard( void )
+{
+	pthread_once( &gPerfStatShardOnce, CreatePerfStatShardKey );
+	
+	PerformanceStatShard *shard = (PerformanceStatShard *) pthread_getspecific( gPerfStatShardKey );
+	if ( shard != NULL )
+		return shard;
+	
+	for ( shard = gPerfStatShards; shard != NULL; shard = shard->next )
+	{
+		if ( __sync_lock_test_and_set(&shard->inUse, 1) == 0 )
+			break;
+	}
 	
-	if ( table )
+	if ( shard == NULL )
 	{
-		for ( UInt32 i=0; i<pluginCount+1; i++ )
+		shard = (PerformanceStatShard *) calloc( 1, sizeof(PerformanceStatShard) );
+		shard->inUse = 1;
+		do {
+			shard->next = gPerfStatShards;
+		} while ( __sync_bool_compare_and_swap(&gPerfStatShards, shard->next, shard) == false );
+	}
+	
+	pthread_setspecific( gPerfStatShardKey, shard );
+	
+	return shard;
+}
+
+static PluginPerformanceStats *GetPerfStatsForPlugin( PerformanceStatShard *inShard, FourCharCode inPluginSig )
+{
+	PluginPerformanceStats	*stats	= NULL;
+	
+	if ( inShard->pluginCount > 0 && inShard->plugins[inShard->lastPluginCalled]->pluginSignature == inPluginSig )
+		return inShard->plugins[inShard->lastPluginCalled];
+	
+	for ( uint32_t i = 0; i < inShard->pluginCount; i++ )
+	{
+		if ( inShard->plugins[i]->pluginSignature == inPluginSig )
 		{
-			if ( table[i] )
+			inShard->lastPluginCalled = i;
+			return inShard->plugins[i];
+		}
+	}
+	
+	// first call to this plugin on this thread, the server uses signature 0
+	stats = (PluginPerformanceStats *) calloc( 1, sizeof(PluginPerformanceStats) );
+	stats->pluginSignature = inPluginSig;
+	stats->pluginName = "Server";
+	if ( inPluginSig != 0 )
+	{
+		UInt32 pluginCount = gPlugins->GetPlugInCount();
+		for ( UInt32 i = 0; i < pluginCount; i++ )
+		{
+			CPlugInList::sTableData *info = gPlugins->GetPlugInInfo( i );
+			if ( info != NULL && info->fKey == inPluginSig )
 			{
-				free( table[i] );
-				table[i] = NULL;
+				stats->pluginName = info->fName;
+				break;
 			}
 		}
+	}
+	
+	if ( inShard->pluginCount == inShard->pluginCapacity )
+	{
+		// LogStats may be walking the old array, so it is not freed
+		uint32_t				newCapacity	= (inShard->pluginCapacity == 0 ? 8 : inShard->pluginCapacity * 2);
+		PluginPerformanceStats	**plugins	= (PluginPerformanceStats **) calloc( newCapacity, sizeof(PluginPerformanceStats *) );
 		
-		free( table );
+		if ( inShard->pluginCount > 0 )
+			bcopy( inShard->plugins, plugins, inShard->pluginCount * sizeof(PluginPerformanceStats *) );
+		__sync_synchronize();
+		inShard->plugins = plugins;
+		inShard->pluginCapacity = newCapacity;
 	}
+	
+	inShard->plugins[inShard->pluginCount] = stats;
+	__sync_synchronize();
+	inShard->lastPluginCalled = inShard->pluginCount++;
+	
+	return stats;
 }
 
-PluginPerformanceStats** ServerControl::CreatePerfStatTable( void )
+static inline uint32_t GetPerfHistogramBucket( double inDuration )
 {
-DbgLog( kLogPerformanceStats, "ServerControl::CreatePerfStatTable called\n" );
+	uint64_t usecs = (inDuration < 1.0 ? 0 : (uint64_t) inDuration);
+	
+	if ( usecs < kPerfHistogramSubBuckets )
+		return (uint32_t) usecs;
+	
+	uint32_t exponent	= 63 - __builtin_clzll( usecs );
+	uint32_t bucket		= (exponent - 1) * kPerfHistogramSubBuckets + ((usecs >> (exponent - 2)) & (kPerfHistogramSubBuckets - 1));
+	
+	return (bucket < kPerfHistogramBuckets ? bucket : kPerfHistogramBuckets - 1);
+}
 
-	PluginPerformanceStats**	table = NULL;
-	UInt32						pluginCount = gPlugins->GetPlugInCount();
+// upper bound of the bucket, in usecs
+static double GetPerfHistogramBucketValue( uint32_t inBucket )
+{
+	if ( inBucket < kPerfHistogramSubBuckets )
+		return inBucket;
 	
-	if ( fPerfTable )
-		DeletePerfStatTable();
-		
-	// how many plugins?
-	table = (PluginPerformanceStats**)calloc( sizeof(PluginPerformanceStats*), pluginCount+1 );	// create table for #plugins + 1 for server
+	uint32_t exponent	= inBucket / kPerfHistogramSubBuckets + 1;
+	uint32_t sub		= inBucket % kPerfHistogramSubBuckets;
+	
+	return (double) ((((uint64_t) kPerfHistogramSubBuckets + sub + 1) << (exponent - 2)) - 1);
+}
 
-	for ( UInt32 i=0; i<pluginCount; i++ )
+static double GetPerfHistogramPercentile( PluginPerformanceAPIStat *inStat, double inPercentile )
+{
+	uint64_t	total	= 0;
+	uint64_t	target	= (uint64_t) ceil( inStat->msgCnt * inPercentile );
+	
+	for ( uint32_t i = 0; i < kPerfHistogramBuckets; i++ )
 	{
-		table[i] = (PluginPerformanceStats*)calloc( sizeof(PluginPerformanceStats), 1 );
-		table[i]->pluginSignature = gPlugins->GetPlugInInfo(i)->fKey;
-		table[i]->pluginName = gPlugins->GetPlugInInfo(i)->fName;
+		total += inStat->histogram[i];
+		if ( total >= target && total > 0 )
+			return GetPerfHistogramBucketValue( i );
 	}
 	
-	table[pluginCount] = (PluginPerformanceStats*)calloc( sizeof(PluginPerformanceStats), 1 );
-	table[pluginCount]->pluginSignature = 0;
-	table[pluginCount]->pluginName = "Server";
+	return inStat->maxTime;
+}
+
+void ServerControl::DeletePerfStatTable( void )
+{
+	gPerformanceLoggingLock->WaitLock();
 	
-	fPerfTableNumPlugins = pluginCount;
-	fPerfTable = table;
+	// the shards belong to their threads, so only the counters are cleared
+	for ( PerformanceStatShard *shard = gPerfStatShards; shard != NULL; shard = shard->next )
+	{
+		for ( uint32_t i = 0; i < shard->pluginCount; i++ )
+		{
+			for ( UInt32 j = 0; j < kDSPlugInCallsEnd; j++ )
+			{
+				if ( shard->plugins[i]->apiStats[j] != NULL )
+					bzero( shard->plugins[i]->apiStats[j], sizeof(PluginPerformanceAPIStat) );
+			}
+		}
+	}
 	
-	return table;
+	gPerformanceLoggingLock->SignalLock();
 }
 
 double gLastDump =0;
 #define	kNumSecsBetweenDumps	60*2
 void ServerControl::HandlePerformanceStats( UInt32 msgType, FourCharCode pluginSig, SInt32 siResult, SInt32 clientPID, double inTime, double outTime )
 {
-	// Since the number of plugins is so small, just doing an O(n)/2 search is probably fine...
-	gPerformanceLoggingLock->WaitLock();
-	PluginPerformanceStats*		curPluginStats = NULL;
-	UInt32						pluginCount = gPlugins->GetPlugInCount();
-
-	if ( !fPerfTable || fPerfTableNumPlugins != pluginCount )
+	if ( msgType >= kDSPlugInCallsEnd )
+		return;
+	
+	// everything here is owned by the calling thread, no locking needed
+	PluginPerformanceStats		*curPluginStats	= GetPerfStatsForPlugin( GetPerfStatShard(), pluginSig );
+	PluginPerformanceAPIStat	*curAPI			= curPluginStats->apiStats[msgType];
+	double						duration		= outTime-inTime;
+	
+	if ( curAPI == NULL )
 	{
-		// first api call, or number of plugins changed, (re)create the table
-		fPerfTable = CreatePerfStatTable();
+		curAPI = (PluginPerformanceAPIStat *) calloc( 1, sizeof(PluginPerformanceAPIStat) );
+		curPluginStats->apiStats[msgType] = curAPI;
 	}
 	
-	if ( !pluginSig )
-		curPluginStats = fPerfTable[pluginCount];	// last entry in the table is reserved for the server
-		
-	if ( fPerfTable[fLastPluginCalled]->pluginSignature == pluginSig )
-		curPluginStats = fPerfTable[fLastPluginCalled];
-		
-	for ( UInt32 i=0; !curPluginStats && i<pluginCount; i++ )
+	curAPI->msgCnt++;
+	
+	if ( siResult )
 	{
-		if ( pluginSig == fPerfTable[i]->pluginSignature )
-		{
-			curPluginStats = fPerfTable[i];
-			fLastPluginCalled = i;
-		}
+		ErrorByPID *lastError = &curAPI->lastNErrors[curAPI->nextError];
+		
+		lastError->error = siResult;
+		lastError->clientPID = clientPID;
+		lastError->sequence = __sync_add_and_fetch( &gPerfStatErrorSeq, 1 );
+		curAPI->nextError = (curAPI->nextError + 1) % kNumErrorsToTrack;
+		curAPI->errCnt++;
 	}
 	
-	if ( curPluginStats )
+	if ( curAPI->minTime == 0 || curAPI->minTime > duration )
+		curAPI->minTime = duration;
+		
+	if ( curAPI->maxTime == 0 || curAPI->maxTime < duration )
+		curAPI->maxTime = duration;
+	
+	curAPI->totTime += duration;
+	curAPI->histogram[GetPerfHistogramBucket(duration)]++;
+}
+
+// folds one thread's API stats into the merged stats, keeping the most recent errors
+static void MergePerfAPIStat( PluginPerformanceAPIStat *ioMerged, PluginPerformanceAPIStat *inStat )
+{
+	if ( inStat->msgCnt == 0 )
+		return;
+	
+	if ( ioMerged->minTime == 0 || (inStat->minTime != 0 && ioMerged->minTime > inStat->minTime) )
+		ioMerged->minTime = inStat->minTime;
+	
+	if ( ioMerged->maxTime < inStat->maxTime )
+		ioMerged->maxTime = inStat->maxTime;
+	
+	ioMerged->msgCnt += inStat->msgCnt;
+	ioMerged->errCnt += inStat->errCnt;
+	ioMerged->totTime += inStat->totTime;
+	
+	for ( uint32_t i = 0; i < kPerfHistogramBuckets; i++ )
+		ioMerged->histogram[i] += inStat->histogram[i];
+	
+	// lastNErrors of the merged stat is kept sorted newest first
+	for ( uint32_t i = 0; i < kNumErrorsToTrack; i++ )
 	{
-		PluginPerformanceAPIStat*	curAPI = &(curPluginStats->apiStats[msgType]);
-		double						duration = outTime-inTime;
-		curAPI->msgCnt++;
+		ErrorByPID error = inStat->lastNErrors[i];
+		if ( error.sequence == 0 )
+			continue;
 		
-		if ( siResult )
+		for ( uint32_t j = 0; j < kNumErrorsToTrack; j++ )
 		{
-			for( int i=kNumErrorsToTrack-1; i>0; i-- )
+			if ( error.sequence > ioMerged->lastNErrors[j].sequence )
 			{
-				curAPI->lastNErrors[i].error = curAPI->lastNErrors[i-1].error;
-				curAPI->lastNErrors[i].clientPID = curAPI->lastNErrors[i-1].clientPID;
+				ErrorByPID displaced = ioMerged->lastNErrors[j];
+				ioMerged->lastNErrors[j] = error;
+				error = displaced;
 			}
-			
-			curAPI->lastNErrors[0].error = siResult;
-			curAPI->lastNErrors[0].clientPID = clientPID;
-			curAPI->errCnt++;
 		}
-		
-		if ( curAPI->minTime == 0 || curAPI->minTime > duration )
-			curAPI->minTime = duration;
-			
-		if ( curAPI->maxTime == 0 || curAPI->maxTime < duration )
-			curAPI->maxTime = duration;
-		
-		curAPI->totTime += duration;
 	}
-	
-	gPerformanceLoggingLock->SignalLock();
 }
 
 #define USEC_PER_HOUR	(double)60*60*USEC_PER_SEC	/* microseconds per hour */
@@ -2259,67 +2500,109 @@ void ServerControl::HandlePerformanceStats( UInt32 msgType, FourCharCode pluginS
 void ServerControl::LogStats( void )
 {
 	PluginPerformanceStats*		curPluginStats = NULL;
-	UInt32						pluginCount = fPerfTableNumPlugins;
 	char						logBuf[1024];
 	char						totTimeStr[256];
+	map<FourCharCode, PluginPerformanceStats *>				mergedStats;
+	map<FourCharCode, PluginPerformanceStats *>::iterator	mergedIter;
 	
 	gPerformanceLoggingLock->WaitLock();
 
+	for ( PerformanceStatShard *shard = gPerfStatShards; shard != NULL; shard = shard->next )
+	{
+		uint32_t				pluginCount	= shard->pluginCount;
+		PluginPerformanceStats	**plugins	= shard->plugins;
+		
+		for ( uint32_t i = 0; i < pluginCount; i++ )
+		{
+			PluginPerformanceStats *threadStats = plugins[i];
+			
+			mergedIter = mergedStats.find( threadStats->pluginSignature );
+			if ( mergedIter == mergedStats.end() )
+			{
+				curPluginStats = (PluginPerformanceStats *) calloc( 1, sizeof(PluginPerformanceStats) );
+				curPluginStats->pluginSignature = threadStats->pluginSignature;
+				curPluginStats->pluginName = threadStats->pluginName;
+				mergedStats[threadStats->pluginSignature] = curPluginStats;
+			}
+			else
+			{
+				curPluginStats = mergedIter->second;
+			}
+			
+			for ( UInt32 j = 0; j < kDSPlugInCallsEnd; j++ )
+			{
+				if ( threadStats->apiStats[j] == NULL )
+					continue;
+				
+				if ( curPluginStats->apiStats[j] == NULL )
+					curPluginStats->apiStats[j] = (PluginPerformanceAPIStat *) calloc( 1, sizeof(PluginPerformanceAPIStat) );
+				
+				MergePerfAPIStat( curPluginStats->apiStats[j], threadStats->apiStats[j] );
+			}
+		}
+	}
+
 	syslog( LOG_CRIT, "**Usage Stats**\n");
-	syslog( LOG_CRIT, "\tPlugin\tAPI\tMsgCnt\tErrCnt\tminTime (usec)\tmaxTime (usec)\taverageTime (usec)\ttotTime (usec|secs|hours|days)\tLast PID\tLast Error\tPrev PIDs/Errors\n" );
+	syslog( LOG_CRIT, "\tPlugin\tAPI\tMsgCnt\tErrCnt\tminTime (usec)\tmaxTime (usec)\taverageTime (usec)\tp50 (usec)\tp99 (usec)\tp999 (usec)\ttotTime (usec|secs|hours|days)\tLast PID\tLast Error\tPrev PIDs/Errors\n" );
 	
-	for ( UInt32 i=0; i<pluginCount+1; i++ )	// server is at the end
+	for ( mergedIter = mergedStats.begin(); mergedIter != mergedStats.end(); mergedIter++ )
 	{
-		if ( !fPerfTable[i] )
-			continue;
-			
-		curPluginStats = fPerfTable[i];
+		curPluginStats = mergedIter->second;
 				
 		for ( UInt32 j=0; j<kDSPlugInCallsEnd; j++ )
 		{
-			if ( curPluginStats->apiStats[j].msgCnt > 0 )
+			PluginPerformanceAPIStat *curAPI = curPluginStats->apiStats[j];
+			
+			if ( curAPI != NULL && curAPI->msgCnt > 0 )
 			{
-				if ( curPluginStats->apiStats[j].totTime < USEC_PER_SEC )
-					sprintf( totTimeStr, "%0.f usecs", curPluginStats->apiStats[j].totTime );
-				else if ( curPluginStats->apiStats[j].totTime < USEC_PER_HOUR )
+				if ( curAPI->totTime < USEC_PER_SEC )
+					sprintf( totTimeStr, "%0.f usecs", curAPI->totTime );
+				else if ( curAPI->totTime < USEC_PER_HOUR )
 				{
-					double		time = curPluginStats->apiStats[j].totTime / USEC_PER_SEC;
+					double		time = curAPI->totTime / USEC_PER_SEC;
 					sprintf( totTimeStr, "%0.4f secs", time );
 				}
-				else if ( curPluginStats->apiStats[j].totTime < USEC_PER_DAY )
+				else if ( curAPI->totTime < USEC_PER_DAY )
 				{
-					double		time = curPluginStats->apiStats[j].totTime / USEC_PER_HOUR;
+					double		time = curAPI->totTime / USEC_PER_HOUR;
 					sprintf( totTimeStr, "%0.4f hours", time );
 				}
 				else
 				{
-					double		time = curPluginStats->apiStats[j].totTime / USEC_PER_DAY;
+					double		time = curAPI->totTime / USEC_PER_DAY;
 					sprintf( totTimeStr, "%0.4f days", time );
 				}
 				
-				sprintf( logBuf, "\t%s\t%s\t%d\t%d\t%.0f\t%0.f\t%0.f\t%s\t%d/%d\t%d/%d\t%d/%d\t%d/%d\t%d/%d\n",
+				snprintf( logBuf, sizeof(logBuf), "\t%s\t%s\t%d\t%d\t%.0f\t%0.f\t%0.f\t%0.f\t%0.f\t%0.f\t%s\t%d/%d\t%d/%d\t%d/%d\t%d/%d\t%d/%d\n",
 								curPluginStats->pluginName,
 								CRequestHandler::GetCallName(j),
-								curPluginStats->apiStats[j].msgCnt,
-								curPluginStats->apiStats[j].errCnt,
-								curPluginStats->apiStats[j].minTime,
-								curPluginStats->apiStats[j].maxTime,
-								(curPluginStats->apiStats[j].totTime/curPluginStats->apiStats[j].msgCnt),
+								curAPI->msgCnt,
+								curAPI->errCnt,
+								curAPI->minTime,
+								curAPI->maxTime,
+								(curAPI->totTime/curAPI->msgCnt),
+								GetPerfHistogramPercentile( curAPI, 0.50 ),
+								GetPerfHistogramPercentile( curAPI, 0.99 ),
+								GetPerfHistogramPercentile( curAPI, 0.999 ),
 								totTimeStr,
-								curPluginStats->apiStats[j].lastNErrors[0].clientPID,
-								curPluginStats->apiStats[j].lastNErrors[0].error,
-								curPluginStats->apiStats[j].lastNErrors[1].clientPID,
-								curPluginStats->apiStats[j].lastNErrors[1].error,
-								curPluginStats->apiStats[j].lastNErrors[2].clientPID,
-								curPluginStats->apiStats[j].lastNErrors[2].error,
-								curPluginStats->apiStats[j].lastNErrors[3].clientPID,
-								curPluginStats->apiStats[j].lastNErrors[3].error,
-								curPluginStats->apiStats[j].lastNErrors[4].clientPID,
-								curPluginStats->apiStats[j].lastNErrors[4].error );
+								curAPI->lastNErrors[0].clientPID,
+								curAPI->lastNErrors[0].error,
+								curAPI->lastNErrors[1].clientPID,
+								curAPI->lastNErrors[1].error,
+								curAPI->lastNErrors[2].clientPID,
+								curAPI->lastNErrors[2].error,
+								curAPI->lastNErrors[3].clientPID,
+								curAPI->lastNErrors[3].error,
+								curAPI->lastNErrors[4].clientPID,
+								curAPI->lastNErrors[4].error );
 				
-				syslog( LOG_CRIT, logBuf );
+				syslog( LOG_CRIT, "%s", logBuf );
 			}
+			
+			DSFree( curAPI );
 		}
+		
+		free( curPluginStats );
 	}
 	
 	gPerformanceLoggingLock->SignalLock();
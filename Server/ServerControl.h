@@ -145,9 +145,14 @@ typedef enum {
     kDSLUlastprocnum // this number will increment automatically
 } eDSLookupProcedureNumber;
 
+// log-linear latency histogram in usecs, 4 buckets per power of 2 (within 25%), tops out around 9 minutes
+#define	kPerfHistogramSubBuckets	4
+#define	kPerfHistogramBuckets		112
+
 typedef struct {
 	int32_t						clientPID;
 	int32_t						error;
+	uint32_t					sequence;	// orders errors across threads when stats are merged
 } ErrorByPID;
 
 typedef struct {
@@ -156,14 +161,26 @@ typedef struct {
 	double						minTime;
 	double						maxTime;
 	double						totTime;
+	uint32_t					nextError;	// ring index into lastNErrors
 	ErrorByPID					lastNErrors[kNumErrorsToTrack];
+	uint32_t					histogram[kPerfHistogramBuckets];
 } PluginPerformanceAPIStat;
 
 typedef struct {
 	FourCharCode				pluginSignature;
 	const char*					pluginName;
-	PluginPerformanceAPIStat	apiStats[kDSPlugInCallsEnd];	// size is equal to the max number of API calls
+	PluginPerformanceAPIStat	*apiStats[kDSPlugInCallsEnd];	// size is equal to the max number of API calls, allocated on first use
 } PluginPerformanceStats;
+
+// stats are gathered per thread without locking and only merged by LogStats
+typedef struct PerformanceStatShard {
+	PluginPerformanceStats		**plugins;
+	uint32_t					pluginCount;
+	uint32_t					pluginCapacity;
+	uint32_t					lastPluginCalled;
+	volatile uint32_t			inUse;
+	struct PerformanceStatShard	*next;
+} PerformanceStatShard;
 #endif
 
 //-----------------------------------------------------------------------------
@@ -222,8 +239,6 @@ public:
 protected:
 #ifdef BUILD_IN_PERFORMANCE
 			void		DeletePerfStatTable			( void );
-			PluginPerformanceStats**	
-						CreatePerfStatTable			( void );
 #endif
 
 	static	void		TCPListenerEventCallback	( int listenFD );
@@ -239,12 +254,6 @@ private:
 	UInt32				fTCPHandlerThreadsCnt;
 	UInt32              fLibinfoHandlerThreadCnt;
 
-#ifdef BUILD_IN_PERFORMANCE
-	UInt32				fLastPluginCalled;
-	PluginPerformanceStats	**fPerfTable;
-	UInt32				fPerfTableNumPlugins;
-#endif
-	
 	SCDynamicStoreRef	fSCDStore;
 	bool				fPerformanceStatGatheringActive;
 	UInt32				fMemberDaemonFlushCacheRequestCount;
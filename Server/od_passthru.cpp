@@ -2233,10 +2233,26 @@ receive_extmodule_logging_enable(mach_port_t port, boolean_t enabled, int32_t ma
 #pragma mark
 #pragma mark External functions
 
+void
+od_passthru_log_context(uint64_t *reqid, bool *session)
+{
+	(*reqid) = 0;
+	
+#ifdef __LP64__
+	(*reqid) = (uint64_t) pthread_getspecific(_od_passthru_thread_key());
+#else
+	uint64_t *specific = (uint64_t *) pthread_getspecific(_od_passthru_thread_key());
+	if (specific != NULL) {
+		(*reqid) = (*specific);
+	}
+#endif
+	
+	(*session) = (pthread_getspecific(_od_passthru_session_threadid()) != NULL);
+}
+
 bool
-od_passthru_log_message(int32_t level, const char *message)
+od_passthru_log_message_with_context(int32_t level, const char *message, uint64_t reqid, bool session)
 {
-	uint64_t reqid = 0;
 	int32_t new_level = 5;
 	
 	if (odd_logging_enabled == false) {
@@ -2265,18 +2281,9 @@ od_passthru_log_message(int32_t level, const char *message)
 		new_level = 7;
 	}
 	
-#ifdef __LP64__
-	reqid = (uint64_t) pthread_getspecific(_od_passthru_thread_key());
-#else
-	uint64_t *specific = (uint64_t *) pthread_getspecific(_od_passthru_thread_key());
-	if (specific != NULL) {
-		reqid = (*specific);
-	}
-#endif
-	
 	dispatch_sync(_get_passthru_queue(),  ^(void) {
 		if (odd_port != MACH_PORT_NULL) {
-			if (pthread_getspecific(_od_passthru_session_threadid()) == NULL) {
+			if (session == false) {
 				send_legacy_log_message(odd_port, reqid, new_level, (char *) message);
 			}
 			else {
@@ -2288,6 +2295,21 @@ od_passthru_log_message(int32_t level, const char *message)
 	return true;
 }
 
+bool
+od_passthru_log_message(int32_t level, const char *message)
+{
+	uint64_t reqid;
+	bool session;
+	
+	if (odd_logging_enabled == false) {
+		return false;
+	}
+	
+	od_passthru_log_context(&reqid, &session);
+	
+	return od_passthru_log_message_with_context(level, message, reqid, session);
+}
+
 void
 od_passthru_set_node_availability(const char *nodename, bool available)
 {
@@ -38,6 +38,12 @@ od_passthru_unregister_node(const char *nodename);
 bool
 od_passthru_log_message(int32_t level, const char *message);
 
+void
+od_passthru_log_context(uint64_t *reqid, bool *session);
+
+bool
+od_passthru_log_message_with_context(int32_t level, const char *message, uint64_t reqid, bool session);
+
 uid_t
 od_passthru_get_uid(void);
 